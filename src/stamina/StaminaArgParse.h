@@ -89,8 +89,12 @@ static struct argp_option options[] = {
 // 		"Rank transitions before expanding (default: false)"}
 	, {"maxIterations", 'M', "int", 0,
 		"Maximum iteration for solution (default: 10000)"}
-//	, {"maxStates", 'V', "integer", 0,
-//		"The maximum number of states to explore in an iteration (default 2000000)"}
+	, {"maxStates", 'V', "integer", 0,
+		"Stop exploring once this many states have been found, and connect the frontier to the absorbing state (default: 0, no limit)"}
+	, {"maxTransitions", 'N', "integer", 0,
+		"Stop exploring once this many transitions have been found, and connect the frontier to the absorbing state (default: 0, no limit)"}
+	, {"maxMemory", 'L', "MB", 0,
+		"Stop exploring once STAMINA's resident memory reaches this many megabytes, and connect the frontier to the absorbing state (default: 0, no limit)"}
 	, {"quiet", 'q', 0, 0,
 		"Do not emit any warning, info, or error messages"}
 	, {"iterative", 'I', 0, 0,
@@ -111,6 +115,14 @@ static struct argp_option options[] = {
 		"Prioritize for common event priority (only works with -P option)"}
 	, {"distanceWeight", 'W', "double", 0,
 		"Weight factor for distance priority metric (use with -P and either -b or -d)"}
+	, {"incrementalMatrix", 'm', 0, 0,
+		"Keep the transition matrix between refinement iterations and only rewrite rows which changed (default: off)"}
+	, {"warmStart", 'H', 0, 0,
+		"Check properties with STAMINA's transient solver, warm-started from the previous refinement iteration (default: off)"}
+	, {"jointSolver", 'u', 0, 0,
+		"Check Pmin and Pmax together in a single pass of STAMINA's transient solver (default: off)"}
+	, {"compiledGenerator", 'g', 0, 0,
+		"Expand states with STAMINA's compiled PRISM generator rather than storm's expression evaluator (default: off)"}
 	, { 0 }
 };
 
@@ -143,12 +155,18 @@ struct arguments {
 	bool rank_transitions;
 	uint64_t max_iterations;
 	uint64_t max_states;
+	uint64_t max_transitions;
+	uint64_t max_memory;
 	uint8_t method;
 	uint8_t threads;
 	bool preterminate;
 	uint8_t event;
 	double distance_weight;
 	bool quiet;
+	bool incremental_matrix;
+	bool warm_start;
+	bool joint_solver;
+	bool compiled_generator;
 };
 
 /**
@@ -224,7 +242,13 @@ parse_opt(int key, char * arg, struct argp_state * state) {
 			arguments->max_iterations = (uint64_t) atoi(arg);
 			break;
 		case 'V':
-			arguments->max_states = (uint64_t) atoi(arg);
+			arguments->max_states = (uint64_t) atoll(arg);
+			break;
+		case 'N':
+			arguments->max_transitions = (uint64_t) atoll(arg);
+			break;
+		case 'L':
+			arguments->max_memory = (uint64_t) atoll(arg);
 			break;
 		case 'I':
 			arguments->method = STAMINA_METHODS::ITERATIVE_METHOD;
@@ -268,6 +292,18 @@ parse_opt(int key, char * arg, struct argp_state * state) {
 			arguments->distance_weight = (double) atof(arg);
 			break;
 
+		case 'm':
+			arguments->incremental_matrix = true;
+			break;
+		case 'H':
+			arguments->warm_start = true;
+			break;
+		case 'u':
+			arguments->joint_solver = true;
+			break;
+		case 'g':
+			arguments->compiled_generator = true;
+			break;
 		case 'q':
 			arguments->quiet = true;
 			break;
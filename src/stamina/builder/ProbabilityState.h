@@ -26,77 +26,134 @@
 #include "core/Options.h"
 #include "core/StaminaMessages.h"
 
+#include <atomic>
+
 namespace stamina {
 	namespace builder {
 		using namespace storm::builder;
-		/* Class for states with probabilities */
+		/*
+		 * Class for states with probabilities. This is kept to 16 bytes (for 32-bit state indices) since
+		 * there is one for every explored state: the flags are packed into a single byte and the transitions
+		 * of pre-terminated states are kept in a side table by the builders which need them.
+		 *
+		 * In the threaded builder, different threads may set different flags of the same state (e.g., a thief
+		 * and the thread it stole from), so flags are only read and written through the accessors below,
+		 * which update the byte atomically. For the same reason pi is only changed atomically: the thread it
+		 * was stolen from may still add to pi while the thief explores the state.
+		 * */
 		template <typename StateType>
 		class ProbabilityState {
 		public:
 			StateType index;
-			double pi;
-			bool terminal;
 			uint8_t iterationLastSeen;
-			bool assignedInRemapping;
-			bool isNew;
-			bool wasPutInTerminalQueue;
-			bool preTerminated;
-			bool deadlock;
-			std::shared_ptr<std::vector<StaminaTransitionInfo<StateType>>> preTerminatedTransitions; // the list of preterminated transitions
+			uint8_t owner; // The exploration thread which owns this state (0 if none). Use getOwner() and transferOwnership()
+		private:
+			// Set of Flag, only changed atomically since threads may set different flags at once
+			uint8_t flags;
+			// Only accessed atomically, through getPi(), addToPi(), setPi() and takePi()
+			double pi;
+		public:
 			ProbabilityState(
 				StateType index = 0
 				, double pi = 0.0
 				, bool terminal = true
 				, uint8_t iterationLastSeen = 0
 			) : index(index)
-				, pi(pi)
-				, terminal(terminal)
-				, assignedInRemapping(false)
 				, iterationLastSeen(iterationLastSeen)
-				, isNew(true)
-				, wasPutInTerminalQueue(false)
-				, preTerminated(false)
-				, preTerminatedTransitions(nullptr)
-				, deadlock(false)
+				, owner(0)
+				, flags(terminal ? (TERMINAL | NEW) : NEW)
+				, pi(pi)
 			{
 				// Intentionally left empty
 			}
 			// Copy constructor
-			ProbabilityState(const ProbabilityState & other)
-				: index(other.index)
-				, pi(other.pi)
-				, terminal(other.terminal)
-				, assignedInRemapping(other.assignedInRemapping)
-				, isNew(other.isNew)
-				, preTerminated(other.preTerminated)
-				, preTerminatedTransitions(other.preTerminatedTransitions)
-				, wasPutInTerminalQueue(other.wasPutInTerminalQueue)
-				, deadlock(other.deadlock)
-				, iterationLastSeen(other.iterationLastSeen)
-			{
-				// Intentionally left empty
-			}
+			ProbabilityState(const ProbabilityState & other) = default;
+			ProbabilityState & operator=(const ProbabilityState & other) = default;
 
-			double getPi() {
-				return pi;
+			double getPi() const {
+				return std::atomic_ref<double>(const_cast<double &>(pi)).load(std::memory_order_relaxed);
 			}
 			void addToPi(double add) {
-				pi += add;
+				std::atomic_ref<double>(pi).fetch_add(add, std::memory_order_relaxed);
 			}
-			void setPi(double pi) {
-				this->pi = pi;
+			void setPi(double newPi) {
+				std::atomic_ref<double>(pi).store(newPi, std::memory_order_relaxed);
+			}
+			/**
+			 * Sets pi to 0 and returns what it was, so that an explorer distributes exactly the mass it
+			 * takes, and anything added afterwards stays with the state
+			 * */
+			double takePi() {
+				return std::atomic_ref<double>(pi).exchange(0.0, std::memory_order_relaxed);
 			}
 			bool isTerminal() {
-				return terminal;
+				return getFlag(TERMINAL);
 			}
+			/**
+			 * Sets whether this state is terminal. For a state in a StateIndexArray, use
+			 * StateIndexArray::setTerminal() instead so the array's terminal bitmap is kept up to date.
+			 * */
 			void setTerminal(bool term) {
-				terminal = term;
+				setFlag(TERMINAL, term);
 			}
 			bool isPreTerminated() {
-				return preTerminated;
+				return getFlag(PRE_TERMINATED);
 			}
 			void setPreTerminated(bool preTerm) {
-				preTerminated = preTerm;
+				setFlag(PRE_TERMINATED, preTerm);
+			}
+			/**
+			 * Whether this state has not been explored yet, so its transitions still have to be created
+			 * */
+			bool isNew() {
+				return getFlag(NEW);
+			}
+			void setNew(bool newState) {
+				setFlag(NEW, newState);
+			}
+			/**
+			 * Whether this state is in statesTerminatedLastIteration
+			 * */
+			bool wasPutInTerminalQueue() {
+				return getFlag(IN_TERMINAL_QUEUE);
+			}
+			void setPutInTerminalQueue(bool put) {
+				setFlag(IN_TERMINAL_QUEUE, put);
+			}
+			/**
+			 * Whether this state was found to be a deadlock (and made absorbing)
+			 * */
+			bool isDeadlock() {
+				return getFlag(DEADLOCK);
+			}
+			void setDeadlock(bool deadlock) {
+				setFlag(DEADLOCK, deadlock);
+			}
+			bool isAssignedInRemapping() {
+				return getFlag(ASSIGNED_IN_REMAPPING);
+			}
+			void setAssignedInRemapping(bool assigned) {
+				setFlag(ASSIGNED_IN_REMAPPING, assigned);
+			}
+			/**
+			 * Gets the thread which owns this state. Ownership belongs to the state rather than to the
+			 * thread that discovered it, so that a thread stealing a state can take it over.
+			 * */
+			uint8_t getOwner() {
+				return std::atomic_ref<uint8_t>(owner).load();
+			}
+			void setOwner(uint8_t newOwner) {
+				std::atomic_ref<uint8_t>(owner).store(newOwner);
+			}
+			/**
+			 * Atomically moves ownership from one thread to another
+			 *
+			 * @param from The thread expected to own this state
+			 * @param to The thread which should own this state
+			 * @return Whether `from` owned the state (and now `to` does)
+			 * */
+			bool transferOwnership(uint8_t from, uint8_t to) {
+				return std::atomic_ref<uint8_t>(owner).compare_exchange_strong(from, to);
 			}
 			inline bool operator==(const ProbabilityState & rhs) const {
 				return index == rhs.index;
@@ -113,8 +170,26 @@ namespace stamina {
 			inline bool operator<(const ProbabilityState & rhs) const {
 				return index < rhs.index;
 			}
-
-
+		private:
+			enum Flag : uint8_t {
+				TERMINAL = 1
+				, ASSIGNED_IN_REMAPPING = 1 << 1
+				, NEW = 1 << 2
+				, IN_TERMINAL_QUEUE = 1 << 3
+				, PRE_TERMINATED = 1 << 4
+				, DEADLOCK = 1 << 5
+			};
+			bool getFlag(Flag flag) {
+				return std::atomic_ref<uint8_t>(flags).load(std::memory_order_relaxed) & flag;
+			}
+			void setFlag(Flag flag, bool value) {
+				if (value) {
+					std::atomic_ref<uint8_t>(flags).fetch_or(flag, std::memory_order_relaxed);
+				}
+				else {
+					std::atomic_ref<uint8_t>(flags).fetch_and(static_cast<uint8_t>(~flag), std::memory_order_relaxed);
+				}
+			}
 		};
 
 		template <typename StateType>
@@ -124,7 +199,7 @@ namespace stamina {
 				, const ProbabilityState<StateType> * second
 			) const {
 				// Create a max heap on the reachability probability
-				return first->pi < second->pi;
+				return first->getPi() < second->getPi();
 			}
 		};
 
@@ -133,71 +208,69 @@ namespace stamina {
 		public:
 			ProbabilityState<StateType> * first;
 			CompressedState second;
-			float distance; // Distance between state and threshold
+			// Distance between state and threshold. Calculated once, when the state is enqueued, so that
+			// comparisons in the priority queue never evaluate it again
+			float distance;
+			// Priority in the frontier, combining reachability and distance. Set by the builder whenever
+			// either changes, so comparisons do not have to compute it (see ProbabilityStatePairComparison)
+			double score;
 			ProbabilityStatePair(
-				ProbabilityState<StateType> * first
-				, CompressedState second
+				ProbabilityState<StateType> * first = nullptr
+				, CompressedState second = CompressedState()
 			) : first(first)
 				, second(second)
+				, distance(0)
+				, score(0)
 			{
 				/* Intentionally Left Empty */
 			}
 			ProbabilityStatePair(const ProbabilityStatePair<StateType> & other)
 				: first(other.first)
 				, second(other.second)
+				, distance(other.distance)
+				, score(other.score)
 			{ /* Intentionally left empty */ }
+			ProbabilityStatePair(ProbabilityStatePair<StateType> && other) = default;
+			ProbabilityStatePair & operator=(const ProbabilityStatePair<StateType> & other) = default;
+			ProbabilityStatePair & operator=(ProbabilityStatePair<StateType> && other) = default;
 			~ProbabilityStatePair() {
 				// Intentionally left empty
 			}
 		};
 
-		template <typename StateType>
+		/**
+		 * Orders the priority builder's frontier. The event mode is fixed at compile time, so score() does not
+		 * branch on Options, and comparing two pairs only compares the scores stored in them.
+		 * */
+		template <typename StateType, EVENTS Event = EVENTS::UNDEFINED>
 		struct ProbabilityStatePairComparison {
-			bool operator() (
-				const ProbabilityStatePair<StateType> first
-				, const ProbabilityStatePair<StateType> second
-			) const {
-				switch (core::Options::event) {
-				case EVENTS::RARE:
+			/**
+			 * Computes the score of a pair, which should be stored in it whenever its reachability or distance change
+			 *
+			 * @param pair The pair
+			 * @return The score
+			 * */
+			static double score(const ProbabilityStatePair<StateType> & pair) {
+				if constexpr (Event == EVENTS::RARE) {
 					// For rare events, since we are trying to bring Pmax closer to Pactual, we want higher priority on
 					// states which DO NOT satisfy the property since PMax assumes all states outside of what we have
 					// explored do satisfy the property. As a result we want to mirror that.
-					return first.first->pi + core::Options::distance_weight * first.distance < second.first->pi + core::Options::distance_weight * second.distance;
-				case EVENTS::COMMON:
+					return pair.first->getPi() * (1 + core::Options::distance_weight * pair.distance);
+				}
+				else if constexpr (Event == EVENTS::COMMON) {
 					// For common events, it's the opposite. Therefore we invert the distance
-					return first.first->pi + core::Options::distance_weight * (1 - first.distance) < second.first->pi + core::Options::distance_weight * (1 - second.distance);
-				case EVENTS::UNDEFINED:
-				default:
+					return pair.first->getPi() * (1 + core::Options::distance_weight * (1 - pair.distance));
+				}
+				else {
 					// Create a max heap on the reachability probability
-					return first.first->pi < second.first->pi;
+					return pair.first->getPi();
 				}
 			}
-		};
-
-		template <typename StateType>
-		struct ProbabilityStatePairPointerComparison {
 			bool operator() (
-				const std::shared_ptr<ProbabilityStatePair<StateType>> first
-				, const std::shared_ptr<ProbabilityStatePair<StateType>> second
+				const ProbabilityStatePair<StateType> & first
+				, const ProbabilityStatePair<StateType> & second
 			) const {
-				// StaminaMessages::info("Distance for state 1: " + std::to_string(first->distance));
-				// StaminaMessages::info("Distance for state 2: " + std::to_string(second->distance));
-				switch (core::Options::event) {
-				case EVENTS::RARE:
-					// For rare events, since we are trying to bring Pmax closer to Pactual, we want higher priority on
-					// states which DO NOT satisfy the property since PMax assumes all states outside of what we have
-					// explored do satisfy the property. As a result we want to mirror that.
-					return first->first->pi * (1 + core::Options::distance_weight * first->distance) < second->first->pi * (1 + core::Options::distance_weight * second->distance);
-				case EVENTS::COMMON:
-					// For common events, it's the opposite. Therefore we invert the distance
-					return first->first->pi * ( 1 + core::Options::distance_weight * (1 - first->distance)) < second->first->pi * (1 + core::Options::distance_weight * (1 - second->distance));
-				case EVENTS::UNDEFINED:
-				default:
-					// Create a max heap on the reachability probability
-					return first->first->pi < second->first->pi;
-				}
-				// Create a max heap on the reachability probability
-				// return first->first->pi < second->first->pi;
+				return first.score < second.score;
 			}
 		};
 
@@ -138,10 +138,7 @@ StaminaIterativeModelBuilder<ValueType, RewardModelType, StateType>::buildMatric
 		generator->load(currentState);
 
 		if (formulaMatchesExpression && !Options::no_prop_refine) {
-			storm::expressions::SimpleValuation valuation = generator->currentStateToSimpleValuation();
-			// bool evaluationAtCurrentState = propertyExpression->evaluateAsBool(&valuation);
-			bool leftEvaluation = leftPropertyExpression->evaluateAsBool(&valuation);
-			bool rightEvaluation = rightPropertyExpression->evaluateAsBool(&valuation);;
+			auto [leftEvaluation, rightEvaluation] = this->evaluatePropertyExpressions(currentState);
 			// The left evaluation is, for a property P=?[ phi1 U[] phi2 ], the state evaluation
 			// of phi1(s), and the right evaluation is phi2(s). Our formula for early termination
 			// is !leftEvaluation || rightEvaluation, because
@@ -155,7 +152,7 @@ StaminaIterativeModelBuilder<ValueType, RewardModelType, StateType>::buildMatric
 				this->createTransition(currentIndex, currentIndex, 1.0);
 				// We treat this state as terminal even though it is also absorbing and does not
 				// go to our artificial absorbing state
-				currentProbabilityState->terminal = true;
+				stateMap.setTerminal(currentProbabilityState, true);
 				numberTerminal++;
 				// Do NOT place this in the deque of states we should start with next iteration
 				continue;
@@ -163,30 +160,34 @@ StaminaIterativeModelBuilder<ValueType, RewardModelType, StateType>::buildMatric
 		}
 
 		// Add the state rewards to the corresponding reward models.
-		// Do not explore if state is terminal and its reachability probability is less than kappa
-		if (currentProbabilityState->isTerminal() && currentProbabilityState->getPi() < localKappa) {
+		// Do not explore if state is terminal and its reachability probability is less than kappa, or
+		// if the exploration budget has run out
+		if (currentProbabilityState->isTerminal() && (
+			currentProbabilityState->getPi() < localKappa
+			|| this->checkExplorationBudget(stateStorage.getNumberOfStates())
+		)) {
 			// Do not connect to absorbing yet
 			// Place this in statesTerminatedLastIteration
-			if ( !currentProbabilityState->wasPutInTerminalQueue ) {
+			if ( !currentProbabilityState->wasPutInTerminalQueue() ) {
 				this->statesTerminatedLastIteration.emplace_back(currentProbabilityStatePair);
-				currentProbabilityState->wasPutInTerminalQueue = true;
+				currentProbabilityState->setPutInTerminalQueue(true);
 				++currentRow;
 				++currentRowGroup;
 			}
 			continue;
 		}
 
-		if (currentProbabilityState->wasPutInTerminalQueue) {
+		if (currentProbabilityState->wasPutInTerminalQueue()) {
 			// Mark as not put in terminal queue
 			// Note that it still will be IN the terminal queue, but
 			// that when we flush this queue, it will be ignored
-			currentProbabilityState->wasPutInTerminalQueue = false;
+			currentProbabilityState->setPutInTerminalQueue(false);
 		}
 
 		// We assume that if we make it here, our state is either nonterminal, or its reachability probability
 		// is greater than kappa
 		// Expand (explore next states)
-		storm::generator::StateBehavior<ValueType, StateType> behavior = generator->expand(stateToIdCallback);
+		storm::generator::StateBehavior<ValueType, StateType> behavior = this->expandState(currentIndex, stateToIdCallback);
 
 		auto stateRewardIt = behavior.getStateRewards().begin();
 		for (auto& rewardModelBuilder : rewardModelBuilders) {
@@ -205,10 +206,10 @@ StaminaIterativeModelBuilder<ValueType, RewardModelType, StateType>::buildMatric
 #endif // DIE_ON_DEADLOCK / WARN_ON_DEADLOCK
 			// If we are not yet aware that this is a deadlock state
 			// we should make future iterations aware of this
-			if (!currentProbabilityState->deadlock) {
+			if (!currentProbabilityState->isDeadlock()) {
 				this->createTransition(currentIndex, currentIndex, 1.0);
 				stateStorage.deadlockStateIndices.push_back(currentIndex);
-				currentProbabilityState->deadlock = true;
+				currentProbabilityState->setDeadlock(true);
 			}
 			continue;
 		}
@@ -266,7 +267,7 @@ StaminaIterativeModelBuilder<ValueType, RewardModelType, StateType>::buildMatric
 						nextProbabilityState->addToPi(currentProbabilityState->getPi() * probability);
 					}
 
-					if (currentProbabilityState->isNew) {
+					if (currentProbabilityState->isNew()) {
 						this->createTransition(currentIndex, sPrime, stateProbabilityPair.second);
 						// numberTransitions++;
 					}
@@ -284,7 +285,7 @@ StaminaIterativeModelBuilder<ValueType, RewardModelType, StateType>::buildMatric
 			firstChoiceOfState = false;
 		}
 
-		currentProbabilityState->isNew = false;
+		currentProbabilityState->setNew(false);
 #ifdef CHECK_TERMINAL_COUNT
 		uint32_t terminalCount = stateMap.getNumberTerminal();
 		if (terminalCount != numberTerminal) {
@@ -297,7 +298,7 @@ StaminaIterativeModelBuilder<ValueType, RewardModelType, StateType>::buildMatric
 		else if (currentProbabilityState->isTerminal()) {
 			StaminaMessages::errorAndExit("Number terminal should have been positive, but was zero! (State was marked terminal but not accounted for!");
 		}
-		currentProbabilityState->setTerminal(false);
+		stateMap.setTerminal(currentProbabilityState, false);
 		currentProbabilityState->setPi(0.0);
 
 		if (currentRow >= currentRowGroup) {
@@ -349,14 +350,15 @@ StaminaIterativeModelBuilder<ValueType, RewardModelType, StateType>::getOrAddSta
 	if (isInit) {
 		if (!stateIsExisting) {
 			// Create a ProbabilityState for each individual state
-			ProbabilityState<StateType> * initProbabilityState = memoryPool.allocate();
-			*initProbabilityState = ProbabilityState<StateType>(
+			ProbabilityState<StateType> * initProbabilityState = stateMap.put(
+				actualIndex
+				, ProbabilityState<StateType>(
 					actualIndex
 					, 1.0
 					, true
-					);
+				)
+			);
 			numberTerminal++;
-			stateMap.put(actualIndex, initProbabilityState);
 			statesToExplore.push_back(std::make_pair(initProbabilityState, state));
 			initProbabilityState->iterationLastSeen = iteration;
 		}
@@ -388,11 +390,13 @@ StaminaIterativeModelBuilder<ValueType, RewardModelType, StateType>::getOrAddSta
 		else {
 			// State does not exist yet in this iteration
 			// so we must create it
-			ProbabilityState<StateType> * nextProbabilityState = memoryPool.allocate();
-			*nextProbabilityState = ProbabilityState<StateType>(
+			ProbabilityState<StateType> * nextProbabilityState = stateMap.put(
 				actualIndex
-				, 0.0
-				, true
+				, ProbabilityState<StateType>(
+					actualIndex
+					, 0.0
+					, true
+				)
 			);
 			// Set the iteration last seen
 			nextProbabilityState->iterationLastSeen = iteration;
@@ -418,13 +422,14 @@ StaminaIterativeModelBuilder<ValueType, RewardModelType, StateType>::getOrAddSta
 		}
 		else {
 			// This state has not been seen so create a new ProbabilityState
-			ProbabilityState<StateType> * nextProbabilityState = memoryPool.allocate();
-			*nextProbabilityState = ProbabilityState<StateType>(
+			ProbabilityState<StateType> * nextProbabilityState = stateMap.put(
+				actualIndex
+				, ProbabilityState<StateType>(
 					actualIndex
 					, 0.0
 					, true
-					);
-			stateMap.put(actualIndex, nextProbabilityState);
+				)
+			);
 			nextProbabilityState->iterationLastSeen = iteration;
 			// exploredStates.emplace(actualIndex);
 			statesToExplore.push_back(std::make_pair(nextProbabilityState, state));
@@ -494,16 +499,20 @@ StaminaIterativeModelBuilder<ValueType, RewardModelType, StateType>::buildModelC
 
 		piHat = this->accumulateProbabilities();
 		innerLoopCount++;
+		// Lowering kappa cannot explore any further
+		if (this->isExplorationBudgetExhausted()) {
+			break;
+		}
 	}
 
 	// No remapping is necessary
 	this->purgeAbsorbingTransitions();
 	this->connectAllTerminalStatesToAbsorbing(transitionMatrixBuilder);
-	this->flushToTransitionMatrix(transitionMatrixBuilder);
+	this->flushToTransitionMatrix();
 
 	// Using the information from buildMatrices, initialize the model components
 	storm::storage::sparse::ModelComponents<ValueType, RewardModelType> modelComponents(
-			transitionMatrixBuilder.build(0, transitionMatrixBuilder.getCurrentRowGroupCount())
+			this->buildTransitionMatrix()
 			, this->buildStateLabeling()
 			, std::unordered_map<std::string, RewardModelType>()
 			, !generator->isDiscreteTimeModel()
@@ -542,14 +551,14 @@ StaminaIterativeModelBuilder<ValueType, RewardModelType, StateType>::flushStates
 		auto probabilityStatePair = this->statesTerminatedLastIteration.front();
 		// States can be marked as not put in terminal queue and when we flush the terminal queue we
 		// ignore those estates
-		if (! probabilityStatePair.first->wasPutInTerminalQueue) {
+		if (! probabilityStatePair.first->wasPutInTerminalQueue()) {
 			this->statesTerminatedLastIteration.pop_front();
 			continue;
 		}
 		statesToExplore.emplace_back(probabilityStatePair);
-		probabilityStatePair.first->wasPutInTerminalQueue = false;
+		probabilityStatePair.first->setPutInTerminalQueue(false);
 		this->statesTerminatedLastIteration.pop_front();
-		probabilityStatePair.first->isNew = true;
+		probabilityStatePair.first->setNew(true);
 	}
 }
 
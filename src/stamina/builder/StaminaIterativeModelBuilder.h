@@ -92,7 +92,6 @@ namespace stamina {
 			using StaminaModelBuilder<ValueType, RewardModelType, StateType>::expressionManager;
 			using StaminaModelBuilder<ValueType, RewardModelType, StateType>::propertyFormula;
 			using StaminaModelBuilder<ValueType, RewardModelType, StateType>::generator;
-			using StaminaModelBuilder<ValueType, RewardModelType, StateType>::memoryPool;
 			using StaminaModelBuilder<ValueType, RewardModelType, StateType>::statesToExplore;
 			using StaminaModelBuilder<ValueType, RewardModelType, StateType>::stateMap;
 			using StaminaModelBuilder<ValueType, RewardModelType, StateType>::stateStorage;
@@ -30,6 +30,7 @@
 #include "builder/threads/ExplorationThread.h"
 
 #include <functional>
+#include <future>
 #include <sstream>
 #include <algorithm>
 
@@ -72,7 +73,10 @@ StaminaModelBuilder<ValueType, RewardModelType, StateType>::StaminaModelBuilder(
 	, currentRowGroup(0)
 	, hasAbsorbingTransitions(false)
 {
-	// Intentionally left empty
+	// Cached successors do not keep choice labels or origins
+	if (options.isBuildChoiceLabelsSet() || options.isBuildChoiceOriginsSet()) {
+		successorCache.setCapacity(0);
+	}
 }
 
 template <typename ValueType, typename RewardModelType, typename StateType>
@@ -80,7 +84,7 @@ StaminaModelBuilder<ValueType, RewardModelType, StateType>::StaminaModelBuilder(
 	storm::prism::Program const& program
 	, storm::generator::NextStateGeneratorOptions const& generatorOptions
 ) : StaminaModelBuilder( // Invoke other constructor
-	std::make_shared<storm::generator::PrismNextStateGenerator<ValueType, StateType>>(program, generatorOptions)
+	stamina::generator::makeNextStateGenerator<ValueType, StateType>(program, generatorOptions)
 	, program
 	, generatorOptions
 )
@@ -137,6 +141,33 @@ StaminaModelBuilder<ValueType, RewardModelType, StateType>::getLocalKappa() {
 	return localKappa;
 }
 
+template <typename ValueType, typename RewardModelType, typename StateType>
+bool
+StaminaModelBuilder<ValueType, RewardModelType, StateType>::checkExplorationBudget(uint64_t numberOfStates) {
+	if (explorationBudget.isExhausted()) {
+		return true;
+	}
+	if (explorationBudget.check(numberOfStates, transitionsToAdd.getEntryCount())) {
+		StaminaMessages::warning(
+			"Reached the " + explorationBudget.getReason() + ". Remaining perimeter states will be connected to the absorbing state, so the bounds stay sound but may be wider than the probability window."
+		);
+		return true;
+	}
+	return false;
+}
+
+template <typename ValueType, typename RewardModelType, typename StateType>
+bool
+StaminaModelBuilder<ValueType, RewardModelType, StateType>::isExplorationBudgetExhausted() const {
+	return explorationBudget.isExhausted();
+}
+
+template <typename ValueType, typename RewardModelType, typename StateType>
+util::ExplorationBudget const &
+StaminaModelBuilder<ValueType, RewardModelType, StateType>::getExplorationBudget() const {
+	return explorationBudget;
+}
+
 template <typename ValueType, typename RewardModelType, typename StateType>
 StateType
 StaminaModelBuilder<ValueType, RewardModelType, StateType>::getOrAddStateIndex(
@@ -174,35 +205,65 @@ StaminaModelBuilder<ValueType, RewardModelType, StateType>::getStateIndexOrAbsor
 
 template <typename ValueType, typename RewardModelType, typename StateType>
 void
-StaminaModelBuilder<ValueType, RewardModelType, StateType>::flushToTransitionMatrix(storm::storage::SparseMatrixBuilder<ValueType>& transitionMatrixBuilder) {
-	for (StateType row = 0; row < transitionsToAdd.size(); ++row) {
-		if (transitionsToAdd[row].empty() && row != 0) {
+StaminaModelBuilder<ValueType, RewardModelType, StateType>::flushToTransitionMatrix() {
+	auto writeRow = [&](StateType row) {
+		if (transitionsToAdd.getRowEntryCount(row) == 0 && getRateToAbsorbing(row) == 0 && row != 0) {
 			// This state is deadlock
 			StaminaMessages::errorAndExit("State " + std::to_string(row) + " did not have any successive transitions!");
-			// transitionMatrixBuilder.addNextValue(row, row, 1);
 		}
-		else {
-			for (TransitionInfo & tInfo : transitionsToAdd[row]) {
-				if (tInfo.transition == 0.0) {
-					continue;
-				}
-				transitionMatrixBuilder.addNextValue(tInfo.from, tInfo.to, tInfo.transition);
-			}
+		incrementalMatrix.replaceRow(row, transitionsToAdd, getRateToAbsorbing(row));
+	};
+	if (Options::incremental_matrix) {
+		// Only rows which changed since the last flush need to be rewritten
+		for (StateType row : dirtyRows) {
+			rowIsDirty[row] = false;
+			writeRow(row);
 		}
-		// Remove all transitions to the absorbing state
-		transitionsToAdd[row].erase(
-			std::remove_if(
-				transitionsToAdd[row].begin()
-				, transitionsToAdd[row].end()
-				, [&](TransitionInfo t) {
-					return t.to == 0;
-				}
-			)
-			, transitionsToAdd[row].end()
-		);
+		dirtyRows.clear();
+	}
+	else {
+		// Every row is written once and in order, so the rows are laid out exactly as CSR
+		incrementalMatrix.clear();
+		for (StateType row = 0; row < transitionsToAdd.getRowCount(); ++row) {
+			writeRow(row);
+		}
+	}
+	// Transitions into the absorbing state will not be valid next iteration. In incremental
+	// mode, this marks their rows dirty again.
+	clearTransitionsToAbsorbing();
+	hasAbsorbingTransitions = false;
+	// Perimeter states which are explored next iteration get overflow segments, so keep the
+	// store close to row order
+	transitionsToAdd.compactIfFragmented();
+}
 
+template <typename ValueType, typename RewardModelType, typename StateType>
+storm::storage::SparseMatrix<ValueType>
+StaminaModelBuilder<ValueType, RewardModelType, StateType>::buildTransitionMatrix() {
+	uint64_t rowCount = transitionsToAdd.getRowCount();
+	if (!Options::incremental_matrix) {
+		return incrementalMatrix.release(rowCount);
+	}
+	// New rows must have been written by flushToTransitionMatrix
+	for (StateType row = incrementalMatrix.getRowCount(); row < rowCount; ++row) {
+		if (row != 0 && incrementalMatrix.getRowEntryCount(row) == 0) {
+			StaminaMessages::errorAndExit("State " + std::to_string(row) + " did not have any successive transitions!");
+		}
+	}
+	StaminaMessages::info("Rewrote " + std::to_string(incrementalMatrix.getNumberOfRowsRewritten()) + " of " + std::to_string(rowCount) + " rows in transition matrix.");
+	return incrementalMatrix.build(rowCount);
+}
+
+template <typename ValueType, typename RewardModelType, typename StateType>
+void
+StaminaModelBuilder<ValueType, RewardModelType, StateType>::markRowDirty(StateType row) {
+	if (rowIsDirty.size() <= row) {
+		rowIsDirty.resize(std::max(static_cast<std::size_t>(row) + 1, rowIsDirty.size() * 2), false);
+	}
+	if (!rowIsDirty[row]) {
+		rowIsDirty[row] = true;
+		dirtyRows.push_back(row);
 	}
-	// transitionsToAdd.clear();
 }
 
 template <typename ValueType, typename RewardModelType, typename StateType>
@@ -212,40 +273,68 @@ StaminaModelBuilder<ValueType, RewardModelType, StateType>::createTransition(Sta
 		StaminaMessages::warning("Will not create transition of probability 0 from state " + std::to_string(from) + " to " + std::to_string(to));
 		return;
 	}
-	TransitionInfo tInfo(from, to, probability);
 	// Create an element for both from and to
-	while (transitionsToAdd.size() <= std::max(from, to)) {
-		transitionsToAdd.push_back(std::vector<TransitionInfo>());
-	}
+	transitionsToAdd.addRows(static_cast<uint64_t>(std::max(from, to)) + 1);
 	numberTransitions++;
+	if (to == 0) {
+		createTransitionToAbsorbing(from, probability);
+		return;
+	}
 #ifdef STAMINA_CHECK_TRANSITION_LIST
 	// Quick check
-	for (auto & trans : transitionsToAdd[from]) {
-		if (trans.from != from) {
-			StaminaMessages::errorAndExit("Transition list is malformed!");
-		}
-		if (trans.to == to) {
-			// StaminaMessages::warning("Attempting to create transition to a state there is already a transition to!\n\tFrom: " + std::to_string(from) + " To: " + std::to_string(to) + " Rates: " + std::to_string(probability) + " / " + std::to_string(trans.transition) );
-			if (trans.transition != probability) {
+	bool alreadyExists = false;
+	transitionsToAdd.forEachTransition(from, [&](auto const & trans) {
+		if (trans.to == to && !alreadyExists) {
+			// StaminaMessages::warning("Attempting to create transition to a state there is already a transition to!\n\tFrom: " + std::to_string(from) + " To: " + std::to_string(to) + " Rates: " + std::to_string(probability) + " / " + std::to_string(trans.rate) );
+			if (trans.rate != probability) {
 				StaminaMessages::error("The transitions should have the same probability but do not!");
 			}
-			// trans.transition += probability;
-			return;
+			alreadyExists = true;
 		}
+	});
+	if (alreadyExists) {
+		return;
 	}
 #else
 	// We will spot check the transition before this one
-	int numberTransitionsForCurrentState = transitionsToAdd[from].size();
-	if (numberTransitionsForCurrentState > 0) {
-		auto & lastTransition = transitionsToAdd[from][numberTransitionsForCurrentState - 1];
-		if (lastTransition.to == to && lastTransition.from == from && lastTransition.transition == probability) {
+	auto lastTransition = transitionsToAdd.back(from);
+	if (lastTransition != nullptr && lastTransition->to == to && lastTransition->rate == probability) {
+		return;
+	}
+#endif // STAMINA_CHECK_TRANSITION_LIST
+	transitionsToAdd.append(from, to, probability);
+	if (Options::incremental_matrix) {
+		markRowDirty(from);
+	}
+}
+
+template <typename ValueType, typename RewardModelType, typename StateType>
+void
+StaminaModelBuilder<ValueType, RewardModelType, StateType>::createTransitions(std::vector<TransitionInfo> && transitions) {
+	if (transitions.empty()) {
+		return;
+	}
+	StateType from = transitions.front().from;
+	StateType maxState = from;
+	for (auto const & tInfo : transitions) {
+		if (tInfo.from != from || tInfo.transition == 0 || tInfo.to == 0) {
+			// Not a batch we can take over as a whole
+			for (auto const & transition : transitions) {
+				createTransition(transition);
+			}
+			transitions.clear();
 			return;
 		}
+		maxState = std::max(maxState, tInfo.to);
+	}
+	// Create an element for both from and to
+	transitionsToAdd.addRows(static_cast<uint64_t>(maxState) + 1);
+	numberTransitions += transitions.size();
+	transitionsToAdd.append(from, transitions);
+	transitions.clear();
+	if (Options::incremental_matrix) {
+		markRowDirty(from);
 	}
-#endif // STAMINA_CHECK_TRANSITION_LIST
-	// auto & it = tra
-	transitionsToAdd[from].push_back(tInfo);
-	// transitionsToAdd[from].sort(); // TODO: Change
 }
 
 template <typename ValueType, typename RewardModelType, typename StateType>
@@ -259,17 +348,24 @@ StaminaModelBuilder<ValueType, RewardModelType, StateType>::createTransition(
 	}
 	numberTransitions++;
 	// Create an element for both from and to
-	while (transitionsToAdd.size() <= std::max(transitionInfo.from, transitionInfo.to)) {
-		transitionsToAdd.push_back(std::vector<TransitionInfo>());
+	transitionsToAdd.addRows(static_cast<uint64_t>(std::max(transitionInfo.from, transitionInfo.to)) + 1);
+	if (transitionInfo.to == 0) {
+		createTransitionToAbsorbing(transitionInfo.from, transitionInfo.transition);
+		return;
+	}
+	transitionsToAdd.append(transitionInfo.from, transitionInfo.to, transitionInfo.transition);
+	if (Options::incremental_matrix) {
+		markRowDirty(transitionInfo.from);
 	}
-	transitionsToAdd[transitionInfo.from].push_back(transitionInfo);
-
 }
 
 template <typename ValueType, typename RewardModelType, typename StateType>
 void
 StaminaModelBuilder<ValueType, RewardModelType, StateType>::printStateSpaceInformation() {
 	StaminaMessages::info("Finished state space truncation.\n\tExplored " + std::to_string(numberStates) + " states in total.\n\tGot " + std::to_string(numberTransitions) + " transitions.");
+	if (successorCache.getNumberOfHits() + successorCache.getNumberOfMisses() > 0) {
+		StaminaMessages::info("Successor cache: " + std::to_string(successorCache.getNumberOfHits()) + " hits, " + std::to_string(successorCache.getNumberOfMisses()) + " misses, " + std::to_string(successorCache.getNumberOfEvictions()) + " evictions.");
+	}
 }
 
 
@@ -370,22 +466,54 @@ StaminaModelBuilder<ValueType, RewardModelType, StateType>::connectTerminalState
 	, CompressedState const & terminalState
 	, StateType stateId
 	, std::function<StateType (CompressedState const&)> stateToIdCallback
+) {
+	perimeterTransitions.clear();
+	if (!expandPerimeterState(*generator, successorCache, terminalState, stateId, stateToIdCallback, perimeterTransitions)) {
+		connectDeadlockPerimeterState(stateId);
+		return;
+	}
+	hasAbsorbingTransitions = true;
+	for (auto const & transition : perimeterTransitions) {
+		createTransition(transition.from, transition.to, transition.transition);
+	}
+}
+
+template <typename ValueType, typename RewardModelType, typename StateType>
+bool
+StaminaModelBuilder<ValueType, RewardModelType, StateType>::expandPerimeterState(
+	storm::generator::PrismNextStateGenerator<ValueType, StateType> & generator
+	, util::SuccessorCache<ValueType, StateType> & successorCache
+	, CompressedState const & terminalState
+	, StateType stateId
+	, std::function<StateType (CompressedState const&)> const & stateToIdCallback
+	, std::vector<TransitionInfo> & transitions
 ) {
 	bool addedValue = false;
-	generator->load(terminalState);
-	storm::generator::StateBehavior<ValueType, StateType> behavior = generator->expand(stateToIdCallback);
+	// A state which stays on the perimeter is connected again next iteration, so it is kept
+	storm::generator::StateBehavior<ValueType, StateType> behavior;
+	if (!successorCache.replay(stateId, stateToIdCallback, behavior, true)) {
+		// A generator shared between threads is given the state rather than having it loaded
+		auto threadsafeGenerator = dynamic_cast<threadsafe::generator::ThreadsafePrismNextStateGenerator<ValueType, StateType> *>(&generator);
+		if (threadsafeGenerator) {
+			auto expand = [&](std::function<StateType (CompressedState const&)> const & callback) {
+				return threadsafeGenerator->expand(terminalState, callback);
+			};
+			behavior = successorCache.isEnabled() ? successorCache.record(expand, stateId, stateToIdCallback) : expand(stateToIdCallback);
+		}
+		else {
+			generator.load(terminalState);
+			if (successorCache.isEnabled()) {
+				behavior = successorCache.record(generator, stateId, stateToIdCallback);
+			}
+			else {
+				behavior = generator.expand(stateToIdCallback);
+			}
+		}
+	}
 	// If there is no behavior, we have an error.
 	if (behavior.empty()) {
-#if defined DIE_ON_DEADLOCK
-		StaminaMessages::errorAndExit("Behavior for perimeter state (id = " + std::to_string(stateId) + ") was empty!");
-#elif defined WARN_ON_DEADLOCK
-		StaminaMessages::warning("Behavior for perimeter state (id = " + std::to_string(stateId) + ") was empty!");
-#endif // DIE_ON_DEADLOCK
-		stateStorage.deadlockStateIndices.push_back(stateId);
-		createTransition(stateId, stateId, 1.0); // Create Self-loop
-		return;
+		return false;
 	}
-	hasAbsorbingTransitions = true;
 	bool firstChoice = true;
 	for (auto const& choice : behavior) {
 		if (!firstChoice) {
@@ -395,7 +523,7 @@ StaminaModelBuilder<ValueType, RewardModelType, StateType>::connectTerminalState
 		for (auto const& stateProbabilityPair : choice) {
 			if (stateProbabilityPair.first != 0) {
 				// row, column, value
-				createTransition(stateId, stateProbabilityPair.first, stateProbabilityPair.second);
+				transitions.emplace_back(stateId, stateProbabilityPair.first, stateProbabilityPair.second);
 			}
 			else {
 				totalRateToAbsorbing += stateProbabilityPair.second;
@@ -405,13 +533,40 @@ StaminaModelBuilder<ValueType, RewardModelType, StateType>::connectTerminalState
 		// Absorbing state. We wrap it in this if statement to not create useless transitions
 		// In case the perimeter state just loops back into all existing states
 		if (totalRateToAbsorbing != 0) {
-			createTransition(stateId, 0, totalRateToAbsorbing);
+			transitions.emplace_back(stateId, 0, totalRateToAbsorbing);
 		}
 		firstChoice = false;
 	}
 	if (!addedValue) {
 		StaminaMessages::errorAndExit("Did not add to transition matrix!");
 	}
+	return true;
+}
+
+template <typename ValueType, typename RewardModelType, typename StateType>
+storm::generator::StateBehavior<ValueType, StateType>
+StaminaModelBuilder<ValueType, RewardModelType, StateType>::expandState(
+	StateType stateIndex
+	, std::function<StateType (CompressedState const&)> const & stateToIdCallback
+) {
+	storm::generator::StateBehavior<ValueType, StateType> behavior;
+	// Once explored, the state is no longer on the perimeter, so its entry is dropped
+	if (successorCache.replay(stateIndex, stateToIdCallback, behavior, false)) {
+		return behavior;
+	}
+	return generator->expand(stateToIdCallback);
+}
+
+template <typename ValueType, typename RewardModelType, typename StateType>
+void
+StaminaModelBuilder<ValueType, RewardModelType, StateType>::connectDeadlockPerimeterState(StateType stateId) {
+#if defined DIE_ON_DEADLOCK
+	StaminaMessages::errorAndExit("Behavior for perimeter state (id = " + std::to_string(stateId) + ") was empty!");
+#elif defined WARN_ON_DEADLOCK
+	StaminaMessages::warning("Behavior for perimeter state (id = " + std::to_string(stateId) + ") was empty!");
+#endif // DIE_ON_DEADLOCK
+	stateStorage.deadlockStateIndices.push_back(stateId);
+	createTransition(stateId, stateId, 1.0); // Create Self-loop
 }
 
 template <typename ValueType, typename RewardModelType, typename StateType>
@@ -485,10 +640,47 @@ StaminaModelBuilder<ValueType, RewardModelType, StateType>::loadPropertyExpressi
 		)
 	);
 	rightPropertyExpression = rightExpression;
+	auto compiledLeft = std::make_unique<stamina::generator::CompiledStateExpression<ValueType>>(
+		*leftPropertyExpression
+		, generator->getVariableInformation()
+	);
+	auto compiledRight = std::make_unique<stamina::generator::CompiledStateExpression<ValueType>>(
+		*rightPropertyExpression
+		, generator->getVariableInformation()
+	);
+	if (compiledLeft->isCompiled() && compiledRight->isCompiled()) {
+		compiledLeftPropertyExpression = std::move(compiledLeft);
+		compiledRightPropertyExpression = std::move(compiledRight);
+	}
+	else {
+		StaminaMessages::info(
+			"Could not compile property expression ("
+			+ (compiledLeft->isCompiled() ? compiledRight : compiledLeft)->getUnsupportedReason()
+			+ "). Evaluating it through storm."
+		);
+		compiledLeftPropertyExpression.reset();
+		compiledRightPropertyExpression.reset();
+	}
 	// Set this flag so that we know we've already done it.
 	formulaMatchesExpression = true;
 }
 
+template <typename ValueType, typename RewardModelType, typename StateType>
+std::pair<bool, bool>
+StaminaModelBuilder<ValueType, RewardModelType, StateType>::evaluatePropertyExpressions(CompressedState const & state) {
+	if (compiledLeftPropertyExpression) {
+		return std::make_pair(
+			compiledLeftPropertyExpression->evaluateAsBool(state)
+			, compiledRightPropertyExpression->evaluateAsBool(state)
+		);
+	}
+	storm::expressions::SimpleValuation valuation = generator->currentStateToSimpleValuation();
+	return std::make_pair(
+		leftPropertyExpression->evaluateAsBool(&valuation)
+		, rightPropertyExpression->evaluateAsBool(&valuation)
+	);
+}
+
 template <typename ValueType, typename RewardModelType, typename StateType>
 storm::storage::sparse::StateStorage<StateType> &
 StaminaModelBuilder<ValueType, RewardModelType, StateType>::getStateStorage() const {
@@ -503,9 +695,37 @@ StaminaModelBuilder<ValueType, RewardModelType, StateType>::getExplorationThread
 }
 
 template <typename ValueType, typename RewardModelType, typename StateType>
-util::StateMemoryPool<ProbabilityState<StateType>> &
-StaminaModelBuilder<ValueType, RewardModelType, StateType>::getMemoryPool() {
-	return memoryPool;
+void
+StaminaModelBuilder<ValueType, RewardModelType, StateType>::setExplorationPool(
+	std::shared_ptr<threads::ExplorationThreadPool<ValueType, StateType>> explorationPool
+) {
+	this->explorationPool = explorationPool;
+}
+
+template <typename ValueType, typename RewardModelType, typename StateType>
+threads::ExplorationThreadPool<ValueType, StateType> *
+StaminaModelBuilder<ValueType, RewardModelType, StateType>::getExplorationPool() const {
+	return explorationPool.get();
+}
+
+template <typename ValueType, typename RewardModelType, typename StateType>
+void
+StaminaModelBuilder<ValueType, RewardModelType, StateType>::setMinimumPerimeterStatesPerGenerator(
+	std::size_t minimumPerimeterStatesPerGenerator
+) {
+	this->minimumPerimeterStatesPerGenerator = minimumPerimeterStatesPerGenerator;
+}
+
+template <typename ValueType, typename RewardModelType, typename StateType>
+void
+StaminaModelBuilder<ValueType, RewardModelType, StateType>::setGeneratorsVector(
+	std::vector<std::shared_ptr<storm::generator::PrismNextStateGenerator<ValueType, StateType>>> const & generators
+) {
+	// Check the size
+	if (generators.size() != Options::threads) {
+		StaminaMessages::errorAndExit("Generators vector size does not match thread count!");
+	}
+	this->generators = generators;
 }
 
 template <typename ValueType, typename RewardModelType, typename StateType>
@@ -545,13 +765,17 @@ StaminaModelBuilder<ValueType, RewardModelType, StateType>::printTransitionActio
 		StaminaMessages::warning("Transition file is empty! Defaulting to \"export.tra\"");
 		Options::export_trans = "export.tra";
 	}
-	if (transitionsToAdd.size() == 0) {
+	if (transitionsToAdd.getRowCount() == 0) {
 		StaminaMessages::error("Cannot call printTransitionActions() AFTER model checking!");
 	}
 	std::ofstream out(Options::export_trans);
-	for (auto & transitionBucket : transitionsToAdd) {
-		for (auto & transition : transitionBucket) {
-			out << transition.from << " " << transition.to << " " << transition.transition << std::endl;
+	for (StateType row = 0; row < transitionsToAdd.getRowCount(); ++row) {
+		transitionsToAdd.forEachTransition(row, [&](auto const & transition) {
+			ValueType rate = transition.rate;
+			out << row << " " << transition.to << " " << rate << std::endl;
+		});
+		if (getRateToAbsorbing(row) != 0) {
+			out << row << " " << 0 << " " << getRateToAbsorbing(row) << std::endl;
 		}
 	}
 	out.close();
@@ -563,14 +787,44 @@ StaminaModelBuilder<ValueType, RewardModelType, StateType>::purgeAbsorbingTransi
 	if (!hasAbsorbingTransitions) {
 		return;
 	}
-	for (auto & transitionBucket : transitionsToAdd) {
-		for (auto & transition : transitionBucket) {
-			if (transition.to == 0) {
-				transition.transition = 0.0;
-			}
+	clearTransitionsToAbsorbing();
+	hasAbsorbingTransitions = false;
+}
+
+template <typename ValueType, typename RewardModelType, typename StateType>
+void
+StaminaModelBuilder<ValueType, RewardModelType, StateType>::createTransitionToAbsorbing(StateType from, ValueType rate) {
+	if (rateToAbsorbing.size() <= from) {
+		rateToAbsorbing.resize(std::max(static_cast<std::size_t>(from) + 1, rateToAbsorbing.size() * 2), 0);
+	}
+	if (rateToAbsorbing[from] == 0) {
+		rowsToAbsorbing.push_back(from);
+	}
+	rateToAbsorbing[from] += rate;
+	if (Options::incremental_matrix) {
+		markRowDirty(from);
+	}
+}
+
+template <typename ValueType, typename RewardModelType, typename StateType>
+ValueType
+StaminaModelBuilder<ValueType, RewardModelType, StateType>::getRateToAbsorbing(StateType row) const {
+	if (row >= rateToAbsorbing.size()) {
+		return 0;
+	}
+	return rateToAbsorbing[row];
+}
+
+template <typename ValueType, typename RewardModelType, typename StateType>
+void
+StaminaModelBuilder<ValueType, RewardModelType, StateType>::clearTransitionsToAbsorbing() {
+	for (StateType row : rowsToAbsorbing) {
+		rateToAbsorbing[row] = 0;
+		if (Options::incremental_matrix) {
+			markRowDirty(row);
 		}
 	}
-	hasAbsorbingTransitions = false;
+	rowsToAbsorbing.clear();
 }
 
 // Explicitly instantiate the class.
@@ -587,26 +841,69 @@ void
 StaminaModelBuilder<ValueType, RewardModelType, StateType>::connectAllTerminalStatesToAbsorbing(
 	storm::storage::SparseMatrixBuilder<ValueType>& transitionMatrixBuilder
 ) {
-// 	std::cout << "connecting all terminal states to absorbing" << std::endl;
-// 	std::cout << "The number of states to connect is " << statesTerminatedLastIteration.size() << "." << std::endl;
+	// Perimeter states which were explored since they were enqueued are no longer terminal
+	std::vector<std::pair<ProbabilityState<StateType> *, CompressedState>> perimeter;
+	perimeter.reserve(statesTerminatedLastIteration.size());
+	for (auto & terminated : statesTerminatedLastIteration) {
+		if (!terminated.first->wasPutInTerminalQueue()) {
+			continue;
+		}
+		terminated.first->setPutInTerminalQueue(false);
+		perimeter.push_back(std::move(terminated));
+	}
+	statesTerminatedLastIteration.clear();
 	// The perimeter states require a second custom stateToIdCallback which does not enqueue or
 	// register new states
-	while (!statesTerminatedLastIteration.empty()) {
-		auto currentProbabilityState = statesTerminatedLastIteration.front().first;
-		auto state = statesTerminatedLastIteration.front().second;
-		if (!currentProbabilityState->wasPutInTerminalQueue) {
-			statesTerminatedLastIteration.pop_front();
-			continue;
+	if (explorationPool == nullptr
+		|| generators.size() < 2
+		|| perimeter.size() < generators.size() * minimumPerimeterStatesPerGenerator
+	) {
+		for (auto const & [currentProbabilityState, state] : perimeter) {
+			this->connectTerminalStatesToAbsorbing(
+				transitionMatrixBuilder
+				, state
+				, currentProbabilityState->index
+				, this->terminalStateToIdCallback
+			);
+		}
+		return;
+	}
+	// terminalStateToIdCallback only reads stateStorage, so each part can be expanded by its own
+	// generator at the same time. Each part is a contiguous slice of the perimeter.
+	std::size_t numberOfParts = generators.size();
+	std::vector<std::vector<TransitionInfo>> partTransitions(numberOfParts);
+	std::vector<std::vector<StateType>> partDeadlocks(numberOfParts);
+	std::vector<std::future<void>> jobs;
+	jobs.reserve(numberOfParts);
+	for (std::size_t part = 0; part < numberOfParts; ++part) {
+		std::size_t begin = perimeter.size() * part / numberOfParts;
+		std::size_t end = perimeter.size() * (part + 1) / numberOfParts;
+		jobs.push_back(explorationPool->submit([&, part, begin, end] {
+			auto & partGenerator = *generators[part];
+			// Most perimeter states have only a few successors
+			partTransitions[part].reserve((end - begin) * 4);
+			for (std::size_t i = begin; i < end; ++i) {
+				StateType stateId = perimeter[i].first->index;
+				if (!expandPerimeterState(partGenerator, successorCache, perimeter[i].second, stateId, terminalStateToIdCallback, partTransitions[part])) {
+					partDeadlocks[part].push_back(stateId);
+				}
+			}
+		}));
+	}
+	for (auto & job : jobs) {
+		job.get();
+	}
+	// Merge in perimeter order, so each row is still appended in one piece
+	for (std::size_t part = 0; part < numberOfParts; ++part) {
+		if (!partTransitions[part].empty()) {
+			hasAbsorbingTransitions = true;
+		}
+		for (auto const & transition : partTransitions[part]) {
+			createTransition(transition.from, transition.to, transition.transition);
+		}
+		for (StateType stateId : partDeadlocks[part]) {
+			connectDeadlockPerimeterState(stateId);
 		}
-		currentProbabilityState->wasPutInTerminalQueue = false;
-// 		std::cout << "Connecting state " << StateSpaceInformation::stateToString(currentProbabilityState->state, 0) << " to terminal" << std::endl;
-		this->connectTerminalStatesToAbsorbing(
-			transitionMatrixBuilder
-			, state
-			, currentProbabilityState->index
-			, this->terminalStateToIdCallback
-		);
-		statesTerminatedLastIteration.pop_front();
 	}
 }
 
@@ -46,9 +46,17 @@
 #include "core/StaminaMessages.h"
 
 #include "util/StateIndexArray.h"
-#include "util/StateMemoryPool.h"
+#include "util/IncrementalSparseMatrix.h"
+#include "util/TransitionStore.h"
+#include "util/SuccessorCache.h"
+#include "util/ExplorationBudget.h"
+
+#include "generator/CompiledPrismNextStateGenerator.h"
+#include "generator/CompiledStateExpression.h"
+#include "threadsafe/generator/ThreadsafePrismNextStateGenerator.h"
 
 #include "builder/threads/BaseThread.h"
+#include "builder/threads/ExplorationThreadPool.h"
 
 #include "builder/ProbabilityState.h"
 #include "builder/StateAndTransitions.h"
@@ -172,16 +180,50 @@ namespace stamina {
 			StateType getStateIndexOrAbsorbing(CompressedState const& state);
 			double getLocalKappa();
 			uint8_t getIteration();
-			util::StateMemoryPool<ProbabilityState<StateType>> & getMemoryPool();
 			std::shared_ptr<storm::generator::PrismNextStateGenerator<ValueType, StateType>> getGenerator();
 			storm::storage::sparse::StateStorage<StateType> & getStateStorage() const;
 			virtual std::vector<typename threads::ExplorationThread<ValueType, RewardModelType, StateType> *> const & getExplorationThreads() const;
+			/**
+			 * Sets the (long-lived) pool the threads of this builder run on. If no pool is set, each
+			 * thread runs on a std::thread of its own.
+			 *
+			 * @param explorationPool The pool, owned by the model checker
+			 * */
+			void setExplorationPool(std::shared_ptr<threads::ExplorationThreadPool<ValueType, StateType>> explorationPool);
+			/**
+			 * Gets the pool the threads of this builder run on
+			 *
+			 * @return The pool, or nullptr if there is none
+			 * */
+			threads::ExplorationThreadPool<ValueType, StateType> * getExplorationPool() const;
+			/**
+			 * Sets a vector of generators, one per exploration thread. Threaded builders give one to each
+			 * exploration thread, and connectAllTerminalStatesToAbsorbing() splits the perimeter across them.
+			 * The generators are shared (not copied), so they may be reused by later builders.
+			 *
+			 * @param generators The generators to use
+			 * */
+			void setGeneratorsVector(std::vector<std::shared_ptr<storm::generator::PrismNextStateGenerator<ValueType, StateType>>> const & generators);
+			/**
+			 * Sets how many perimeter states each generator must get before connectAllTerminalStatesToAbsorbing()
+			 * expands them in parallel. Below that, dispatching jobs costs more than it saves.
+			 *
+			 * @param minimumPerimeterStatesPerGenerator The number of states (256 by default)
+			 * */
+			void setMinimumPerimeterStatesPerGenerator(std::size_t minimumPerimeterStatesPerGenerator);
 			/**
 			 * Inserts a TransitionInfo into transitionsToAdd. This method must NOT be called
 			 * after flushToTransitionMatrix has cleared transitionsToAdd
 			 * */
 			void createTransition(StateType from, StateType to, ValueType probability);
 			void createTransition(TransitionInfo transitionInfo);
+			/**
+			 * Inserts a batch of transitions which all go out of the same state. The batch is appended to
+			 * transitionsToAdd as a single contiguous run.
+			 *
+			 * @param transitions The transitions to insert. Left empty after the call.
+			 * */
+			void createTransitions(std::vector<TransitionInfo> && transitions);
 
 			util::StateIndexArray<StateType, ProbabilityState<StateType>> & getStateMap();
 			/**
@@ -198,12 +240,59 @@ namespace stamina {
 			 * */
 			uint64_t getStateCount();
 			uint64_t getTransitionCount();
+			/**
+			 * Checks the exploration budget (Options::max_states, max_transitions and max_memory). Builders
+			 * check it before expanding a perimeter state, and leave perimeter states unexpanded once it is
+			 * exhausted. Must only be called by the thread which creates transitions.
+			 *
+			 * @param numberOfStates The number of states found so far
+			 * @return Whether the budget is exhausted
+			 * */
+			bool checkExplorationBudget(uint64_t numberOfStates);
+			/**
+			 * Whether the exploration budget was exhausted. Safe to call from exploration threads.
+			 * */
+			bool isExplorationBudgetExhausted() const;
+			util::ExplorationBudget const & getExplorationBudget() const;
 		protected:
+			/**
+			 * Drops all transitions into the absorbing state, if any were created by
+			 * connectTerminalStatesToAbsorbing(). Since they are kept apart from transitionsToAdd,
+			 * this only touches the rows which have such a transition.
+			 * */
 			void purgeAbsorbingTransitions();
 			/**
-			* Creates and loads the property expression from the formula
+			 * Adds to the rate from a state into the absorbing state
+			 *
+			 * @param from The state the transition goes out of
+			 * @param rate The rate to add
+			 * */
+			void createTransitionToAbsorbing(StateType from, ValueType rate);
+			/**
+			 * Gets the total rate from a state into the absorbing state
+			 *
+			 * @param row The state
+			 * @return The rate (0 if there is no such transition)
+			 * */
+			ValueType getRateToAbsorbing(StateType row) const;
+			/**
+			 * Removes every transition into the absorbing state. In incremental mode, the rows they
+			 * were in are marked dirty.
+			 * */
+			void clearTransitionsToAbsorbing();
+			/**
+			* Creates and loads the property expression from the formula, and compiles phi1 and phi2
+			* so that they can be evaluated without unpacking states
 			* */
 			void loadPropertyExpressionFromFormula();
+			/**
+			 * Evaluates phi1 and phi2 of the property in a state. Uses the compiled expressions if both could
+			 * be compiled, and otherwise storm's, in which case the state must be loaded in the generator.
+			 *
+			 * @param state The state
+			 * @return phi1(s) and phi2(s)
+			 * */
+			std::pair<bool, bool> evaluatePropertyExpressions(CompressedState const & state);
 			/**
 			* Connects all terminal states to the absorbing state
 			* */
@@ -214,9 +303,51 @@ namespace stamina {
 				, std::function<StateType (CompressedState const&)> stateToIdCallback
 			);
 			/**
-			 * Connects all states which are terminal
+			 * Connects all states which are terminal. If the builder has an exploration pool and more than
+			 * one generator, the perimeter is split across the generators and expanded in parallel, and the
+			 * transitions of each part are merged in afterwards.
 			 * */
 			void connectAllTerminalStatesToAbsorbing(storm::storage::SparseMatrixBuilder<ValueType>& transitionMatrixBuilder);
+			/**
+			 * Expands a perimeter state and puts its transitions (with all transitions to states which
+			 * do not exist merged into one to the absorbing state) in a buffer. Does not modify the builder,
+			 * so it may be called from several threads at once, as long as each uses its own buffer, and either its
+			 * own generator or a shared ThreadsafePrismNextStateGenerator.
+			 *
+			 * @param generator The generator to expand with
+			 * @param successorCache Where the successors of the state are looked up, or cached if they are not there
+			 * @param terminalState The perimeter state
+			 * @param stateId The index of the perimeter state
+			 * @param stateToIdCallback A callback which must not add states
+			 * @param transitions The buffer to put the transitions in
+			 * @return Whether the state had any behavior. If not, it is deadlock and nothing was put in the buffer.
+			 * */
+			static bool expandPerimeterState(
+				storm::generator::PrismNextStateGenerator<ValueType, StateType> & generator
+				, util::SuccessorCache<ValueType, StateType> & successorCache
+				, CompressedState const & terminalState
+				, StateType stateId
+				, std::function<StateType (CompressedState const&)> const & stateToIdCallback
+				, std::vector<TransitionInfo> & transitions
+			);
+			/**
+			 * Expands the state which is loaded in `generator`. If the state was on the perimeter and its
+			 * successors are still in the successor cache, they are taken from there instead.
+			 *
+			 * @param stateIndex The index of the loaded state
+			 * @param stateToIdCallback The callback to give the successors to
+			 * @return The behavior of the state
+			 * */
+			storm::generator::StateBehavior<ValueType, StateType> expandState(
+				StateType stateIndex
+				, std::function<StateType (CompressedState const&)> const & stateToIdCallback
+			);
+			/**
+			 * Makes a perimeter state without any behavior a deadlock state with a self-loop
+			 *
+			 * @param stateId The index of the perimeter state
+			 * */
+			void connectDeadlockPerimeterState(StateType stateId);
 			/**
 			* Builds transition matrix of truncated state space for the given program.
 			*
@@ -234,11 +365,25 @@ namespace stamina {
 				, boost::optional<storm::storage::sparse::StateValuationsBuilder>& stateValuationsBuilder
 			) = 0;
 			/**
-			 * Flushes the elements in transitionsToAdd into the transition matrix
+			 * Flushes the elements in transitionsToAdd (and the transitions into the absorbing state)
+			 * into CSR rows, then drops the transitions into the absorbing state. Without
+			 * Options::incremental_matrix every row is written in order; with it, only the dirty rows are.
+			 * */
+			void flushToTransitionMatrix();
+			/**
+			 * Builds the transition matrix from the rows written by flushToTransitionMatrix. Without
+			 * Options::incremental_matrix, the CSR vectors are moved into the matrix rather than copied;
+			 * with it, the rows are kept for the next iteration.
+			 *
+			 * @return The transition matrix for the truncated model
+			 * */
+			storm::storage::SparseMatrix<ValueType> buildTransitionMatrix();
+			/**
+			 * Marks a row as needing to be rewritten in the incremental matrix
 			 *
-			 * @param transitionMatrixBuilder The transition matrix builder
+			 * @param row The row (state index) whose transitions changed
 			 * */
-			void flushToTransitionMatrix(storm::storage::SparseMatrixBuilder<ValueType>& transitionMatrixBuilder);
+			void markRowDirty(StateType row);
 			/**
 			* Explores state space and truncates the model
 			*
@@ -265,18 +410,32 @@ namespace stamina {
 			/* Data Members */
 			std::shared_ptr<threads::ControlThread<ValueType, RewardModelType, StateType>> controlThread;
 			std::vector<typename threads::ExplorationThread<ValueType, RewardModelType, StateType> *> explorationThreads;
+			std::shared_ptr<threads::ExplorationThreadPool<ValueType, StateType>> explorationPool;
+			std::vector<std::shared_ptr<storm::generator::PrismNextStateGenerator<ValueType, StateType>>> generators;
+			std::size_t minimumPerimeterStatesPerGenerator = 256;
+			// Reused by connectTerminalStatesToAbsorbing
+			std::vector<TransitionInfo> perimeterTransitions;
+			// Successors of perimeter states, so they are not expanded again when they are explored
+			util::SuccessorCache<ValueType, StateType> successorCache;
+			// Kept for the lifetime of the builder, so a budget which ran out stays exhausted in later iterations
+			util::ExplorationBudget explorationBudget{
+				core::Options::max_states
+				, core::Options::max_transitions
+				, core::Options::max_memory << 20 // Megabytes to bytes
+			};
 
 			std::function<StateType (CompressedState const&)> terminalStateToIdCallback;
 
 			std::shared_ptr<storm::expressions::Expression> leftPropertyExpression;
 			std::shared_ptr<storm::expressions::Expression> rightPropertyExpression;
+			// phi1 and phi2 compiled to read the state directly, or nullptr if they could not be
+			std::unique_ptr<stamina::generator::CompiledStateExpression<ValueType>> compiledLeftPropertyExpression;
+			std::unique_ptr<stamina::generator::CompiledStateExpression<ValueType>> compiledRightPropertyExpression;
 			storm::expressions::ExpressionManager * expressionManager;
 			std::shared_ptr<const storm::logic::BoundedUntilFormula> propertyFormula;
 
 			std::shared_ptr<storm::generator::PrismNextStateGenerator<ValueType, StateType>> generator;
 
-			util::StateMemoryPool<ProbabilityState<StateType>> memoryPool;
-
 			std::deque<std::pair<ProbabilityState<StateType> *, CompressedState> > statesToExplore;
 			// Dynamic programming improvement: we keep an ordered set of the states terminated
 			// during the previous iteration (in an order that prevents needing to use a remapping
@@ -292,8 +451,16 @@ namespace stamina {
 			// Remapping (not used by STAMINA)
 			boost::optional<std::vector<uint_fast64_t>> stateRemapping;
 
-			// Transitions which we must add
-			std::vector<std::vector<TransitionInfo>> transitionsToAdd;
+			// Transitions which we must add, packed by row
+			util::TransitionStore<ValueType, StateType> transitionsToAdd;
+			// Rates into the absorbing state, kept out of transitionsToAdd so that dropping them does
+			// not need a pass over every transition
+			std::vector<ValueType> rateToAbsorbing;
+			std::vector<StateType> rowsToAbsorbing;
+			// CSR rows of the transition matrix (kept between iterations when using Options::incremental_matrix)
+			util::IncrementalSparseMatrix<ValueType, StateType> incrementalMatrix;
+			std::vector<StateType> dirtyRows;
+			std::vector<bool> rowIsDirty;
 			// Options for next state generators
 			storm::generator::NextStateGeneratorOptions const & options;
 			// The model builder must have access to this to create a fresh next state generator each iteration
@@ -24,6 +24,7 @@
 
 #include <functional>
 #include <sstream>
+#include <algorithm>
 #include <cmath>
 
 // Pre-load factor for hash-map
@@ -32,8 +33,8 @@
 namespace stamina {
 namespace builder {
 
-template<typename ValueType, typename RewardModelType, typename StateType>
-StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType>::StaminaPriorityModelBuilder(
+template <typename ValueType, typename RewardModelType, typename StateType, EVENTS Event>
+StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType, Event>::StaminaPriorityModelBuilder(
 	std::shared_ptr<storm::generator::PrismNextStateGenerator<ValueType, StateType>> const& generator
 	, storm::prism::Program const& modulesFile
 	, storm::generator::NextStateGeneratorOptions const & options
@@ -48,8 +49,8 @@ StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType>::StaminaPrior
 	setupStatePriority(modulesFile.getManager());
 }
 
-template<typename ValueType, typename RewardModelType, typename StateType>
-StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType>::StaminaPriorityModelBuilder(
+template <typename ValueType, typename RewardModelType, typename StateType, EVENTS Event>
+StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType, Event>::StaminaPriorityModelBuilder(
 	storm::prism::Program const& program
 	, storm::generator::NextStateGeneratorOptions const& generatorOptions
 ) // Invoke super constructor
@@ -62,24 +63,24 @@ StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType>::StaminaPrior
 	setupStatePriority(program.getManager());
 }
 
-template<typename ValueType, typename RewardModelType, typename StateType>
-StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType>::~StaminaPriorityModelBuilder() {
+template <typename ValueType, typename RewardModelType, typename StateType, EVENTS Event>
+StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType, Event>::~StaminaPriorityModelBuilder() {
 	if (this->statePriority) {
 		delete this->statePriority;
 	}
 }
 
-template<typename ValueType, typename RewardModelType, typename StateType>
+template <typename ValueType, typename RewardModelType, typename StateType, EVENTS Event>
 void
-StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType>::initializeEventStatePriority(storm::jani::Property * property) {
-	if (Options::event == EVENTS::UNDEFINED) { return; }
+StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType, Event>::initializeEventStatePriority(storm::jani::Property * property) {
+	if (Event == EVENTS::UNDEFINED) { return; }
 	// This method assumes you're using an event state priority
 	statePriority->initialize(property);
 }
 
-template<typename ValueType, typename RewardModelType, typename StateType>
+template <typename ValueType, typename RewardModelType, typename StateType, EVENTS Event>
 StateType
-StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType>::getOrAddStateIndex(CompressedState const& state) {
+StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType, Event>::getOrAddStateIndex(CompressedState const& state) {
 	if (state == this->absorbingState) {
 		StaminaMessages::errorAndExit("Got Absorbing state in stateToIdCallback!");
 		return 0;
@@ -103,22 +104,21 @@ StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType>::getOrAddStat
 	if (isInit) {
 		if (!stateIsExisting) {
 			// Create a ProbabilityState for each individual state
-			ProbabilityState<StateType> * initProbabilityState = memoryPool.allocate();
-			*initProbabilityState = ProbabilityState(
+			ProbabilityState<StateType> * initProbabilityState = stateMap.put(
 				actualIndex
-				, 1.0
-				, true
+				, ProbabilityState<StateType>(
+					actualIndex
+					, 1.0
+					, true
+				)
 			);
 			numberTerminal++;
-			stateMap.put(actualIndex, initProbabilityState);
 			// Explicitly enqueue the initial state--do not use enqueue()
-			std::shared_ptr<ProbabilityStatePair<StateType>> initProbabilityStatePair(
-				new ProbabilityStatePair<StateType>(initProbabilityState, state)
-			);
+			ProbabilityStatePair<StateType> initProbabilityStatePair(initProbabilityState, state);
 			if (this->statePriority) {
 				statePriority->priority(initProbabilityStatePair);
 			}
-			statePriorityQueue.push(initProbabilityStatePair);
+			pushToQueue(std::move(initProbabilityStatePair));
 			initProbabilityState->iterationLastSeen = iteration;
 		}
 		else {
@@ -139,13 +139,11 @@ StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType>::getOrAddStat
 			if (nextProbabilityState->iterationLastSeen != iteration) {
 				nextProbabilityState->iterationLastSeen = iteration;
 				// Enqueue
-				std::shared_ptr<ProbabilityStatePair<StateType>> nextProbabilityStatePair(
-					new ProbabilityStatePair<StateType>(nextProbabilityState, state)
-				);
+				ProbabilityStatePair<StateType> nextProbabilityStatePair(nextProbabilityState, state);
 				if (this->statePriority) {
 					statePriority->priority(nextProbabilityStatePair);
 				}
-				enqueue(nextProbabilityStatePair);
+				enqueue(std::move(nextProbabilityStatePair));
 				enqueued = true;
 			}
 		}
@@ -162,34 +160,31 @@ StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType>::getOrAddStat
 			if (nextProbabilityState->iterationLastSeen != iteration) {
 				nextProbabilityState->iterationLastSeen = iteration;
 				// Enqueue
-				std::shared_ptr<ProbabilityStatePair<StateType>> nextProbabilityStatePair(
-					new ProbabilityStatePair<StateType>(nextProbabilityState, state)
-				);
+				ProbabilityStatePair<StateType> nextProbabilityStatePair(nextProbabilityState, state);
 				if (this->statePriority) {
 					statePriority->priority(nextProbabilityStatePair);
 				}
-				enqueue(nextProbabilityStatePair);
+				enqueue(std::move(nextProbabilityStatePair));
 				enqueued = true;
 			}
 		}
 		else {
 			// This state has not been seen so create a new ProbabilityState
-			ProbabilityState<StateType> * nextProbabilityState = memoryPool.allocate();
-			*nextProbabilityState = ProbabilityState(
+			ProbabilityState<StateType> * nextProbabilityState = stateMap.put(
 				actualIndex
-				, 0.0
-				, true
+				, ProbabilityState<StateType>(
+					actualIndex
+					, 0.0
+					, true
+				)
 			);
-			stateMap.put(actualIndex, nextProbabilityState);
 			nextProbabilityState->iterationLastSeen = iteration;
 			// exploredStates.emplace(actualIndex);
-			std::shared_ptr<ProbabilityStatePair<StateType>> nextProbabilityStatePair(
-				new ProbabilityStatePair<StateType>(nextProbabilityState, state)
-			);
+			ProbabilityStatePair<StateType> nextProbabilityStatePair(nextProbabilityState, state);
 			if (this->statePriority) {
 				statePriority->priority(nextProbabilityStatePair);
 			}
-			enqueue(nextProbabilityStatePair);
+			enqueue(std::move(nextProbabilityStatePair));
 
 			enqueued = true;
 			numberTerminal++;
@@ -198,18 +193,18 @@ StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType>::getOrAddStat
 	return actualIndex;
 }
 
-template <typename ValueType, typename RewardModelType, typename StateType>
+template <typename ValueType, typename RewardModelType, typename StateType, EVENTS Event>
 void
-StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType>::enqueue(std::shared_ptr<ProbabilityStatePair<StateType>> probabilityStatePair) {
+StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType, Event>::enqueue(ProbabilityStatePair<StateType> && probabilityStatePair) {
+	auto probabilityState = probabilityStatePair.first;
 	// Do not preterminate
 	if (!Options::preterminate) {
-		statePriorityQueue.push(probabilityStatePair);
+		pushToQueue(std::move(probabilityStatePair));
 		return;
 	}
 
-	auto probabilityState = probabilityStatePair->first;
-	auto stateReachability = probabilityStatePair->first->getPi();
-	auto state = probabilityStatePair->second;
+	auto stateReachability = probabilityState->getPi();
+	auto const & state = probabilityStatePair.second;
 	// We should be somewhat conscious of the reachability that may get added
 	double halfNextReachability = stateReachability + this->currentProbabilityState->getPi() / 2;
 
@@ -217,7 +212,7 @@ StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType>::enqueue(std:
 	bool preTerminateThisIteration = halfNextReachability < windowPower / (double) numberOfExploredStates;
 	// Our state is not pre-terminated, and should not be
 	if (!probabilityState->isPreTerminated() && !preTerminateThisIteration) {
-		statePriorityQueue.push(probabilityStatePair);
+		pushToQueue(std::move(probabilityStatePair));
 		return;
 	}
 	// Our state is preterminated and should stay that way
@@ -229,27 +224,37 @@ StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType>::enqueue(std:
 	if (preTerminateThisIteration && !inPreTerminatedSet) {
 		// It is the main loop's responsibility to insert the transition
 		preTerminatedStates.insert({state, probabilityState->index});
-		std::shared_ptr<std::vector<TransitionInfo>> transitionVector(new std::vector<TransitionInfo>());
-		probabilityState->preTerminatedTransitions = transitionVector;
+		preTerminatedTransitions[probabilityState->index].clear();
 		probabilityState->setPreTerminated(true);
 	}
 	// If it is preterminated but should be un-preterminated
 	else if (inPreTerminatedSet && !preTerminateThisIteration) {
 		preTerminatedStates.erase(state);
 		probabilityState->setPreTerminated(false);
-		statePriorityQueue.push(probabilityStatePair);
-		for (auto transition : *probabilityState->preTerminatedTransitions) {
-			this->createTransition(transition);
+		pushToQueue(std::move(probabilityStatePair));
+		auto transitions = preTerminatedTransitions.find(probabilityState->index);
+		if (transitions != preTerminatedTransitions.end()) {
+			for (auto transition : transitions->second) {
+				this->createTransition(transition);
+			}
+			preTerminatedTransitions.erase(transitions);
 		}
-		probabilityState->preTerminatedTransitions = nullptr;
 	}
 }
 
-template <typename ValueType, typename RewardModelType, typename StateType>
+template <typename ValueType, typename RewardModelType, typename StateType, EVENTS Event>
+void
+StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType, Event>::pushToQueue(ProbabilityStatePair<StateType> && probabilityStatePair) {
+	probabilityStatePair.score = PriorityComparison::score(probabilityStatePair);
+	StateType index = probabilityStatePair.first->index;
+	statePriorityQueue.push(index, std::move(probabilityStatePair));
+}
+
+template <typename ValueType, typename RewardModelType, typename StateType, EVENTS Event>
 void
-StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType>::setupStatePriority(storm::expressions::ExpressionManager & manager) {
+StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType, Event>::setupStatePriority(storm::expressions::ExpressionManager & manager) {
 	this->statePriority = nullptr;
-	switch (Options::event) {
+	switch (Event) {
 		case EVENTS::RARE:
 			this->statePriority = new priority::EventStatePriority<StateType>(true, manager);
 			break;
@@ -263,9 +268,9 @@ StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType>::setupStatePr
 	}
 }
 
-template <typename ValueType, typename RewardModelType, typename StateType>
+template <typename ValueType, typename RewardModelType, typename StateType, EVENTS Event>
 storm::storage::sparse::ModelComponents<ValueType, RewardModelType>
-StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType>::buildModelComponents() {
+StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType, Event>::buildModelComponents() {
 	StaminaMessages::info("Using STAMINA 3.0 Algorithm");
 // 	StaminaMessages::errorAndExit("STAMINA 3.0 is not yet implemented!");
 	// Is this model deterministic? (I.e., is there only one choice per state?)
@@ -295,7 +300,7 @@ StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType>::buildModelCo
 	StateSpaceInformation::setVariableInformation(generator->getVariableInformation());
 
 	if (!firstIteration) {
-		StaminaMessages::errorAndExit("Could not acquire a satisfactory result!\n\tMore Info: Multiple iterations are currently not supported in the Priority method.\n\tTry again with a higher fudge factor (-F)");
+		StaminaMessages::info("Continuing exploration from " + std::to_string(statePriorityQueue.size()) + " perimeter states.");
 	}
 	// Component builders
 	storm::storage::SparseMatrixBuilder<ValueType> transitionMatrixBuilder(
@@ -318,15 +323,15 @@ StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType>::buildModelCo
 
 	// No remapping is necessary
 	this->purgeAbsorbingTransitions();
-	this->connectAllTerminalStatesToAbsorbing(transitionMatrixBuilder);
-	this->flushToTransitionMatrix(transitionMatrixBuilder);
+	connectPerimeterToAbsorbing(transitionMatrixBuilder);
+	this->flushToTransitionMatrix();
 
-	generator = std::make_shared<storm::generator::PrismNextStateGenerator<ValueType, StateType>>(modulesFile, this->options);
+	generator = stamina::generator::makeNextStateGenerator<ValueType, StateType>(modulesFile, this->options);
 	this->setGenerator(generator);
 
 	// Using the information from buildMatrices, initialize the model components
 	storm::storage::sparse::ModelComponents<ValueType, RewardModelType> modelComponents(
-		transitionMatrixBuilder.build(0, transitionMatrixBuilder.getCurrentRowGroupCount())
+		this->buildTransitionMatrix()
 		, this->buildStateLabeling()
 		, std::unordered_map<std::string, RewardModelType>()
 		, !generator->isDiscreteTimeModel()
@@ -358,16 +363,15 @@ StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType>::buildModelCo
 	return modelComponents;
 }
 
-template <typename ValueType, typename RewardModelType, typename StateType>
+template <typename ValueType, typename RewardModelType, typename StateType, EVENTS Event>
 void
-StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType>::buildMatrices(
+StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType, Event>::buildMatrices(
 	storm::storage::SparseMatrixBuilder<ValueType>& transitionMatrixBuilder
 	, std::vector<RewardModelBuilder<typename RewardModelType::ValueType>>& rewardModelBuilders
 	, StateAndChoiceInformationBuilder& stateAndChoiceInformationBuilder
 	, boost::optional<storm::storage::BitVector>& markovianChoices
 	, boost::optional<storm::storage::sparse::StateValuationsBuilder>& stateValuationsBuilder
 ) {
-	piHat = 1.0;
 	// numberTransitions = 0;
 	// Builds model
 	// Initialize building state valuations (if necessary)
@@ -379,11 +383,12 @@ StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType>::buildMatrice
 
 	// Create a callback for the next-state generator to enable it to request the index of states.
 	std::function<StateType (CompressedState const&)> stateToIdCallback = std::bind(
-		&StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType>::getOrAddStateIndex
+		&StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType, Event>::getOrAddStateIndex
 		, this
 		, std::placeholders::_1
 	);
 
+	bool hold = false;
 	if (firstIteration) {
 		// Create absorbing state
 		this->setUpAbsorbingState(
@@ -403,10 +408,16 @@ StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType>::buildMatrice
 		currentRow = 1;
 		firstIteration = false;
 		numberOfExploredStates = 0;
+		piHat = 1.0;
+		windowScale = 1.0;
+		windowPower = 0; // Always explore at least the first state
+		hold = true;
 	}
-	else {
-		// Flush the previously early-terminated states into statesToExplore FIRST
-		flushStatesTerminated();
+	else if (windowPower > 0) {
+		// The statePriorityQueue, pre-terminated states and transitions are kept from the last iteration, so
+		// we continue from the highest priority perimeter states. Relax the window so that exploration only
+		// stops once the perimeter reachability has shrunk by at least a factor of reduce_kappa
+		windowScale = std::min(windowScale, piHat * Options::approx_factor / windowPower) / Options::reduce_kappa;
 	}
 	numberOfExploredStatesSinceLastMessage = 0;
 
@@ -418,19 +429,20 @@ StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType>::buildMatrice
 
 	isInit = false;
 
-	bool hold = true;
-	windowPower = 0; // Always explore at least the first state
 	// Perform a search through the model.
-	while (hold || (!statePriorityQueue.empty() && (piHat > windowPower / Options::approx_factor))) {
+	while (hold || (
+		!statePriorityQueue.empty()
+		&& piHat > windowScale * windowPower / Options::approx_factor
+		&& !this->checkExplorationBudget(stateStorage.getNumberOfStates())
+	)) {
 		// std::cout << "PiHat = " << piHat << std::endl;
 		// std::cout << "cond = " << windowPower / Options::approx_factor << std::endl;
 		hold = false;
-		auto currentProbabilityStatePair = *statePriorityQueue.top();
-		currentProbabilityState = statePriorityQueue.top()->first;
+		auto currentProbabilityStatePair = statePriorityQueue.pop();
+		currentProbabilityState = currentProbabilityStatePair.first;
 		// std::cout << "Current pi: " << currentProbabilityState->pi << std::endl;
-		currentState = statePriorityQueue.top()->second;
+		currentState = std::move(currentProbabilityStatePair.second);
 		currentIndex = currentProbabilityState->index;
-		statePriorityQueue.pop();
 		if (currentIndex == 0) {
 			StaminaMessages::errorAndExit("Dequeued artificial absorbing state!");
 		}
@@ -447,10 +459,7 @@ StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType>::buildMatrice
 		generator->load(currentState);
 
 		if (formulaMatchesExpression && !Options::no_prop_refine) {
-			storm::expressions::SimpleValuation valuation = generator->currentStateToSimpleValuation();
-			// bool evaluationAtCurrentState = propertyExpression->evaluateAsBool(&valuation);
-			bool leftEvaluation = leftPropertyExpression->evaluateAsBool(&valuation);
-			bool rightEvaluation = rightPropertyExpression->evaluateAsBool(&valuation);;
+			auto [leftEvaluation, rightEvaluation] = this->evaluatePropertyExpressions(currentState);
 			// The left evaluation is, for a property P=?[ phi1 U[] phi2 ], the state evaluation
 			// of phi1(s), and the right evaluation is phi2(s). Our formula for early termination
 			// is !leftEvaluation || rightEvaluation, because
@@ -464,7 +473,7 @@ StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType>::buildMatrice
 				this->createTransition(currentIndex, currentIndex, 1.0);
 				// We treat this state as terminal even though it is also absorbing and does not
 				// go to our artificial absorbing state
-				currentProbabilityState->terminal = true;
+				stateMap.setTerminal(currentProbabilityState, true);
 
 				piHat -= currentProbabilityState->getPi();
 
@@ -477,7 +486,7 @@ StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType>::buildMatrice
 		// We assume that if we make it here, our state is either nonterminal, or its reachability probability
 		// is greater than kappa
 		// Expand (explore next states)
-		storm::generator::StateBehavior<ValueType, StateType> behavior = generator->expand(stateToIdCallback);
+		storm::generator::StateBehavior<ValueType, StateType> behavior = this->expandState(currentIndex, stateToIdCallback);
 
 		auto stateRewardIt = behavior.getStateRewards().begin();
 		for (auto& rewardModelBuilder : rewardModelBuilders) {
@@ -496,10 +505,10 @@ StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType>::buildMatrice
 			// If we are not yet aware that this is a deadlock state
 			// we should make future iterations aware of this
 			this->createTransition(currentIndex, currentIndex, 1.0);
-			if (!currentProbabilityState->deadlock) {
+			if (!currentProbabilityState->isDeadlock()) {
 				stateStorage.deadlockStateIndices.push_back(currentIndex);
 				// Make absorbing
-				currentProbabilityState->deadlock = true;
+				currentProbabilityState->setDeadlock(true);
 			}
 
 			piHat -= currentProbabilityState->getPi();
@@ -564,21 +573,30 @@ StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType>::buildMatrice
 						if (nextProbabilityState->isTerminal()) {
 							piHat += piToAdd;
 						}
+						// Its priority grew, so move it up in the queue rather than leaving it out of order
+						if (statePriorityQueue.contains(sPrime)) {
+							auto & queuedProbabilityStatePair = statePriorityQueue.get(sPrime);
+							queuedProbabilityStatePair.score = PriorityComparison::score(queuedProbabilityStatePair);
+							statePriorityQueue.update(sPrime);
+						}
 					}
 
 
-					if (currentProbabilityState->isNew) {
+					if (currentProbabilityState->isNew()) {
 						if (!nextProbabilityState->isPreTerminated()) {
 							// Our state is not pre-terminated
 							this->createTransition(currentIndex, sPrime, stateProbabilityPair.second);
 							// numberTransitions++;
 						}
 						else {
-							if (!nextProbabilityState->preTerminatedTransitions) {
+							auto transitions = preTerminatedTransitions.find(sPrime);
+							if (transitions == preTerminatedTransitions.end()) {
 								StaminaMessages::error("Error with set of preterminated states!");
 							}
-							// Our state is preterminated and we must keep track of the transition we would have inserted in case we un-preterminate it
-							nextProbabilityState->preTerminatedTransitions->emplace_back(TransitionInfo(currentIndex, sPrime, stateProbabilityPair.second));
+							else {
+								// Our state is preterminated and we must keep track of the transition we would have inserted in case we un-preterminate it
+								transitions->second.emplace_back(TransitionInfo(currentIndex, sPrime, stateProbabilityPair.second));
+							}
 						}
 					}
 				}
@@ -588,7 +606,7 @@ StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType>::buildMatrice
 				this->createTransition(currentIndex, currentIndex, 1.0);
 				stateStorage.deadlockStateIndices.push_back(currentIndex);
 				// Make absorbing
-				currentProbabilityState->deadlock = true;
+				currentProbabilityState->setDeadlock(true);
 
 			}
 			if (currentIndex >= currentRow) {
@@ -597,7 +615,7 @@ StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType>::buildMatrice
 			firstChoiceOfState = false;
 		}
 
-		currentProbabilityState->isNew = false;
+		currentProbabilityState->setNew(false);
 
 		if (currentProbabilityState->isTerminal() && numberTerminal > 0) {
 			piHat -= currentProbabilityState->getPi();
@@ -606,7 +624,7 @@ StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType>::buildMatrice
 		else if (currentProbabilityState->isTerminal()) {
 			StaminaMessages::error("numberTerminal is equal to " + std::to_string(numberTerminal));
 		}
-		currentProbabilityState->setTerminal(false);
+		stateMap.setTerminal(currentProbabilityState, false);
 		currentProbabilityState->setPi(0.0);
 
 		if (currentRow >= currentRowGroup) {
@@ -631,8 +649,6 @@ StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType>::buildMatrice
 			}
 		}
 	}
-	this->flushFromPriorityQueueToStatesTerminated();
-
 	numberStates = stateStorage.stateToId.size(); // numberOfExploredStates;
 
 	this->printStateSpaceInformation();
@@ -640,17 +656,18 @@ StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType>::buildMatrice
 
 }
 
-template <typename ValueType, typename RewardModelType, typename StateType>
+template <typename ValueType, typename RewardModelType, typename StateType, EVENTS Event>
 void
-StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType>::flushFromPriorityQueueToStatesTerminated() {
-	// Terminal states are any remaining states in the state transition queue
-	while (!statePriorityQueue.empty()) {
-		auto currentProbabilityStatePair = statePriorityQueue.top();
-		auto currentProbabilityState = statePriorityQueue.top()->first;
-		auto currentState = statePriorityQueue.top()->second;
-		statePriorityQueue.pop();
-		statesTerminatedLastIteration.push_back(currentProbabilityStatePair);
-	}
+StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType, Event>::connectPerimeterToAbsorbing(
+	storm::storage::SparseMatrixBuilder<ValueType>& transitionMatrixBuilder
+) {
+	// Terminal states are any remaining states in the state priority queue. They are copied rather
+	// than popped, since the next iteration continues from them
+	statePriorityQueue.forEach([&](ProbabilityStatePair<StateType> const & probabilityStatePair) {
+		probabilityStatePair.first->setPutInTerminalQueue(true);
+		statesTerminatedLastIteration.emplace_back(probabilityStatePair.first, probabilityStatePair.second);
+	});
+	this->connectAllTerminalStatesToAbsorbing(transitionMatrixBuilder);
 	// flush from the preterminated states
 	// TODO: make sure no preterminated states were "un"-preterminated
 	uint32_t numberOfPreTerminatedStates = 0;
@@ -660,12 +677,12 @@ StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType>::flushFromPri
 	}
 	for (auto const & [stateValues, stateId] : preTerminatedStates) {
 		numberOfPreTerminatedStates++;
-		auto transitions = stateMap.get(stateId)->preTerminatedTransitions;
-		if (!transitions) {
+		auto transitions = preTerminatedTransitions.find(stateId);
+		if (transitions == preTerminatedTransitions.end()) {
 			StaminaMessages::errorAndExit("Preterminated transition vector was null!");
 		}
 		// Loop over each transition in the terminated vector
-		for (auto const & transition : *transitions) {
+		for (auto const & transition : transitions->second) {
 			// actually create the transition
 			this->createTransition(transition.from, 0, transition.transition);
 			// Make preterminated state have a self loop
@@ -677,17 +694,40 @@ StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType>::flushFromPri
 }
 
 template <typename ValueType, typename RewardModelType, typename StateType>
-void
-StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType>::flushStatesTerminated() {
-	while (!statesTerminatedLastIteration.empty()) {
-		auto probabilityStatePair = statesTerminatedLastIteration.front();
-		statePriorityQueue.push(probabilityStatePair);
-		statesTerminatedLastIteration.pop_front();
-		probabilityStatePair->first->isNew = true;
+std::shared_ptr<StaminaModelBuilder<ValueType, RewardModelType, StateType>>
+makePriorityModelBuilder(
+	std::shared_ptr<storm::generator::PrismNextStateGenerator<ValueType, StateType>> const& generator
+	, storm::prism::Program const& modulesFile
+	, storm::generator::NextStateGeneratorOptions const & options
+	, storm::jani::Property * property
+) {
+	switch (Options::event) {
+		case EVENTS::RARE: {
+			auto builder = std::make_shared<StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType, EVENTS::RARE>>(generator, modulesFile, options);
+			builder->initializeEventStatePriority(property);
+			return builder;
+		}
+		case EVENTS::COMMON: {
+			auto builder = std::make_shared<StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType, EVENTS::COMMON>>(generator, modulesFile, options);
+			builder->initializeEventStatePriority(property);
+			return builder;
+		}
+		case EVENTS::UNDEFINED:
+		default:
+			// No event state priority to initialize
+			return std::make_shared<StaminaPriorityModelBuilder<ValueType, RewardModelType, StateType, EVENTS::UNDEFINED>>(generator, modulesFile, options);
 	}
 }
 
-template class StaminaPriorityModelBuilder<double, storm::models::sparse::StandardRewardModel<double>, uint32_t>;
+template class StaminaPriorityModelBuilder<double, storm::models::sparse::StandardRewardModel<double>, uint32_t, EVENTS::UNDEFINED>;
+template class StaminaPriorityModelBuilder<double, storm::models::sparse::StandardRewardModel<double>, uint32_t, EVENTS::RARE>;
+template class StaminaPriorityModelBuilder<double, storm::models::sparse::StandardRewardModel<double>, uint32_t, EVENTS::COMMON>;
+template std::shared_ptr<StaminaModelBuilder<double, storm::models::sparse::StandardRewardModel<double>, uint32_t>> makePriorityModelBuilder(
+	std::shared_ptr<storm::generator::PrismNextStateGenerator<double, uint32_t>> const& generator
+	, storm::prism::Program const& modulesFile
+	, storm::generator::NextStateGeneratorOptions const & options
+	, storm::jani::Property * property
+);
 
 } // namespace builder
 } // namespace stamina
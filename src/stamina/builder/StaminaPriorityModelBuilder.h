@@ -30,14 +30,25 @@
 #include "StaminaModelBuilder.h"
 
 #include "priority/StatePriority.h"
+#include "util/IndexedHeap.h"
 
 namespace stamina {
 	namespace builder {
-		template<typename ValueType, typename RewardModelType = storm::models::sparse::StandardRewardModel<ValueType>, typename StateType = uint32_t>
+		/**
+		 * The event mode (Options::event) is a template parameter, so that the order of the frontier is fixed at
+		 * compile time. Use makePriorityModelBuilder() to create the builder for the current mode.
+		 * */
+		template<
+			typename ValueType
+			, typename RewardModelType = storm::models::sparse::StandardRewardModel<ValueType>
+			, typename StateType = uint32_t
+			, EVENTS Event = EVENTS::UNDEFINED
+		>
 		class StaminaPriorityModelBuilder : public StaminaModelBuilder<ValueType, RewardModelType, StateType> {
 		public:
 // 			typedef typename StaminaModelBuilder<ValueType, RewardModelType, StateType>::ProbabilityState ProbabilityState;
 			typedef StaminaTransitionInfo<StateType> TransitionInfo;
+			typedef ProbabilityStatePairComparison<StateType, Event> PriorityComparison;
 			/**
 			* Constructs a StaminaPriorityModelBuilder with a given storm::generator::PrismNextStateGenerator. Invokes super's constructor
 			*
@@ -100,17 +111,27 @@ namespace stamina {
 			/**
 			 * Enqueues a state in the statePriorityQueue or pre-terminates it
 			 *
-			 * @param probabilityState The state to either conditionally enqueue or pre-terminate
+			 * @param probabilityStatePair The state to either conditionally enqueue or pre-terminate
 			 * */
-			void enqueue(std::shared_ptr<ProbabilityStatePair<StateType>> probabilityStatePair);
+			void enqueue(ProbabilityStatePair<StateType> && probabilityStatePair);
 		private:
 			/**
 			 * Uses the values in Options to set up the current state priority;
 			 * */
 			void setupStatePriority(storm::expressions::ExpressionManager & manager);
-			std::deque<std::shared_ptr<ProbabilityStatePair<StateType>>> statesTerminatedLastIteration;
-			void flushStatesTerminated();
-			void flushFromPriorityQueueToStatesTerminated();
+			/**
+			 * Scores a state and pushes it into the statePriorityQueue
+			 *
+			 * @param probabilityStatePair The state to push
+			 * */
+			void pushToQueue(ProbabilityStatePair<StateType> && probabilityStatePair);
+			/**
+			 * Connects the states left in the statePriorityQueue and the pre-terminated states to the absorbing
+			 * state. The queue itself is kept, so that the next refine iteration continues exploring from it.
+			 *
+			 * @param transitionMatrixBuilder The builder of the transition matrix
+			 * */
+			void connectPerimeterToAbsorbing(storm::storage::SparseMatrixBuilder<ValueType>& transitionMatrixBuilder);
 			/*
 			 * Access to data members of parent class
 			 * */
@@ -119,8 +140,8 @@ namespace stamina {
 			using StaminaModelBuilder<ValueType, RewardModelType, StateType>::expressionManager;
 			using StaminaModelBuilder<ValueType, RewardModelType, StateType>::propertyFormula;
 			using StaminaModelBuilder<ValueType, RewardModelType, StateType>::generator;
-			using StaminaModelBuilder<ValueType, RewardModelType, StateType>::memoryPool;
 			using StaminaModelBuilder<ValueType, RewardModelType, StateType>::statesToExplore;
+			using StaminaModelBuilder<ValueType, RewardModelType, StateType>::statesTerminatedLastIteration;
 			using StaminaModelBuilder<ValueType, RewardModelType, StateType>::stateMap;
 			using StaminaModelBuilder<ValueType, RewardModelType, StateType>::stateStorage;
 			// Options for next state generators
@@ -143,15 +164,19 @@ namespace stamina {
 			using StaminaModelBuilder<ValueType, RewardModelType, StateType>::currentRowGroup;
 			using StaminaModelBuilder<ValueType, RewardModelType, StateType>::currentRow;
 			/* Data members */
-			std::priority_queue<
-				std::shared_ptr<ProbabilityStatePair<StateType>>
-				, std::vector<std::shared_ptr<ProbabilityStatePair<StateType>>>
-				, ProbabilityStatePairPointerComparison<StateType>
+			// Keyed by state index, so a state whose reachability grows is moved up rather than pushed again.
+			// Kept between refine iterations as the perimeter of the truncated model
+			util::IndexedHeap<
+				ProbabilityStatePair<StateType>
+				, PriorityComparison
+				, StateType
 			> statePriorityQueue;
 			uint64_t numberOfExploredStates;
 			uint64_t numberOfExploredStatesSinceLastMessage;
 			double piHat;
 			double windowPower;
+			// Scales the window below which exploration stops. Shrinks with each refine iteration
+			double windowScale;
 			// State Priority
 			priority::StatePriority<StateType> * statePriority;
 			/**
@@ -162,7 +187,26 @@ namespace stamina {
 				, StateType // So we can access the ProbabilityState when we are done
 				, storm::storage::Murmur3BitVectorHash<StateType> // The hash provided by Storm
 			> preTerminatedStates;
+			// The transitions into each pre-terminated state, kept in case it is un-preterminated
+			std::unordered_map<StateType, std::vector<TransitionInfo>> preTerminatedTransitions;
 		};
+		/**
+		 * Creates a priority model builder for the event mode in Options, and initializes its event state
+		 * priority (if it has one).
+		 *
+		 * @param generator The generator the builder uses
+		 * @param modulesFile The PRISM program
+		 * @param options Options for the generator
+		 * @param property The property whose distance the event state priority uses
+		 * @return The builder
+		 * */
+		template <typename ValueType, typename RewardModelType = storm::models::sparse::StandardRewardModel<ValueType>, typename StateType = uint32_t>
+		std::shared_ptr<StaminaModelBuilder<ValueType, RewardModelType, StateType>> makePriorityModelBuilder(
+			std::shared_ptr<storm::generator::PrismNextStateGenerator<ValueType, StateType>> const& generator
+			, storm::prism::Program const& modulesFile
+			, storm::generator::NextStateGeneratorOptions const & options
+			, storm::jani::Property * property
+		);
 	}
 }
 #endif // STAMINA_BUILDER_PRIORITYMODELBUILDER_H
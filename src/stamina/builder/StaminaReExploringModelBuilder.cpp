@@ -134,10 +134,7 @@ StaminaReExploringModelBuilder<ValueType, RewardModelType, StateType>::buildMatr
 		generator->load(currentState);
 
 		if (formulaMatchesExpression && !Options::no_prop_refine) {
-			storm::expressions::SimpleValuation valuation = generator->currentStateToSimpleValuation();
-			// bool evaluationAtCurrentState = propertyExpression->evaluateAsBool(&valuation);
-			bool leftEvaluation = leftPropertyExpression->evaluateAsBool(&valuation);
-			bool rightEvaluation = rightPropertyExpression->evaluateAsBool(&valuation);;
+			auto [leftEvaluation, rightEvaluation] = this->evaluatePropertyExpressions(currentState);
 			// The left evaluation is, for a property P=?[ phi1 U[] phi2 ], the state evaluation
 			// of phi1(s), and the right evaluation is phi2(s). Our formula for early termination
 			// is !leftEvaluation || rightEvaluation, because
@@ -151,7 +148,7 @@ StaminaReExploringModelBuilder<ValueType, RewardModelType, StateType>::buildMatr
 				this->createTransition(currentIndex, currentIndex, 1.0);
 				// We treat this state as terminal even though it is also absorbing and does not
 				// go to our artificial absorbing state
-				currentProbabilityState->terminal = true;
+				stateMap.setTerminal(currentProbabilityState, true);
 				numberTerminal++;
 				// Do NOT place this in the deque of states we should start with next iteration
 				continue;
@@ -159,13 +156,17 @@ StaminaReExploringModelBuilder<ValueType, RewardModelType, StateType>::buildMatr
 		}
 
 		// Add the state rewards to the corresponding reward models.
-		// Do not explore if state is terminal and its reachability probability is less than kappa
-		if (currentProbabilityState->isTerminal() && currentProbabilityState->getPi() < localKappa) {
-			if (!currentProbabilityState->wasPutInTerminalQueue) {
+		// Do not explore if state is terminal and its reachability probability is less than kappa, or
+		// if the exploration budget has run out
+		if (currentProbabilityState->isTerminal() && (
+			currentProbabilityState->getPi() < localKappa
+			|| this->checkExplorationBudget(stateStorage.getNumberOfStates())
+		)) {
+			if (!currentProbabilityState->wasPutInTerminalQueue()) {
 				// Do not connect to absorbing yet--only connect at the end
 				this->statesTerminatedLastIteration.push_back(currentProbabilityStatePair);
 				++numberOfExploredStates;
-				currentProbabilityState->wasPutInTerminalQueue = true;
+				currentProbabilityState->setPutInTerminalQueue(true);
 				++currentRow;
 				++currentRowGroup;
 			}
@@ -174,14 +175,14 @@ StaminaReExploringModelBuilder<ValueType, RewardModelType, StateType>::buildMatr
 
 		// If it was previously put in the terminal queue, mark it as no longer
 		// This way it will not be connected to the absorbing state
-		if (currentProbabilityState->wasPutInTerminalQueue) {
-			currentProbabilityState->wasPutInTerminalQueue = false;
+		if (currentProbabilityState->wasPutInTerminalQueue()) {
+			currentProbabilityState->setPutInTerminalQueue(false);
 		}
 
 		// We assume that if we make it here, our state is either nonterminal, or its reachability probability
 		// is greater than kappa
 		// Expand (explore next states)
-		storm::generator::StateBehavior<ValueType, StateType> behavior = generator->expand(stateToIdCallback);
+		storm::generator::StateBehavior<ValueType, StateType> behavior = this->expandState(currentIndex, stateToIdCallback);
 
 		auto stateRewardIt = behavior.getStateRewards().begin();
 		for (auto& rewardModelBuilder : rewardModelBuilders) {
@@ -200,10 +201,10 @@ StaminaReExploringModelBuilder<ValueType, RewardModelType, StateType>::buildMatr
 #endif // DIE_ON_DEADLOCK / WARN_ON_DEADLOCK
 			// If we are not yet aware that this is a deadlock state
 			// we should make future iterations aware of this
-			if (!currentProbabilityState->deadlock) {
+			if (!currentProbabilityState->isDeadlock()) {
 				this->createTransition(currentIndex, currentIndex, 1.0);
 				stateStorage.deadlockStateIndices.push_back(currentIndex);
-				currentProbabilityState->deadlock = true;
+				currentProbabilityState->setDeadlock(true);
 			}
 			continue;
 		}
@@ -261,7 +262,7 @@ StaminaReExploringModelBuilder<ValueType, RewardModelType, StateType>::buildMatr
 						nextProbabilityState->addToPi(currentProbabilityState->getPi() * probability);
 					}
 
-					if (currentProbabilityState->isNew) {
+					if (currentProbabilityState->isNew()) {
 						this->createTransition(currentIndex, sPrime, stateProbabilityPair.second);
 						// numberTransitions++;
 					}
@@ -273,11 +274,11 @@ StaminaReExploringModelBuilder<ValueType, RewardModelType, StateType>::buildMatr
 			}
 			firstChoiceOfState = false;
 		}
-		currentProbabilityState->isNew = false;
+		currentProbabilityState->setNew(false);
 		if (currentProbabilityState->isTerminal() && numberTerminal > 0) {
 			numberTerminal--;
 		}
-		currentProbabilityState->setTerminal(false);
+		stateMap.setTerminal(currentProbabilityState, false);
 		currentProbabilityState->setPi(0.0);
 
 		if (currentRow >= currentRowGroup) {
@@ -331,20 +332,20 @@ StaminaReExploringModelBuilder<ValueType, RewardModelType, StateType>::getOrAddS
 	if (isInit) {
 		if (!stateIsExisting) {
 			// Create a ProbabilityState for each individual state
-			ProbabilityState<StateType> * initProbabilityState = memoryPool.allocate();
-			*initProbabilityState = ProbabilityState(
+			ProbabilityState<StateType> * initProbabilityState = stateMap.put(
 				actualIndex
-				, 1.0
-				, true
+				, ProbabilityState<StateType>(
+					actualIndex
+					, 1.0
+					, true
+				)
 			);
 			numberTerminal++;
-			stateMap.put(actualIndex, initProbabilityState);
 			statesToExplore.emplace_back(std::make_pair(initProbabilityState, state));
 			initProbabilityState->iterationLastSeen = iteration;
 		}
 		else {
 			ProbabilityState<StateType> * initProbabilityState = nextState;
-			stateMap.put(actualIndex, initProbabilityState);
 			statesToExplore.push_back(std::make_pair(initProbabilityState, state));
 			initProbabilityState->iterationLastSeen = iteration;
 		}
@@ -367,11 +368,13 @@ StaminaReExploringModelBuilder<ValueType, RewardModelType, StateType>::getOrAddS
 		}
 		else {
 			// State does not exist yet in this iteration
-			ProbabilityState<StateType> * nextProbabilityState = memoryPool.allocate();
-			*nextProbabilityState = ProbabilityState(
+			ProbabilityState<StateType> * nextProbabilityState = stateMap.put(
 				actualIndex
-				, 0.0
-				, true
+				, ProbabilityState<StateType>(
+					actualIndex
+					, 0.0
+					, true
+				)
 			);
 			nextProbabilityState->iterationLastSeen = iteration;
 			// exploredStates.emplace(actualIndex);
@@ -394,13 +397,14 @@ StaminaReExploringModelBuilder<ValueType, RewardModelType, StateType>::getOrAddS
 		}
 		else {
 			// This state has not been seen so create a new ProbabilityState
-			ProbabilityState<StateType> * nextProbabilityState = memoryPool.allocate();
-			*nextProbabilityState = ProbabilityState(
+			ProbabilityState<StateType> * nextProbabilityState = stateMap.put(
 				actualIndex
-				, 0.0
-				, true
+				, ProbabilityState<StateType>(
+					actualIndex
+					, 0.0
+					, true
+				)
 			);
-			stateMap.put(actualIndex, nextProbabilityState);
 			nextProbabilityState->iterationLastSeen = iteration;
 			// exploredStates.emplace(actualIndex);
 			statesToExplore.push_back(std::make_pair(nextProbabilityState, state));
@@ -466,10 +470,14 @@ StaminaReExploringModelBuilder<ValueType, RewardModelType, StateType>::buildMode
 			, stateValuationsBuilder
 		);
 
-		generator = std::make_shared<storm::generator::PrismNextStateGenerator<ValueType, StateType>>(modulesFile, this->options);
+		generator = stamina::generator::makeNextStateGenerator<ValueType, StateType>(modulesFile, this->options);
 
 		piHat = this->accumulateProbabilities();
 		innerLoopCount++;
+		// Lowering kappa cannot explore any further
+		if (this->isExplorationBudgetExhausted()) {
+			break;
+		}
 	}
 
 	this->printStateSpaceInformation();
@@ -477,11 +485,11 @@ StaminaReExploringModelBuilder<ValueType, RewardModelType, StateType>::buildMode
 	// No remapping is necessary
 	this->purgeAbsorbingTransitions();
 	this->connectAllTerminalStatesToAbsorbing(transitionMatrixBuilder);
-	this->flushToTransitionMatrix(transitionMatrixBuilder);
+	this->flushToTransitionMatrix();
 
 	// Using the information from buildMatrices, initialize the model components
 	storm::storage::sparse::ModelComponents<ValueType, RewardModelType> modelComponents(
-		transitionMatrixBuilder.build(0, transitionMatrixBuilder.getCurrentRowGroupCount())
+		this->buildTransitionMatrix()
 		, this->buildStateLabeling()
 		, std::unordered_map<std::string, RewardModelType>()
 		, !generator->isDiscreteTimeModel()
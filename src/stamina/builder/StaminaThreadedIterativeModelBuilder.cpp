@@ -36,8 +36,6 @@ StaminaThreadedIterativeModelBuilder<ValueType, RewardModelType, StateType>::Sta
 	)
 	, controlThread(this, Options::threads)
 	, controlThreadsCreated(false)
-	, generators(nullptr)
-
 {
 	// Intentionally left empty
 }
@@ -52,11 +50,17 @@ StaminaThreadedIterativeModelBuilder<ValueType, RewardModelType, StateType>::Sta
 	)
 	, controlThread(this, Options::threads)
 	, controlThreadsCreated(false)
-	, generators(nullptr)
 {
 	// Intentionally left empty
 }
 
+template<typename ValueType, typename RewardModelType, typename StateType>
+StaminaThreadedIterativeModelBuilder<ValueType, RewardModelType, StateType>::~StaminaThreadedIterativeModelBuilder() {
+	for (auto explorationThread : explorationThreads) {
+		delete explorationThread;
+	}
+}
+
 template<typename ValueType, typename RewardModelType, typename StateType>
 void
 StaminaThreadedIterativeModelBuilder<ValueType, RewardModelType, StateType>::buildMatrices(
@@ -103,7 +107,7 @@ StaminaThreadedIterativeModelBuilder<ValueType, RewardModelType, StateType>::bui
 					, this->controlThread // Control Thread
 					, this->getGenerator()->getVariableInformation().getTotalBitOffset(true)// state size
 					, & this->getStateMap()
-					, this->generators->at(currentThreadIndex - 1)
+					, this->generators.at(currentThreadIndex - 1)
 					// , stateToIdCallback
 				)
 			);
@@ -178,10 +182,7 @@ StaminaThreadedIterativeModelBuilder<ValueType, RewardModelType, StateType>::bui
 		this->generator->load(currentState);
 
 		if (this->formulaMatchesExpression && !Options::no_prop_refine) {
-			storm::expressions::SimpleValuation valuation = this->generator->currentStateToSimpleValuation();
-			// bool evaluationAtCurrentState = propertyExpression->evaluateAsBool(&valuation);
-			bool leftEvaluation = this->leftPropertyExpression->evaluateAsBool(&valuation);
-			bool rightEvaluation = this->rightPropertyExpression->evaluateAsBool(&valuation);;
+			auto [leftEvaluation, rightEvaluation] = this->evaluatePropertyExpressions(currentState);
 			// The left evaluation is, for a property P=?[ phi1 U[] phi2 ], the state evaluation
 			// of phi1(s), and the right evaluation is phi2(s). Our formula for early termination
 			// is !leftEvaluation || rightEvaluation, because
@@ -195,7 +196,7 @@ StaminaThreadedIterativeModelBuilder<ValueType, RewardModelType, StateType>::bui
 				this->createTransition(currentIndex, currentIndex, 1.0);
 				// We treat this state as terminal even though it is also absorbing and does not
 				// go to our artificial absorbing state
-				this->currentProbabilityState->terminal = true;
+				this->stateMap.setTerminal(this->currentProbabilityState, true);
 				this->numberTerminal++;
 				// Do NOT place this in the deque of states we should start with next iteration
 				continue;
@@ -203,13 +204,17 @@ StaminaThreadedIterativeModelBuilder<ValueType, RewardModelType, StateType>::bui
 		}
 
 		// Add the state rewards to the corresponding reward models.
-		// Do not explore if state is terminal and its reachability probability is less than kappa
-		if (this->currentProbabilityState->isTerminal() && this->currentProbabilityState->getPi() < this->localKappa) {
+		// Do not explore if state is terminal and its reachability probability is less than kappa, or
+		// if the exploration budget has run out
+		if (this->currentProbabilityState->isTerminal() && (
+			this->currentProbabilityState->getPi() < this->localKappa
+			|| this->checkExplorationBudget(this->stateStorage.getNumberOfStates())
+		)) {
 			// Do not connect to absorbing yet
 			// Place this in statesTerminatedLastIteration
-			if ( !this->currentProbabilityState->wasPutInTerminalQueue ) {
+			if ( !this->currentProbabilityState->wasPutInTerminalQueue() ) {
 				this->statesTerminatedLastIteration.emplace_back(currentProbabilityStatePair);
-				this->currentProbabilityState->wasPutInTerminalQueue = true;
+				this->currentProbabilityState->setPutInTerminalQueue(true);
 				++this->currentRow;
 				++this->currentRowGroup;
 			}
@@ -221,7 +226,7 @@ StaminaThreadedIterativeModelBuilder<ValueType, RewardModelType, StateType>::bui
 		// We assume that if we make it here, our state is either nonterminal, or its reachability probability
 		// is greater than kappa
 		// Expand (explore next states)
-		storm::generator::StateBehavior<ValueType, StateType> behavior = this->generator->expand(stateToIdCallbackWithTerminalTracking);
+		storm::generator::StateBehavior<ValueType, StateType> behavior = this->expandState(currentIndex, stateToIdCallbackWithTerminalTracking);
 
 		auto stateRewardIt = behavior.getStateRewards().begin();
 		for (auto& rewardModelBuilder : rewardModelBuilders) {
@@ -233,7 +238,7 @@ StaminaThreadedIterativeModelBuilder<ValueType, RewardModelType, StateType>::bui
 		// If there is no behavior, we have an error.
 		if (behavior.empty()) {
 			// Make absorbing
-			transitionMatrixBuilder.addNextValue(this->currentRow, currentIndex, 1.0);
+			this->createTransition(currentIndex, currentIndex, 1.0);
 			continue;
 			// StaminaMessages::warn("Behavior for state " + std::to_string(currentIndex) + " was empty!");
 		}
@@ -289,7 +294,7 @@ StaminaThreadedIterativeModelBuilder<ValueType, RewardModelType, StateType>::bui
 						nextProbabilityState->addToPi(this->currentProbabilityState->getPi() * probability);
 					}
 
-					if (this->currentProbabilityState->isNew) {
+					if (this->currentProbabilityState->isNew()) {
 						this->createTransition(currentIndex, sPrime, stateProbabilityPair.second);
 						this->numberTransitions++;
 					}
@@ -300,12 +305,12 @@ StaminaThreadedIterativeModelBuilder<ValueType, RewardModelType, StateType>::bui
 			firstChoiceOfState = false;
 		}
 
-		this->currentProbabilityState->isNew = false;
+		this->currentProbabilityState->setNew(false);
 
 		if (this->currentProbabilityState->isTerminal() && this->numberTerminal > 0) {
 			this->numberTerminal--;
 		}
-		this->currentProbabilityState->setTerminal(false);
+		this->stateMap.setTerminal(this->currentProbabilityState, false);
 		this->currentProbabilityState->setPi(0.0);
 
 		++this->currentRowGroup;
@@ -340,12 +345,13 @@ StaminaThreadedIterativeModelBuilder<ValueType, RewardModelType, StateType>::bui
 	}
 
 	/*
-	 * The hold (auto set to true in thread constructor) make it so these threads don't just stop after starting.
-	 * Therefore after everything is set up, we must turn off the hold. However:
-	 *     + The threads must be STARTED in order to request cross exploration. TODO: do they?
-	 *     + Threads won't die when hold is true.
+	 * The hold on the control thread makes it so that it does not decide exploration is finished while
+	 * all exploration threads are parked because we have not handed out the initial states yet.
+	 * Therefore after everything is set up, we must turn off the hold.
 	 */
-
+	this->controlThread.setHold(true);
+	// Every exploration thread is active until it first parks
+	this->controlThread.resetQuiescence(this->explorationThreads.size());
 	// Start control thread
 	this->controlThread.startThread();
 
@@ -357,10 +363,16 @@ StaminaThreadedIterativeModelBuilder<ValueType, RewardModelType, StateType>::bui
 
 	uint8_t threadIndex = 1;
 	for (auto & terminalState : this->fastTerminalStates) {
-		auto & explorationThread = this->explorationThreads[threadIndex - 1];
-		// TODO: ask for cross exploration from thread at that index
-		// auto state = this->stateMap.get(terminalState);
-		STAMINA_DEBUG_MESSAGE("Requesting cross exploration of state to thread " << threadIndex);
+		// States owned since a previous iteration stay with their owner
+		auto ownerAndIndex = this->controlThread.requestOwnership(terminalState, threadIndex);
+		uint8_t owner = ownerAndIndex.first;
+		auto probabilityState = this->stateMap.get(ownerAndIndex.second);
+		if (probabilityState != nullptr) {
+			probabilityState->transferOwnership(threads::NO_THREAD, threadIndex);
+			owner = probabilityState->getOwner();
+		}
+		auto & explorationThread = this->explorationThreads[owner - 1];
+		STAMINA_DEBUG_MESSAGE("Requesting cross exploration of state to thread " << owner);
 		explorationThread->requestCrossExploration(terminalState, 0.0);
 		if (threadIndex == Options::threads) {
 			threadIndex = 1;
@@ -369,7 +381,7 @@ StaminaThreadedIterativeModelBuilder<ValueType, RewardModelType, StateType>::bui
 			threadIndex++;
 		}
 	}
-	this->controlThread.setHold(false);
+	this->controlThread.releaseHold();
 
 	// Remove the hold on all of the worker threads
 	for (auto & explorationThread : this->explorationThreads) {
@@ -388,6 +400,17 @@ StaminaThreadedIterativeModelBuilder<ValueType, RewardModelType, StateType>::bui
 	// Control thread must be the one to terminate the other threads, so it must be alive when they all
 	// are joined
 
+	// The exploration threads only add states to the control thread's state map, so copy the new
+	// states into the state storage now that no other thread is running
+	StateType firstNewIndex = static_cast<StateType>(this->stateStorage.getNumberOfStates());
+	this->controlThread.getStateOwnership().forEachSince(
+		firstNewIndex
+		, [&](CompressedState const & state, uint8_t owner, StateType index) {
+			this->stateStorage.stateToId.findOrAdd(state, index);
+		}
+	);
+	this->numberStates = this->stateStorage.stateToId.size();
+
 }
 
 template <typename ValueType, typename RewardModelType, typename StateType>
@@ -407,26 +430,28 @@ StaminaThreadedIterativeModelBuilder<ValueType, RewardModelType, StateType>::get
 	bool stateIsExisting = nextState != nullptr;
 
 	this->stateStorage.stateToId.findOrAdd(state, actualIndex);
+	// Make the state known to the exploration threads, without giving it an owner yet
+	this->controlThread.requestOwnership(state, threads::NO_THREAD, actualIndex);
 	// Handle conditional enqueuing
 	if (this->isInit) {
 		if (!stateIsExisting) {
 			// Create a ProbabilityState for each individual state
-			ProbabilityState<StateType> * initProbabilityState = this->memoryPool.allocate();
-			*initProbabilityState = ProbabilityState<StateType>(
+			ProbabilityState<StateType> * initProbabilityState = this->stateMap.put(
 				actualIndex
-				, 1.0
-				, true
+				, ProbabilityState<StateType>(
+					actualIndex
+					, 1.0
+					, true
+				)
 			);
 			// Add to fast terminal states
 			fastTerminalStates.emplace_back(state);
 			this->numberTerminal++;
-			this->stateMap.put(actualIndex, initProbabilityState);
 			this->statesToExplore.push_back(std::make_pair(initProbabilityState, state));
 			initProbabilityState->iterationLastSeen = this->iteration;
 		}
 		else {
 			ProbabilityState<StateType> * initProbabilityState = nextState;
-			this->stateMap.put(actualIndex, initProbabilityState);
 			this->statesToExplore.push_back(std::make_pair(initProbabilityState, state));
 			initProbabilityState->iterationLastSeen = this->iteration;
 		}
@@ -467,15 +492,16 @@ StaminaThreadedIterativeModelBuilder<ValueType, RewardModelType, StateType>::get
 		}
 		else {
 			// This state has not been seen so create a new ProbabilityState
-			ProbabilityState<StateType> * nextProbabilityState = this->memoryPool.allocate();
-			*nextProbabilityState = ProbabilityState<StateType>(
+			ProbabilityState<StateType> * nextProbabilityState = this->stateMap.put(
 				actualIndex
-				, 0.0
-				, true
+				, ProbabilityState<StateType>(
+					actualIndex
+					, 0.0
+					, true
+				)
 			);
 			// Add to fast terminal states
 			fastTerminalStates.emplace_back(state);
-			this->stateMap.put(actualIndex, nextProbabilityState);
 			nextProbabilityState->iterationLastSeen = this->iteration;
 			// exploredStates.emplace(actualIndex);
 			this->statesToExplore.push_back(std::make_pair(nextProbabilityState, state));
@@ -496,18 +522,6 @@ StaminaThreadedIterativeModelBuilder<ValueType, RewardModelType, StateType>::get
 	// return currentExplorationThreads;
 }
 
-template <typename ValueType, typename RewardModelType, typename StateType>
-void
-StaminaThreadedIterativeModelBuilder<ValueType, RewardModelType, StateType>::setGeneratorsVector(
-	std::vector<std::shared_ptr<storm::generator::PrismNextStateGenerator<ValueType, StateType>>> & generators
-) {
-	// Check the size
-	if (generators.size() != Options::threads) {
-		StaminaMessages::errorAndExit("Generators vector size does not match thread count!");
-	}
-	this->generators = &generators;
-}
-
 template class StaminaThreadedIterativeModelBuilder<double, storm::models::sparse::StandardRewardModel<double>, uint32_t>;
 
 } // namespace builder
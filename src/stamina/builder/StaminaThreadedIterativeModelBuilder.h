@@ -61,6 +61,10 @@ namespace stamina {
 				storm::prism::Program const& program
 				, storm::generator::NextStateGeneratorOptions const& generatorOptions = storm::generator::NextStateGeneratorOptions()
 			);
+			/**
+			 * Deletes the exploration threads. They must not be running.
+			 * */
+			~StaminaThreadedIterativeModelBuilder();
 			/**
 			* Builds transition matrix of truncated state space for the given program.
 			*
@@ -86,12 +90,7 @@ namespace stamina {
 			 * */
 			StateType getOrAddStateIndexAndTrackTerminal(CompressedState const& state);
 			std::vector<typename threads::ExplorationThread<ValueType, RewardModelType, StateType> *> const & getExplorationThreads() const override;
-			/**
-			 * Sets a vector of generators for the threads
-			 * */
-			void setGeneratorsVector(std::vector<std::shared_ptr<storm::generator::PrismNextStateGenerator<ValueType, StateType>>> & generators);
 		private:
-			std::vector<std::shared_ptr<storm::generator::PrismNextStateGenerator<ValueType, StateType>>> * generators;
 			threads::ControlThread<ValueType, RewardModelType, StateType> controlThread;
 			std::vector<typename threads::ExplorationThread<ValueType, RewardModelType, StateType> *> explorationThreads;
 			bool controlThreadsCreated;
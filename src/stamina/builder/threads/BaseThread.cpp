@@ -17,7 +17,9 @@
  *
  **/
 #include "BaseThread.h"
+#include "ExplorationThreadPool.h"
 #include "core/StaminaMessages.h"
+#include "builder/StaminaModelBuilder.h"
 
 #include <thread>
 
@@ -30,12 +32,16 @@ BaseThread<ValueType, RewardModelType, StateType>::BaseThread(
 	StaminaModelBuilder<ValueType, RewardModelType, StateType> * parent
 ) : parent(parent)
 	, finished(false)
-	, threadLoop(nullptr)
 	, hold(true)
 {
 	// Intentionally left empty
 }
 
+template <typename ValueType, typename RewardModelType, typename StateType>
+BaseThread<ValueType, RewardModelType, StateType>::~BaseThread() {
+	join();
+}
+
 template <typename ValueType, typename RewardModelType, typename StateType>
 const StaminaModelBuilder<ValueType, RewardModelType, StateType> *
 BaseThread<ValueType, RewardModelType, StateType>::getParent() {
@@ -45,11 +51,19 @@ BaseThread<ValueType, RewardModelType, StateType>::getParent() {
 template <typename ValueType, typename RewardModelType, typename StateType>
 void
 BaseThread<ValueType, RewardModelType, StateType>::startThread() {
+	// Never start a second run while the previous one is still going
+	join();
 	finished = false;
-	this->threadLoop = new std::thread(
-		&BaseThread::mainLoop
-		, this
-	);
+	auto explorationPool = parent->getExplorationPool();
+	if (explorationPool != nullptr) {
+		this->pooledLoop = explorationPool->submit([this] { this->mainLoop(); });
+	}
+	else {
+		this->threadLoop = std::thread(
+			&BaseThread::mainLoop
+			, this
+		);
+	}
 }
 
 template <typename ValueType, typename RewardModelType, typename StateType>
@@ -73,8 +87,11 @@ BaseThread<ValueType, RewardModelType, StateType>::terminate() {
 template <typename ValueType, typename RewardModelType, typename StateType>
 void
 BaseThread<ValueType, RewardModelType, StateType>::join() {
-	if (this->threadLoop->joinable()) {
-		this->threadLoop->join();
+	if (this->pooledLoop.valid()) {
+		this->pooledLoop.get();
+	}
+	if (this->threadLoop.joinable()) {
+		this->threadLoop.join();
 	}
 }
 
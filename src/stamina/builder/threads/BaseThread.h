@@ -27,7 +27,9 @@
 #define STAMINA_BUILDER_THREADS_BASETHREAD_H
 
 #include <thread>
+#include <future>
 #include <shared_mutex>
+#include <atomic>
 
 #include "stamina/builder/__storm_needed_for_builder.h"
 
@@ -44,8 +46,8 @@ namespace stamina {
 			const uint8_t NO_THREAD = 0;
 
 			/**
-			* Base class for all threads. Automatically constructs a thread which runs
-			* the mainLoop function.
+			* Base class for all threads. Runs the mainLoop function either as a job on the parent's
+			* ExplorationThreadPool or, if the parent has no pool, on a std::thread of its own.
 			* */
 			template <typename ValueType, typename RewardModelType, typename StateType>
 			class BaseThread {
@@ -56,13 +58,18 @@ namespace stamina {
 				* @param parent The model builder who owns this thread
 				* */
 				BaseThread(StaminaModelBuilder<ValueType, RewardModelType, StateType> * parent);
+				/**
+				 * Joins this thread if it is still running
+				 * */
+				virtual ~BaseThread();
 				/**
 				* Pure virtual function for the main loop. When this function returns,
 				* the thread dies.
 				* */
 				virtual void mainLoop() = 0;
 				/**
-				* Creates and starts this thread in the background
+				* Starts this thread in the background. If it was started before, the previous run is
+				* joined first.
 				* */
 				void startThread();
 				void startThreadAndWait();
@@ -73,18 +80,24 @@ namespace stamina {
 				* */
 				const StaminaModelBuilder<ValueType, RewardModelType, StateType> * getParent();
 				/**
-				 * Joins the
+				 * Waits for the main loop to return. Does nothing if the thread is not running.
 				 * */
 				void join();
-				void terminate();
+				/**
+				 * Tells this thread to stop once it returns to its main loop
+				 * */
+				virtual void terminate();
 				void setHold(bool hold);
 				bool isHolding();
 			protected:
-				bool finished;
-				bool hold; // Should we continue idling even if finished?
+				std::atomic<bool> finished;
+				std::atomic<bool> hold; // Should we continue idling even if finished?
 				StaminaModelBuilder<ValueType, RewardModelType, StateType> * parent;
 			private:
-				std::thread * threadLoop;
+				// Used when the parent has no pool
+				std::thread threadLoop;
+				// Used when the main loop runs as a job on the parent's pool
+				std::future<void> pooledLoop;
 			};
 
 			// Forward declare inherited classes
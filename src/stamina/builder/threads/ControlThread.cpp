@@ -34,63 +34,39 @@ ControlThread<ValueType, RewardModelType, StateType>::ControlThread(
 	, uint8_t numberExplorationThreads
 ) : BaseThread<ValueType, RewardModelType, StateType>(parent)
 	, numberExplorationThreads(numberExplorationThreads)
-	, stateThreadMap(*(new storm::storage::BitVectorHashMap<uint8_t, storm::storage::Murmur3BitVectorHash<StateType>>(parent->getGenerator()->getStateSize())))
+	, activeThreads(0)
+	, pendingBatches(0)
+	, stateOwnership(parent->getGenerator()->getStateSize())
 {
 	// Create transition queues
 	for (int i = 0; i < Options::threads; i++) {
-		transitionQueues.push_back(LockableDeque());
+		transitionQueues.emplace_back(new util::SpscRingBuffer<std::vector<Transition>>());
 	}
 }
 
 template <typename ValueType, typename RewardModelType, typename StateType>
 std::pair<uint8_t, StateType>
 ControlThread<ValueType, RewardModelType, StateType>::requestOwnership(CompressedState const & state, uint8_t threadIndex, StateType requestedId) {
-	// Test to see if a thread already owns this state.
-	// TODO: should this pre-lock even be in here?
-	if (stateThreadMap.contains(state)) {
-		return std::make_pair(
-			stateThreadMap.getValue(state)
-			, this->parent->getStateStorage().stateToId.getValue(state)
-		);
-	}
-	// Lock the ownership mutex
-	std::lock_guard<std::shared_mutex> lock(ownershipMutex);
-	if (stateThreadMap.contains(state)) {
-		return std::make_pair(
-			stateThreadMap.getValue(state)
-			, this->parent->getStateStorage().stateToId.getValue(state)
-		);
-	}
-	else {
-		// Claim ownership of state
-		stateThreadMap.findOrAdd(
-			state
-			, threadIndex
-		);
-	}
-	// Get the state index
-	StateType stateIndex = static_cast<StateType>(this->parent->getStateStorage().getNumberOfStates());
-	return std::make_pair(threadIndex, stateIndex);
+	return stateOwnership.findOrAdd(state, threadIndex, requestedId);
 }
 
 template <typename ValueType, typename RewardModelType, typename StateType>
 uint8_t
 ControlThread<ValueType, RewardModelType, StateType>::whoOwns(CompressedState const & state) const {
-	if (stateThreadMap.contains(state)) {
-		return stateThreadMap.getValue(state);
-	}
 	// Index 0 (the same index as the absorbing state) indicates that no thread owns this state.
-	return 0;
+	return stateOwnership.find(state).first;
 }
 
 template <typename ValueType, typename RewardModelType, typename StateType>
 StateType
 ControlThread<ValueType, RewardModelType, StateType>::whatIsIndex(CompressedState const & state) {
-	// Don't need to lock it in this function
-	if (this->parent->getStateStorage().stateToId.contains(state)) {
-		return this->parent->getStateStorage().stateToId.getValue(state);
-	}
-	return 0;
+	return stateOwnership.find(state).second;
+}
+
+template <typename ValueType, typename RewardModelType, typename StateType>
+util::ConcurrentStateMap<StateType> &
+ControlThread<ValueType, RewardModelType, StateType>::getStateOwnership() {
+	return stateOwnership;
 }
 
 template <typename ValueType, typename RewardModelType, typename StateType>
@@ -101,10 +77,30 @@ ControlThread<ValueType, RewardModelType, StateType>::requestInsertTransition(
 	, StateType to
 	, double rate
 ) {
-	LockableDeque & tQueue = transitionQueues[thread - 1];
-	tQueue.lockThread();
-	tQueue.emplace_back(from, to, rate);
-	tQueue.unlockThread();
+	std::vector<Transition> transitions;
+	transitions.emplace_back(from, to, rate);
+	requestInsertTransitions(thread, std::move(transitions));
+}
+
+template <typename ValueType, typename RewardModelType, typename StateType>
+void
+ControlThread<ValueType, RewardModelType, StateType>::requestInsertTransitions(
+	uint8_t thread
+	, std::vector<Transition> && transitions
+) {
+	if (transitions.empty()) {
+		return;
+	}
+	auto & queue = transitionQueues[thread - 1];
+	if (!queue->tryPush(std::move(transitions))) {
+		// Make sure we are not waiting on a sleeping control thread
+		notifyControl();
+		queue->push(std::move(transitions));
+	}
+	// Only the first batch since the control thread last drained the queues has to wake it
+	if (pendingBatches.fetch_add(1) == 0) {
+		notifyControl();
+	}
 }
 
 template <typename ValueType, typename RewardModelType, typename StateType>
@@ -112,22 +108,13 @@ void
 ControlThread<ValueType, RewardModelType, StateType>::requestCrossExplorationFromThread(
 	StateProbability stateAndProbability
 	, uint8_t threadIndex
-	, StateType fromIndex
-	, ValueType transitionRate
 ) {
-	// TODO: implement
 	// Pointer black magic because you can't have a reference or variable of an abstract class
-	auto explorationThread = &(this->explorationThreads[threadIndex - 1]);
+	auto explorationThread = this->parent->getExplorationThreads()[threadIndex - 1];
 	explorationThread->requestCrossExploration(
 		stateAndProbability.state
 		, stateAndProbability.deltaPi
 	);
-	requestInsertTransition(
-		threadIndex
-		, fromIndex
-		, stateAndProbability.index
-		, transitionRate
-	);
 	// explorationThread(stateAndProbability.state, stateAndProbability.probability);
 }
 
@@ -135,110 +122,102 @@ template <typename ValueType, typename RewardModelType, typename StateType>
 void
 ControlThread<ValueType, RewardModelType, StateType>::mainLoop() {
 	STAMINA_DEBUG_MESSAGE("Starting control thread.");
-	uint8_t numberFinishedThreads;
-	auto explorationThreads = this->parent->getExplorationThreads();
-	while (!this->finished || this->hold) { // allow for this thread to be killed outside of its main loop
-		bool exitThisIteration = false;
-		numberFinishedThreads = 0;
-
-		for (auto explorationThread : explorationThreads) {
-			if (!explorationThread) {
-				StaminaMessages::warning("Somehow this exploration thread is null!");
-			}
-			else if (explorationThread->isIdling()) {
-				++numberFinishedThreads;
-			}
-		}
-		if (numberFinishedThreads == this->parent->getExplorationThreads().size() && !this->hold) {
-			// We have finished.
-			exitThisIteration = true;
-		}
+	while (true) {
 		registerTransitions();
-		if (exitThisIteration) {
-			STAMINA_DEBUG_MESSAGE("Exiting control thread main loop because all threads are finished");
-			STAMINA_DEBUG_MESSAGE("Sanity check: there are the following number of exploration threads: " << this->parent->getExplorationThreads().size());
-			for (auto explorationThread : this->parent->getExplorationThreads()) {
-				STAMINA_DEBUG_MESSAGE("Killing exploration thread");
-				explorationThread->terminate();
-				explorationThread->join();
-			}
-			this->finished = true;
-			this->hold = false;
-			// this->terminate();
-			STAMINA_DEBUG_MESSAGE("Ending this iteration now!");
-			registerTransitions();
-			return;
+		// Exploration threads only read whether the budget is exhausted, since the control thread is
+		// the one which creates transitions
+		this->parent->checkExplorationBudget(stateOwnership.size());
+		// Sleep until a batch of transitions is published or all threads are parked
+		std::unique_lock<std::mutex> lock(controlMutex);
+		controlCondition.wait(
+			lock
+			, [this]() { return pendingBatches.load() > 0 || (activeThreads.load() == 0 && !this->hold); }
+		);
+		bool quiescent = activeThreads.load() == 0 && !this->hold;
+		lock.unlock();
+		if (quiescent) {
+			break;
 		}
-		// TODO: de-fragmentation
-		// TODO: LRU Cache
 	}
+	STAMINA_DEBUG_MESSAGE("Exiting control thread main loop because all threads are finished");
+	for (auto explorationThread : this->parent->getExplorationThreads()) {
+		STAMINA_DEBUG_MESSAGE("Killing exploration thread");
+		explorationThread->terminate();
+		explorationThread->join();
+	}
+	this->finished = true;
+	this->hold = false;
+	// Flush the batches sent before the threads parked
+	registerTransitions();
+	// TODO: de-fragmentation
+	// TODO: LRU Cache
 }
 
 template <typename ValueType, typename RewardModelType, typename StateType>
 void
-ControlThread<ValueType, RewardModelType, StateType>::registerTransitions() {
-		// Make sure that we flush the queues AFTER we determine whether to exit. This prevents a
-		// thread from requesting a transition to be added
-		STAMINA_DEBUG_MESSAGE("Size of transition queues: " << transitionQueues.size());
-		for (auto q : transitionQueues) {
-			q.lockThread();
-			STAMINA_DEBUG_MESSAGE("Queue size: " << q.size());
-			while (!q.empty()) {
-				// Request that the parent class
-				this->parent->createTransition(q.top());
-				q.pop();
-				STAMINA_DEBUG_MESSAGE("Creating a transition for a state");
-			}
-			q.unlockThread();
-		}
-
-}
-// Lockable Deque methods
-
-template <typename ValueType, typename RewardModelType, typename StateType>
-int
-ControlThread<ValueType, RewardModelType, StateType>::LockableDeque::size() const {
-	return queue.size();
+ControlThread<ValueType, RewardModelType, StateType>::resetQuiescence(uint8_t numberActiveThreads) {
+	activeThreads.store(numberActiveThreads);
 }
 
 template <typename ValueType, typename RewardModelType, typename StateType>
 void
-ControlThread<ValueType, RewardModelType, StateType>::LockableDeque::emplace_back(
-	StateType from
-	, StateType to
-	, double rate
-) {
-	Transition t(from, to, rate);
-	queue.emplace_back(t);
+ControlThread<ValueType, RewardModelType, StateType>::threadParked() {
+	if (activeThreads.fetch_sub(1) == 1) {
+		notifyControl();
+	}
 }
 
 template <typename ValueType, typename RewardModelType, typename StateType>
-bool
-ControlThread<ValueType, RewardModelType, StateType>::LockableDeque::empty() const {
-	return queue.empty();
+void
+ControlThread<ValueType, RewardModelType, StateType>::releaseHold() {
+	this->hold = false;
+	// All exploration threads may have parked already
+	notifyControl();
 }
 
 template <typename ValueType, typename RewardModelType, typename StateType>
 void
-ControlThread<ValueType, RewardModelType, StateType>::LockableDeque::lockThread() {
-	lock.lock();
+ControlThread<ValueType, RewardModelType, StateType>::threadUnparked() {
+	activeThreads.fetch_add(1);
 }
 
 template <typename ValueType, typename RewardModelType, typename StateType>
-void ControlThread<ValueType, RewardModelType, StateType>::LockableDeque::unlockThread() {
-	lock.unlock();
+void
+ControlThread<ValueType, RewardModelType, StateType>::wakeIdleThread() {
+	if (activeThreads.load() >= static_cast<int32_t>(numberExplorationThreads)) {
+		return;
+	}
+	for (auto explorationThread : this->parent->getExplorationThreads()) {
+		if (explorationThread->isIdling()) {
+			explorationThread->wake();
+			return;
+		}
+	}
 }
 
 template <typename ValueType, typename RewardModelType, typename StateType>
-typename ControlThread<ValueType, RewardModelType, StateType>::Transition
-ControlThread<ValueType, RewardModelType, StateType>::LockableDeque::top() const {
-	return queue.front();
+void
+ControlThread<ValueType, RewardModelType, StateType>::notifyControl() {
+	std::lock_guard<std::mutex> lock(controlMutex);
+	controlCondition.notify_one();
 }
 
 template <typename ValueType, typename RewardModelType, typename StateType>
 void
-ControlThread<ValueType, RewardModelType, StateType>::LockableDeque::pop() {
-	queue.pop_front();
+ControlThread<ValueType, RewardModelType, StateType>::registerTransitions() {
+	// Make sure that we flush the queues AFTER we determine whether to exit. This prevents a
+	// thread from requesting a transition to be added
+	int64_t numberOfBatches = 0;
+	for (auto & queue : transitionQueues) {
+		while (auto transitions = queue->front()) {
+			// Request that the parent class take the batch over
+			this->parent->createTransitions(std::move(*transitions));
+			queue->pop();
+			++numberOfBatches;
+		}
+	}
+	// A batch may be taken before its producer counted it, so this may go below 0 for a moment
+	pendingBatches.fetch_sub(numberOfBatches);
 }
 
 template class ControlThread<double, storm::models::sparse::StandardRewardModel<double>, uint32_t>;
@@ -36,9 +36,14 @@
 #include "stamina/builder/StaminaModelBuilder.h"
 #include "stamina/builder/StateAndTransitions.h"
 
-#include "storm/storage/BitVectorHashMap.h"
+#include "util/ConcurrentStateMap.h"
+#include "util/SpscRingBuffer.h"
 
-#include <deque>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
 
 namespace stamina {
 	namespace builder {
@@ -56,58 +61,6 @@ namespace stamina {
 				typedef StaminaTransitionInfo<StateType> Transition;
 				typedef StaminaStateAndThreadIndex<StateType> StateAndThreadIndex;
 
-				class LockableDeque {
-				public:
-					LockableDeque()
-						// : guard(this->lock)
-					{
-						// Intentionally left empty
-					}
-
-					LockableDeque(const LockableDeque & other)
-						// : guard(this->lock)
-						: queue(other.queue)
-					{
-						// We don't need to copy the lock, just the queue
-					}
-					int size() const;
-					/**
-					 * Locks the queue and emplaces an element
-					 *
-					 * @param from The state we are going from
-					 * @param to The state the transition goes to
-					 * @param rate The transition rate of this transition
-					 * */
-					void emplace_back(StateType from, StateType to, double rate);
-					/**
-					 * Determines whether the internal queue is empty. This method is
-					 * const as it does not change anything about the internals of this
-					 * datastructure
-					 *
-					 * @return whether the internal queue is empty
-					 * */
-					bool empty() const;
-					/**
-					 * Locks the mutex with a std::lock_guard and leaves it locked
-					 * */
-					void lockThread();
-					/**
-					 * Unlocks the std::lock_guard guarding the mutex
-					 * */
-					void unlockThread();
-					/**
-					 * Gets the top element (or front element) of the internal queue.
-					 *
-					 * @return The first transition
-					 * */
-					Transition top() const;
-					void pop();
-				private:
-					std::deque<Transition> queue;
-					mutable std::shared_mutex lock;
-					// std::lock_guard<std::shared_mutex> guard;
-				};
-
 				/**
 				* Constructor for ControlThread. Primarily just calls super class constructor
 				*
@@ -118,27 +71,29 @@ namespace stamina {
 				ControlThread(
 					StaminaModelBuilder<ValueType, RewardModelType, StateType> * parent
 					, uint8_t numberExplorationThreads
-// 					, storm::storage::BitVectorHashMap<uint8_t>& stateThreadMap // State storage owned by parents
 				);
 				/**
 				* Requests ownership of a state for a particular thread. This is intended
 				* to be called by the thread whose index matches the second parameter in
-				* this function. This function *locks the mutex* and so it should not be
-				* used if we just wish to ask who owns a particular state.
+				* this function. It does not lock: ownership and the state index are assigned
+				* together by a single CAS in the underlying util::ConcurrentStateMap.
 				*
 				* If request ownership is successful, the return value is equal to
 				* the index of the state requesting ownership of the state. However, if it
-				* is not successful, then the return value gives the thread which potentially
-				* locked the mutex and got ownership first.
+				* is not successful, then the return value gives the thread which
+				* got ownership first.
+				*
+				* States registered with threadIndex NO_THREAD (e.g., by the model builder while
+				* single threaded) are owned by the first thread to request them.
 				*
 				* @param state The state to request ownership for
 				* @param threadIndex The thread who wants ownership of the state.
 				* @param requestedId The (new) stateId that a thread can request we assign a state to
-				* @return The thread who owns the state and the new state index
+				* @return The thread who owns the state and the state index
 				* */
 				std::pair<uint8_t, StateType> requestOwnership(CompressedState const & state, uint8_t threadIndex, StateType requestedId = 0);
 				/**
-				* Gets the owning thread of a particular state without locking the mutex.
+				* Gets the owning thread of a particular state without locking.
 				* This allows for threads to use the many-read, one-write idea put forth
 				* in the paper.
 				*
@@ -154,16 +109,24 @@ namespace stamina {
 				 * @return The state index
 				 * */
 				StateType whatIsIndex(CompressedState const & state);
+				/**
+				 * Gets the map of states to their owning thread and index. States discovered by
+				 * the exploration threads are only in this map (and not in the parent's state storage)
+				 * until the parent copies them over.
+				 *
+				 * @return The state ownership map
+				 * */
+				util::ConcurrentStateMap<StateType> & getStateOwnership();
 				/**
 				* Requests a transition to be inserted (not necessarily in order).
 				* These transitions are requested by the exploration threads and
 				* are flushed to the model builder's data structure on a "when available"
 				* basis, meaning that when this thread idles, it transfers these
-				* transitions. Additionally, it maintains mutexes for each thread and
-				* only locks the mutex for that particular thread to prevent mutex collisions
-				* on the different threads requesting transition insertion.
+				* transitions. Each exploration thread has its own single-producer,
+				* single-consumer queue, so this never locks. Prefer requestInsertTransitions(),
+				* which sends all transitions of a state at once.
 				*
-				* @param thread The index of the thread making the request
+				* @param thread The index of the thread making the request. Must be the calling thread.
 				* @param from The index of the state we are transitioning from
 				* @param to The index of the state we are transitioning to
 				* @param rate The transition rate (if CTMC) or transition probability (if DTMC)
@@ -174,6 +137,18 @@ namespace stamina {
 					, StateType to
 					, double rate
 				);
+				/**
+				* Requests a batch of transitions, all going out of the same state, to be inserted.
+				* The batch is moved into the calling thread's queue and later moved (not copied) into the
+				* parent's transitionsToAdd.
+				*
+				* @param thread The index of the thread making the request. Must be the calling thread.
+				* @param transitions The transitions to insert. Left empty after the call.
+				* */
+				void requestInsertTransitions(
+					uint8_t thread
+					, std::vector<Transition> && transitions
+				);
 				/**
 				 * Requests cross exploration from a
 				 *
@@ -182,31 +157,66 @@ namespace stamina {
 				 *     deltaPi The difference in probability to add
 				 *     stateIndex The state index we found
 				 * @param threadIndex Thread index to request cross exploration from
+				 *
+				 * The transition into the state is not inserted here: the calling thread adds it to
+				 * its own batch (see requestInsertTransitions()).
 				 * */
 				void requestCrossExplorationFromThread(
 					StateProbability stateAndProbability
 					, uint8_t threadIndex
-					, StateType fromIndex
-					, ValueType transitionRate
 				);
 				/**
-				* This thread lives for the duration of all exploration threads. It waits for
-				* the exploration threads to all emit a "finished" signal, and then tells each
-				* exploration thread to die.
+				* This thread lives for the duration of all exploration threads. It sleeps until a
+				* batch of transitions is published, and exits once all exploration threads have
+				* parked, telling each exploration thread to die.
 				*
 				* The main loop for this thread also flushes things to the parents' transitionsToAdd,
 				* which is not locked or mutex'ed because there is only one worker thread to do that.
 				* */
 				virtual void mainLoop() override;
-				void terminate();
+				/**
+				 * Sets the number of active exploration threads. Must be called before the exploration
+				 * threads are started for an iteration, since they are all considered active until they park.
+				 *
+				 * @param numberActiveThreads The number of exploration threads about to start
+				 * */
+				void resetQuiescence(uint8_t numberActiveThreads);
+				/**
+				 * Called by an exploration thread when it parks. When the last active thread parks,
+				 * no thread has any work left (giving work to a thread wakes it first), so exploration
+				 * is finished and the control thread is woken.
+				 * */
+				void threadParked();
+				/**
+				 * Removes the hold set while the initial states are handed out, and wakes this thread
+				 * so that it notices if every exploration thread has already parked
+				 * */
+				void releaseHold();
+				/**
+				 * Called (by the waker) when a parked exploration thread is given work
+				 * */
+				void threadUnparked();
+				/**
+				 * Wakes one parked exploration thread, if there are any, so that it can steal work
+				 * */
+				void wakeIdleThread();
 			protected:
 				void registerTransitions();
+				/**
+				 * Wakes the control thread (e.g., because a transition queue is full)
+				 * */
+				void notifyControl();
 			private:
-				std::vector<LockableDeque> transitionQueues;
-				std::shared_mutex ownershipMutex;
+				// One queue per exploration thread, each holding per-state batches of transitions
+				std::vector<std::unique_ptr<util::SpscRingBuffer<std::vector<Transition>>>> transitionQueues;
 				const uint8_t numberExplorationThreads;
-				storm::storage::BitVectorHashMap<uint8_t, storm::storage::Murmur3BitVectorHash<StateType>>& stateThreadMap;
-				std::vector<ExplorationThread<ValueType, RewardModelType, StateType>> explorationThreads;
+				// Number of exploration threads which are not parked (or have been given work while parked)
+				std::atomic<int32_t> activeThreads;
+				// Batches published to transitionQueues and not yet registered. Guards sleeping without a timeout
+				std::atomic<int64_t> pendingBatches;
+				std::mutex controlMutex;
+				std::condition_variable controlCondition;
+				util::ConcurrentStateMap<StateType> stateOwnership;
 			};
 
 		} // namespace threads
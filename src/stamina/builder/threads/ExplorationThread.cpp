@@ -19,6 +19,7 @@
 
 #include "ExplorationThread.h"
 #include "builder/StaminaModelBuilder.h"
+#include "builder/threads/ControlThread.h"
 
 #include "core/StaminaMessages.h"
 
@@ -43,8 +44,14 @@ ExplorationThread<ValueType, RewardModelType, StateType>::ExplorationThread(
 	, stateStorage(parent->getStateStorage())
 	, stateMap(stateMap)
 	, generator(generator)
+	, threadsafeGenerator(dynamic_cast<threadsafe::generator::ThreadsafePrismNextStateGenerator<ValueType, StateType> *>(generator.get()))
 	, stateToIdCallback(stateToIdCallback)
 	, xLock(crossExplorationQueueMutex, std::defer_lock)
+	, frontierPool(9) // 2 ^ 10
+	, numberOfStatesStolen(0)
+	, idling(false)
+	, parked(false)
+	, wakeRequested(false)
 {
 	// Intentionally left empty
 }
@@ -81,13 +88,121 @@ ExplorationThread<ValueType, RewardModelType, StateType>::requestCrossExploratio
 ) {
 	// Lock the mutex since multiple threads will be calling this function
 	// auto lock = std::unique_lock<std::shared_mutex>(crossExplorationQueueMutex);
-	std::lock_guard<std::shared_mutex> guard(crossExplorationQueueMutex);
-	// crossExplorationQueueMutex.lock();
-	crossExplorationQueue.emplace_back(
-		std::make_pair(state, deltaPi)
-	);
-	// crossExplorationQueueMutex.unlock();
-	// lock.unlock();
+	{
+		std::lock_guard<std::shared_mutex> guard(crossExplorationQueueMutex);
+		crossExplorationQueue.emplace_back(
+			std::make_pair(state, deltaPi)
+		);
+	}
+	wake();
+}
+
+template <typename ValueType, typename RewardModelType, typename StateType>
+ProbabilityStatePair<StateType> *
+ExplorationThread<ValueType, RewardModelType, StateType>::stealFrontierState() {
+	ProbabilityStatePair<StateType> * stolen = nullptr;
+	if (mainExplorationQueue.steal(stolen)) {
+		return stolen;
+	}
+	return nullptr;
+}
+
+template <typename ValueType, typename RewardModelType, typename StateType>
+void
+ExplorationThread<ValueType, RewardModelType, StateType>::releaseStolenPair(ProbabilityStatePair<StateType> * pair) {
+	frontierPool.freeRemote(pair);
+}
+
+template <typename ValueType, typename RewardModelType, typename StateType>
+ProbabilityStatePair<StateType> *
+ExplorationThread<ValueType, RewardModelType, StateType>::stealFromOtherThreads() {
+	auto const & explorationThreads = this->parent->getExplorationThreads();
+	uint8_t numberThreads = explorationThreads.size();
+	for (uint8_t offset = 1; offset < numberThreads; ++offset) {
+		// Thread indecies start at 1
+		auto victim = explorationThreads[(threadIndex - 1 + offset) % numberThreads];
+		ProbabilityStatePair<StateType> * stolen = victim->stealFrontierState();
+		if (stolen != nullptr) {
+			STAMINA_DEBUG_MESSAGE("Thread " << threadIndex << " stole a state from thread " << victim->getIndex());
+			// Cross exploration requests for this state now come to us
+			stolen->first->setOwner(threadIndex);
+			++numberOfStatesStolen;
+			// Move the stolen state into our own arena so the victim gets its memory back right away
+			auto pair = allocateFrontierPair(stolen->first, std::move(stolen->second));
+			victim->releaseStolenPair(stolen);
+			return pair;
+		}
+	}
+	return nullptr;
+}
+
+template <typename ValueType, typename RewardModelType, typename StateType>
+ProbabilityStatePair<StateType> *
+ExplorationThread<ValueType, RewardModelType, StateType>::allocateFrontierPair(
+	ProbabilityState<StateType> * probabilityState
+	, CompressedState state
+) {
+	ProbabilityStatePair<StateType> * pair = frontierPool.allocate();
+	pair->first = probabilityState;
+	pair->second = std::move(state);
+	return pair;
+}
+
+template <typename ValueType, typename RewardModelType, typename StateType>
+void
+ExplorationThread<ValueType, RewardModelType, StateType>::releaseFrontierPair(ProbabilityStatePair<StateType> * pair) {
+	frontierPool.free(pair);
+}
+
+template <typename ValueType, typename RewardModelType, typename StateType>
+void
+ExplorationThread<ValueType, RewardModelType, StateType>::flushTransitionBatch() {
+	if (transitionBatch.empty()) {
+		return;
+	}
+	controlThread.requestInsertTransitions(threadIndex, std::move(transitionBatch));
+	transitionBatch.clear();
+}
+
+template <typename ValueType, typename RewardModelType, typename StateType>
+void
+ExplorationThread<ValueType, RewardModelType, StateType>::wake() {
+	std::lock_guard<std::mutex> lock(parkMutex);
+	if (wakeRequested) {
+		return;
+	}
+	wakeRequested = true;
+	if (parked) {
+		controlThread.threadUnparked();
+		parkCondition.notify_one();
+	}
+}
+
+template <typename ValueType, typename RewardModelType, typename StateType>
+void
+ExplorationThread<ValueType, RewardModelType, StateType>::terminate() {
+	BaseThread<ValueType, RewardModelType, StateType>::terminate();
+	std::lock_guard<std::mutex> lock(parkMutex);
+	parkCondition.notify_one();
+}
+
+template <typename ValueType, typename RewardModelType, typename StateType>
+void
+ExplorationThread<ValueType, RewardModelType, StateType>::park() {
+	std::unique_lock<std::mutex> lock(parkMutex);
+	// Work may have come in since exploreStates() found nothing to do
+	if (wakeRequested || this->finished) {
+		wakeRequested = false;
+		idling = false;
+		return;
+	}
+	parked = true;
+	controlThread.threadParked();
+	parkCondition.wait(lock, [this]() { return wakeRequested || this->finished; });
+	// Whoever woke us already counted us as active again
+	parked = false;
+	wakeRequested = false;
+	idling = false;
 }
 
 template <typename ValueType, typename RewardModelType, typename StateType>
@@ -95,11 +210,17 @@ void
 ExplorationThread<ValueType, RewardModelType, StateType>::mainLoop() {
 	STAMINA_DEBUG_MESSAGE("Starting exploration thread: " << this->threadIndex);
 	idling = false;
-	while (!this->finished || this->hold) {
-		// STAMINA_DEBUG_MESSAGE("Finished is " << this->finished << " and hold is " << this->hold);
+	// Only the control thread decides when exploration is finished
+	while (!this->finished) {
 		// Explore the states in the exploration queue
 		exploreStates();
+		flushTransitionBatch();
+		if (idling) {
+			park();
+		}
 	}
+	std::lock_guard<std::mutex> lock(parkMutex);
+	wakeRequested = false;
 }
 
 template class ExplorationThread<double, storm::models::sparse::StandardRewardModel<double>, uint32_t>;
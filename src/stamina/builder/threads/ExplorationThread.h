@@ -29,9 +29,15 @@
 
 #include "BaseThread.h"
 
+#include <mutex>
+#include <condition_variable>
+
 #include "util/StateIndexArray.h"
+#include "util/WorkStealingDeque.h"
+#include "util/StateMemoryPool.h"
 #include "builder/ProbabilityState.h"
 #include "builder/StateAndTransitions.h"
+#include "threadsafe/generator/ThreadsafePrismNextStateGenerator.h"
 
 namespace stamina {
 	namespace builder {
@@ -80,6 +86,32 @@ namespace stamina {
 				* */
 				void requestCrossExploration(CompressedState const & state, double deltaPi);
 				void requestCrossExploration(StateType stateIndex, double deltaPi);
+				/**
+				 * Called by other (idle) threads to steal the oldest unexplored state from this
+				 * thread's frontier. The caller takes over ownership of the stolen state and must give
+				 * the returned pair back with releaseStolenPair().
+				 *
+				 * @return The stolen state, or nullptr if there was nothing to steal
+				 * */
+				ProbabilityStatePair<StateType> * stealFrontierState();
+				/**
+				 * Returns a pair taken with stealFrontierState() to this thread's arena. May be called by
+				 * any thread.
+				 *
+				 * @param pair The stolen pair
+				 * */
+				void releaseStolenPair(ProbabilityStatePair<StateType> * pair);
+				/**
+				 * Wakes this thread if it is parked. Must be called after giving this thread work (e.g.,
+				 * after requestCrossExploration()). If the thread is parked, it is counted as active again
+				 * by the control thread *before* this call returns, so that the caller cannot go idle
+				 * and make the control thread believe exploration has finished in the meantime.
+				 * */
+				void wake();
+				/**
+				 * Terminates this thread, waking it if it is parked
+				 * */
+				virtual void terminate() override;
 				/**
 				* Does state exploration or idles until worker thread asks to kill it.
 				* */
@@ -88,18 +120,61 @@ namespace stamina {
 				virtual void exploreStates() = 0;
 				virtual void exploreState(StateProbability & stateProbability) = 0;
 				virtual StateType enqueueSuccessors(CompressedState const & state) = 0; // stateToIdCallback
+				/**
+				 * Tries to steal a frontier state from each of the other exploration threads in turn,
+				 * starting with the thread after this one.
+				 *
+				 * @return The stolen state (now owned by this thread), or nullptr if none could be stolen
+				 * */
+				ProbabilityStatePair<StateType> * stealFromOtherThreads();
+				/**
+				 * Allocates a frontier pair from this thread's arena, so that threads do not contend
+				 * on the allocator while enqueueing successors
+				 *
+				 * @param probabilityState The state's ProbabilityState
+				 * @param state The state itself, which is moved into the pair
+				 * @return The pair, to be pushed onto mainExplorationQueue
+				 * */
+				ProbabilityStatePair<StateType> * allocateFrontierPair(ProbabilityState<StateType> * probabilityState, CompressedState state);
+				/**
+				 * Returns a frontier pair allocated by this thread once it has been explored
+				 * */
+				void releaseFrontierPair(ProbabilityStatePair<StateType> * pair);
+				/**
+				 * Sends the transitions of the state(s) explored since the last call to the control
+				 * thread in one batch
+				 * */
+				void flushTransitionBatch();
+				/**
+				 * Blocks (without using the CPU) until wake() or terminate() is called. Tells the control
+				 * thread that this thread went idle.
+				 * */
+				void park();
 				// Weak priority on crossExplorationQueue (superseded by mutex lock)
 				std::shared_mutex crossExplorationQueueMutex;
 				// The lock that locks our mutex
 				std::unique_lock<std::shared_mutex> xLock;
 				std::deque<std::pair<CompressedState, double>> crossExplorationQueue;
-				std::deque<std::pair<ProbabilityState<StateType> *, CompressedState const &>> mainExplorationQueue;
+				// Unexplored states owned by this thread. Only this thread pushes and takes, others may steal
+				util::WorkStealingDeque<ProbabilityStatePair<StateType> *> mainExplorationQueue;
+				// Arena which the pairs on mainExplorationQueue are allocated from
+				util::StateMemoryPool<ProbabilityStatePair<StateType>> frontierPool;
+				uint64_t numberOfStatesStolen;
+				// Transitions out of the state currently being explored, sent to the control thread together
+				std::vector<StaminaTransitionInfo<StateType>> transitionBatch;
 				uint32_t numberOfOwnedStates;
-				bool idling;
+				std::atomic<bool> idling;
+				// Parking. Both flags are guarded by parkMutex
+				std::mutex parkMutex;
+				std::condition_variable parkCondition;
+				bool parked;
+				bool wakeRequested;
 				ControlThread<ValueType, RewardModelType, StateType> & controlThread;
 				util::StateIndexArray<StateType, ProbabilityState<StateType>> * stateMap;
 				storm::storage::sparse::StateStorage<StateType> & stateStorage;
-				std::shared_ptr<storm::generator::PrismNextStateGenerator<ValueType, StateType>> const& generator;
+				std::shared_ptr<storm::generator::PrismNextStateGenerator<ValueType, StateType>> generator;
+				// Set if `generator` is shared with other threads, which means states must be expanded through it
+				threadsafe::generator::ThreadsafePrismNextStateGenerator<ValueType, StateType> * threadsafeGenerator;
 				std::deque<StateProbability> statesTerminatedLastIteration;
 				std::function<StateType (CompressedState const&)> stateToIdCallback;
 				// The states we should request cross exploration from
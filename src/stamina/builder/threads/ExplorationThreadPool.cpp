@@ -0,0 +1,126 @@
+/**
+ * STAMINA - the [ST]ochasic [A]pproximate [M]odel-checker for [IN]finite-state [A]nalysis
+ * Copyright (C) 2023 Fluent Verification, Utah State University
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see https://www.gnu.org/licenses/.
+ *
+ **/
+#include "ExplorationThreadPool.h"
+#include "core/StaminaMessages.h"
+#include "core/Options.h"
+#include "generator/CompiledPrismNextStateGenerator.h"
+#include "threadsafe/generator/ThreadsafePrismNextStateGenerator.h"
+
+namespace stamina {
+namespace builder {
+namespace threads {
+
+template <typename ValueType, typename StateType>
+ExplorationThreadPool<ValueType, StateType>::ExplorationThreadPool(uint8_t numberExplorationThreads)
+	: numberExplorationThreads(numberExplorationThreads)
+	, stopping(false)
+	, generatorProgram(nullptr)
+{
+	// One worker for each exploration thread and one for the control thread
+	for (uint8_t i = 0; i <= numberExplorationThreads; i++) {
+		workers.emplace_back(&ExplorationThreadPool::workerLoop, this);
+	}
+}
+
+template <typename ValueType, typename StateType>
+ExplorationThreadPool<ValueType, StateType>::~ExplorationThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		stopping = true;
+		jobs.clear();
+	}
+	jobCondition.notify_all();
+	for (auto & worker : workers) {
+		if (worker.joinable()) {
+			worker.join();
+		}
+	}
+}
+
+template <typename ValueType, typename StateType>
+std::future<void>
+ExplorationThreadPool<ValueType, StateType>::submit(std::function<void()> job) {
+	std::packaged_task<void()> task(std::move(job));
+	std::future<void> result = task.get_future();
+	{
+		std::lock_guard<std::mutex> lock(jobMutex);
+		jobs.push_back(std::move(task));
+	}
+	jobCondition.notify_one();
+	return result;
+}
+
+template <typename ValueType, typename StateType>
+std::vector<typename ExplorationThreadPool<ValueType, StateType>::Generator> const &
+ExplorationThreadPool<ValueType, StateType>::getGenerators(
+	storm::prism::Program const & program
+	, std::vector<std::shared_ptr<storm::logic::Formula const>> const & formulasVector
+) {
+	if (generatorProgram == &program && generatorFormulas == formulasVector) {
+		return generators;
+	}
+	STAMINA_DEBUG_MESSAGE("Creating " << (int) numberExplorationThreads << " generators for the exploration thread pool");
+	storm::builder::BuilderOptions options(formulasVector);
+	generators.clear();
+	if (core::Options::compiled_generator) {
+		// One compiled generator can be shared by all threads, so the program is only compiled once
+		auto shared = std::make_shared<threadsafe::generator::ThreadsafePrismNextStateGenerator<ValueType, StateType>>(program, options);
+		if (shared->isCompiled()) {
+			generators.assign(numberExplorationThreads, shared);
+		}
+	}
+	// Otherwise each thread needs its own generator
+	for (uint8_t i = generators.size(); i < numberExplorationThreads; i++) {
+		generators.push_back(stamina::generator::makeNextStateGenerator<ValueType, StateType>(program, options));
+	}
+	generatorProgram = &program;
+	generatorFormulas = formulasVector;
+	return generators;
+}
+
+template <typename ValueType, typename StateType>
+uint8_t
+ExplorationThreadPool<ValueType, StateType>::getNumberOfExplorationThreads() const {
+	return numberExplorationThreads;
+}
+
+template <typename ValueType, typename StateType>
+void
+ExplorationThreadPool<ValueType, StateType>::workerLoop() {
+	while (true) {
+		std::packaged_task<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(jobMutex);
+			jobCondition.wait(lock, [&] { return stopping || !jobs.empty(); });
+			if (stopping) {
+				return;
+			}
+			job = std::move(jobs.front());
+			jobs.pop_front();
+		}
+		job();
+	}
+}
+
+// Explicitly instantiate
+template class ExplorationThreadPool<double, uint32_t>;
+
+} // namespace threads
+} // namespace builder
+} // namespace stamina
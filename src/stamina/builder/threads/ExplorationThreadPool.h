@@ -0,0 +1,110 @@
+/**
+ * STAMINA - the [ST]ochasic [A]pproximate [M]odel-checker for [IN]finite-state [A]nalysis
+ * Copyright (C) 2023 Fluent Verification, Utah State University
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see https://www.gnu.org/licenses/.
+ *
+ **/
+
+/**
+ * A long-lived pool of worker threads for the threaded model builders.
+ *
+ * The pool is owned by the model checker and outlives any single model builder, so that checking
+ * many properties (or running many refinement iterations) does not repeatedly create and tear down
+ * OS threads. Each thread class (see BaseThread) runs its main loop as a job on this pool rather
+ * than on a thread of its own. The pool also keeps one PrismNextStateGenerator per exploration
+ * thread, which is created once per program.
+ * */
+
+#ifndef STAMINA_BUILDER_THREADS_EXPLORATIONTHREADPOOL_H
+#define STAMINA_BUILDER_THREADS_EXPLORATIONTHREADPOOL_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include "stamina/builder/__storm_needed_for_builder.h"
+
+namespace stamina {
+	namespace builder {
+		namespace threads {
+			template <typename ValueType, typename StateType>
+			class ExplorationThreadPool {
+			public:
+				typedef std::shared_ptr<storm::generator::PrismNextStateGenerator<ValueType, StateType>> Generator;
+				/**
+				 * Constructs the pool and starts its workers. Since every job runs a thread's main loop
+				 * until the end of an iteration, the pool must have at least as many workers as there are
+				 * control and exploration threads running at once.
+				 *
+				 * @param numberExplorationThreads The number of exploration threads the pool serves
+				 * */
+				ExplorationThreadPool(uint8_t numberExplorationThreads);
+				/**
+				 * Stops and joins all workers. Jobs which have not started are discarded.
+				 * */
+				~ExplorationThreadPool();
+				/**
+				 * Dispatches a job to the next idle worker.
+				 *
+				 * @param job The job to run
+				 * @return A future which becomes ready when the job returns
+				 * */
+				std::future<void> submit(std::function<void()> job);
+				/**
+				 * Gets one generator per exploration thread for a program. The generators are only
+				 * created the first time this is called for a program and set of formulas; after that
+				 * the same generators are returned. If the compiled generator is used and the program can
+				 * be compiled, every thread gets the same ThreadsafePrismNextStateGenerator.
+				 *
+				 * @param program The PRISM program to generate states for
+				 * @param formulasVector The formulas the generators must create labels for
+				 * @return One generator per exploration thread
+				 * */
+				std::vector<Generator> const & getGenerators(
+					storm::prism::Program const & program
+					, std::vector<std::shared_ptr<storm::logic::Formula const>> const & formulasVector
+				);
+				/**
+				 * Gets the number of exploration threads this pool serves
+				 * */
+				uint8_t getNumberOfExplorationThreads() const;
+			protected:
+				/**
+				 * The loop each worker runs until the pool is destroyed
+				 * */
+				void workerLoop();
+			private:
+				const uint8_t numberExplorationThreads;
+				std::vector<std::thread> workers;
+				std::deque<std::packaged_task<void()>> jobs;
+				std::mutex jobMutex;
+				std::condition_variable jobCondition;
+				bool stopping;
+				// The program and formulas the generators were created for
+				storm::prism::Program const * generatorProgram;
+				std::vector<std::shared_ptr<storm::logic::Formula const>> generatorFormulas;
+				std::vector<Generator> generators;
+			};
+		} // namespace threads
+	} // namespace builder
+} // namespace stamina
+
+#endif // STAMINA_BUILDER_THREADS_EXPLORATIONTHREADPOOL_H
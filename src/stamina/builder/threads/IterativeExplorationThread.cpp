@@ -23,6 +23,8 @@
 #include "core/StaminaMessages.h"
 #include "core/StateSpaceInformation.h"
 
+#include <algorithm>
+
 namespace stamina {
 namespace builder {
 namespace threads {
@@ -55,40 +57,30 @@ IterativeExplorationThread<ValueType, RewardModelType, StateType>::IterativeExpl
 template <typename ValueType, typename RewardModelType, typename StateType>
 StateType
 IterativeExplorationThread<ValueType, RewardModelType, StateType>::enqueueSuccessors(CompressedState const & state) {
-	StateType actualIndex;
-	// Request ownership of state
-	// Check if we own sPrime and if we don't ask the thread who does to explore it
-	uint8_t sPrimeOwner = this->controlThread.whoOwns(state);
-	if (sPrimeOwner != this->threadIndex && sPrimeOwner != NO_THREAD) {
+	// Find (or create) the index of the state. Ownership and the index are assigned in one
+	// step, so there is no window in which another thread could see the state without an index.
+	auto threadAndStateIndecies = this->controlThread.requestOwnership(state, this->threadIndex);
+	uint8_t sPrimeOwner = threadAndStateIndecies.first;
+	StateType actualIndex = threadAndStateIndecies.second;
+
+	auto nextState = this->parent->getStateMap().get(actualIndex);
+	bool stateIsExisting = nextState != nullptr;
+	if (stateIsExisting) {
+		// Once a state has a record, the record decides who owns it, since states move between
+		// threads when they are stolen. States found while single threaded have no owner yet.
+		nextState->transferOwnership(NO_THREAD, this->threadIndex);
+		sPrimeOwner = nextState->getOwner();
+	}
+	// If another thread already owns sPrime, ask the thread who does to explore it. The transition
+	// into it is still ours, so the generator must get its real index
+	if (sPrimeOwner != this->threadIndex) {
 		STAMINA_DEBUG_MESSAGE("This state is owned by " << sPrimeOwner);
-		actualIndex = this->controlThread.whatIsIndex(state);
 		StateIndexAndThread sThreadIndex(state, actualIndex, sPrimeOwner);
-		// Request cross exploration handled in other function
+		// Request cross exploration handled in exploreState()
 		this->statesToRequestCrossExploration.emplace_back(sThreadIndex);
-		return 0; // TODO: another thread owns
+		return actualIndex;
 	}
-	else if (sPrimeOwner == NO_THREAD) {
-		STAMINA_DEBUG_MESSAGE("No thread owns this state");
-		// Request ownership
-		auto threadAndStateIndecies = this->controlThread.requestOwnership(state, this->threadIndex);
-		bool failedRequest = threadAndStateIndecies.first != this->threadIndex;
-		actualIndex = threadAndStateIndecies.second;
-		if (failedRequest) {
-			StateIndexAndThread sThreadIndex(state, actualIndex, sPrimeOwner);
-			// request cross exploration
-			this->statesToRequestCrossExploration.emplace_back(sThreadIndex);
-			return 0; // TODO: another thread owns
-		}
-	}
-	else {
-		STAMINA_DEBUG_MESSAGE("This state is owned by this thread");
-		actualIndex = this->controlThread.whatIsIndex(state);
-	}
-
-	auto nextState = this->parent->getStateMap().get(actualIndex);
-	bool stateIsExisting = nextState != nullptr;
 
-	this->parent->getStateStorage().stateToId.findOrAdd(state, actualIndex);
 	// Handle conditional enqueuing
 
 	bool enqueued = false;
@@ -101,11 +93,8 @@ IterativeExplorationThread<ValueType, RewardModelType, StateType>::enqueueSucces
 			ProbabilityState<StateType> * nextProbabilityState = nextState;
 			if (nextProbabilityState->iterationLastSeen != this->parent->getIteration()) {
 				nextProbabilityState->iterationLastSeen = this->parent->getIteration();
-				std::pair<ProbabilityState<StateType> *, CompressedState const &> toEnqueue(nextProbabilityState, state);
 				// Enqueue
-				this->mainExplorationQueue.emplace_back(
-					toEnqueue
-				);
+				this->mainExplorationQueue.push(this->allocateFrontierPair(nextProbabilityState, state));
 				enqueued = true;
 			}
 		}
@@ -121,31 +110,33 @@ IterativeExplorationThread<ValueType, RewardModelType, StateType>::enqueueSucces
 			// auto emplaced = exploredStates.emplace(actualIndex);
 			if (nextProbabilityState->iterationLastSeen != this->parent->getIteration()) {
 				nextProbabilityState->iterationLastSeen = this->parent->getIteration();
-				std::pair<ProbabilityState<StateType> *, CompressedState const &> toEnqueue(nextProbabilityState, state);
-
 				// Enqueue
-				this->mainExplorationQueue.emplace_back(toEnqueue);
+				this->mainExplorationQueue.push(this->allocateFrontierPair(nextProbabilityState, state));
 				enqueued = true;
 			}
 		}
 		else {
 			// This state has not been seen so create a new ProbabilityState
-			ProbabilityState<StateType> * nextProbabilityState = this->parent->getMemoryPool().allocate();
-			*nextProbabilityState = ProbabilityState<StateType>(
+			ProbabilityState<StateType> * nextProbabilityState = this->parent->getStateMap().put(
 				actualIndex
-				, 0.0
-				, true
+				, ProbabilityState<StateType>(
+					actualIndex
+					, 0.0
+					, true
+				)
 			);
-			this->parent->getStateMap().put(actualIndex, nextProbabilityState);
+			nextProbabilityState->setOwner(this->threadIndex);
 			nextProbabilityState->iterationLastSeen = this->parent->getIteration();
 			// exploredStates.emplace(actualIndex);
-			std::pair<ProbabilityState<StateType> *, CompressedState const &> toEnqueue(nextProbabilityState, state);
-
-			this->mainExplorationQueue.emplace_back(toEnqueue);
+			this->mainExplorationQueue.push(this->allocateFrontierPair(nextProbabilityState, state));
 			enqueued = true;
 			numberTerminal++;
 		}
 	}
+	// Let a parked thread steal from us if we have more than we are about to explore
+	if (enqueued && this->mainExplorationQueue.size() > 1) {
+		this->controlThread.wakeIdleThread();
+	}
 	return actualIndex;
 }
 
@@ -159,7 +150,29 @@ IterativeExplorationThread<ValueType, RewardModelType, StateType>::exploreStates
 		this->crossExplorationQueue.pop_front();
 		auto s = stateDeltaPiPair.first;
 		double deltaPi = stateDeltaPiPair.second;
-		StateType stateIndex = this->parent->getStateIndexOrAbsorbing(s);
+		StateType stateIndex = this->controlThread.whatIsIndex(s);
+		// The state may have been stolen since this request was made. If so, pass it on
+		auto probabilityState = this->parent->getStateMap().get(stateIndex);
+		uint8_t owner = probabilityState != nullptr ? probabilityState->getOwner() : NO_THREAD;
+		if (owner != NO_THREAD && owner != this->threadIndex) {
+			this->parent->getExplorationThreads()[owner - 1]->requestCrossExploration(s, deltaPi);
+			this->xLock.unlock();
+			return;
+		}
+		if (probabilityState == nullptr) {
+			// We own this state but found it from a state with zero reachability, so it has no record yet
+			probabilityState = this->parent->getStateMap().put(
+				stateIndex
+				, ProbabilityState<StateType>(
+					stateIndex
+					, 0.0
+					, true
+				)
+			);
+			probabilityState->setOwner(this->threadIndex);
+			probabilityState->iterationLastSeen = this->parent->getIteration();
+			numberTerminal++;
+		}
 		StateProbability stateProbability(
 			s            // State values
 			, stateIndex // State Index
@@ -176,13 +189,27 @@ IterativeExplorationThread<ValueType, RewardModelType, StateType>::exploreStates
 		STAMINA_DEBUG_MESSAGE("Exploring from main exploration queue");
 		// If we are dequeuing from the main exploration queue, then
 		// the state we are enqueuing doesn't have a delta pi
-		auto s = this->mainExplorationQueue.front();
-		this->mainExplorationQueue.pop_front();
+		ProbabilityStatePair<StateType> * s = nullptr;
+		if (!this->mainExplorationQueue.take(s)) {
+			// Another thread stole our last state
+			return;
+		}
+		StateProbability stateProbability(
+			s->second
+			, s->first->index
+		);
+		exploreState(stateProbability);
+		this->releaseFrontierPair(s);
+	}
+	else if (auto s = this->stealFromOtherThreads()) {
+		STAMINA_DEBUG_MESSAGE("Exploring a state stolen from another thread");
+		this->idling = false;
 		StateProbability stateProbability(
-			s.second
-			, s.first->index
+			s->second
+			, s->first->index
 		);
 		exploreState(stateProbability);
+		this->releaseFrontierPair(s);
 	}
 	else if (!this->xLock.owns_lock()) {
 		STAMINA_DEBUG_MESSAGE("Size of cross exploration queue: " << this->crossExplorationQueue.size());
@@ -208,67 +235,71 @@ IterativeExplorationThread<ValueType, RewardModelType, StateType>::exploreState(
 	StateType currentIndex = stateProbability.index;
 	CompressedState const & currentState = stateProbability.state;
 
-	// Flush deltaPi
-	currentProbabilityState->pi += stateProbability.deltaPi;
+	// Flush deltaPi. The thread this state was stolen from may be adding to pi at the same time
+	currentProbabilityState->addToPi(stateProbability.deltaPi);
 
-	// Load this state to use
-	this->generator->load(currentState);
+	// Load this state to use. A shared generator is given the state when expanding instead
+	if (!this->threadsafeGenerator) {
+		this->generator->load(currentState);
+	}
 
 	/*
 	 * Early termination based on property expression
 	 * */
 	if (this->parent->getPropertyExpression() != nullptr) {
-		storm::expressions::SimpleValuation valuation = this->generator->currentStateToSimpleValuation();
+		storm::expressions::SimpleValuation valuation = this->threadsafeGenerator
+			? this->threadsafeGenerator->toSimpleValuation(currentState)
+			: this->generator->currentStateToSimpleValuation();
 		bool evaluationAtCurrentState = this->parent->getPropertyExpression()->evaluateAsBool(&valuation);
 		// If the property does not hold at the current state, make it absorbing in the
 		// state graph and do not explore its successors
 		if (!evaluationAtCurrentState) {
 			STAMINA_DEBUG_MESSAGE("Truncating state based on property");
-			this->controlThread.requestInsertTransition(
-				this->threadIndex
-				, currentIndex
-				, 0
-				, 1.0
-			);
+			this->transitionBatch.emplace_back(currentIndex, 0, 1.0);
 			// We treat this state as terminal even though it is also absorbing and does not
 			// go to our artificial absorbing state
-			currentProbabilityState->terminal = true;
+			this->stateMap->setTerminal(currentProbabilityState, true);
 			numberTerminal++;
 			// Do NOT place this in the deque of states we should start with next iteration
 			return;
 		}
 	}
 
-	// Do not explore if state is terminal and its reachability probability is less than kappa
-	if (currentProbabilityState->isTerminal() && currentProbabilityState->getPi() < this->parent->getLocalKappa()) {
+	// Do not explore if state is terminal and its reachability probability is less than kappa, or if
+	// the control thread found that the exploration budget has run out
+	if (currentProbabilityState->isTerminal() && (
+		currentProbabilityState->getPi() < this->parent->getLocalKappa()
+		|| this->parent->isExplorationBudgetExhausted()
+	)) {
 		STAMINA_DEBUG_MESSAGE("Terminating state because kappa is greater than pi(s)");
 		// Do not connect to absorbing yet
 		// Place this in statesTerminatedLastIteration
-		if ( !currentProbabilityState->wasPutInTerminalQueue ) {
+		if ( !currentProbabilityState->wasPutInTerminalQueue() ) {
 			this->statesTerminatedLastIteration.emplace_back(stateProbability);
-			currentProbabilityState->wasPutInTerminalQueue = true;
+			currentProbabilityState->setPutInTerminalQueue(true);
 		}
 		return;
 	}
 	STAMINA_DEBUG_MESSAGE("Not terminating state");
-	currentStateHasZeroReachability = currentProbabilityState->getPi() == 0;
+	// Take pi once, so the mass distributed to successors is exactly what was taken. Mass added by
+	// other threads from now on stays with this state rather than being lost when pi is reset
+	double currentPi = currentProbabilityState->takePi();
+	currentStateHasZeroReachability = currentPi == 0;
 
 	// We assume that if we make it here, our state is either nonterminal, or its reachability probability
 	// is greater than kappa
-	// Expand this state
-	storm::generator::StateBehavior<ValueType, StateType> behavior = this->generator->expand(this->stateToIdCallback);
+	// Expand this state. Successors owned by other threads are collected by enqueueSuccessors()
+	this->statesToRequestCrossExploration.clear();
+	storm::generator::StateBehavior<ValueType, StateType> behavior = this->threadsafeGenerator
+		? this->threadsafeGenerator->expand(currentState, this->stateToIdCallback)
+		: this->generator->expand(this->stateToIdCallback);
 
 	if (behavior.empty()) {
 		// This state needs to be made absorbing
-		this->controlThread.requestInsertTransition(
-			this->threadIndex
-			, currentIndex
-			, currentIndex
-			, 1.0
-		);
+		this->transitionBatch.emplace_back(currentIndex, currentIndex, 1.0);
 	}
 
-	bool shouldEnqueueAll = currentProbabilityState->getPi() == 0.0;
+	bool shouldEnqueueAll = currentPi == 0.0;
 	// Now add all choices.
 	bool firstChoiceOfState = true;
 	for (auto const& choice : behavior) {
@@ -306,24 +337,33 @@ IterativeExplorationThread<ValueType, RewardModelType, StateType>::exploreState(
 			StateType sPrime = stateProbabilityPair.first;
 			double probability = isCtmc ? stateProbabilityPair.second / totalRate : stateProbabilityPair.second;
 
-			if (sPrime == 0) {
-				continue;
-			}
-			else if (sPrime == this->statesToRequestCrossExploration.front().index) {
-				// Request cross exploration
-				auto stateIndexAndThread = this->statesToRequestCrossExploration.front();
-				this->statesToRequestCrossExploration.pop_front();
+			// The generator merges and sorts successors, so look up the request rather than
+			// expecting it in order
+			auto request = std::find_if(
+				this->statesToRequestCrossExploration.begin()
+				, this->statesToRequestCrossExploration.end()
+				, [sPrime](StateIndexAndThread const & request) { return request.index == sPrime; }
+			);
+			if (request != this->statesToRequestCrossExploration.end()) {
+				// Request cross exploration. The owner adds deltaPi to sPrime, so we must not touch it
+				auto stateIndexAndThread = *request;
+				this->statesToRequestCrossExploration.erase(request);
 				this->controlThread.requestCrossExplorationFromThread(
 					StateProbability(
 						stateIndexAndThread.state // Compressed State
-						, currentProbabilityState->getPi() * probability // deltaPi
 						, stateIndexAndThread.index
+						, shouldEnqueueAll ? 0.0 : currentPi * probability // deltaPi
 					)
 					, stateIndexAndThread.threadIndex
-					, currentIndex
-					, probability
 				);
-
+				// Like every other transition, this is the rate, and only added the first time we are explored
+				if (currentProbabilityState->isNew()) {
+					this->transitionBatch.emplace_back(currentIndex, stateIndexAndThread.index, stateProbabilityPair.second);
+				}
+				continue;
+			}
+			else if (sPrime == 0) {
+				continue;
 			}
 
 			// At this point we assume that we own sPrime
@@ -336,25 +376,26 @@ IterativeExplorationThread<ValueType, RewardModelType, StateType>::exploreState(
 			auto nextProbabilityState = this->stateMap->get(sPrime);
 			if (nextProbabilityState != nullptr) {
 				if (!shouldEnqueueAll) {
-					nextProbabilityState->addToPi(currentProbabilityState->getPi() * probability);
+					nextProbabilityState->addToPi(currentPi * probability);
 				}
 
-				if (currentProbabilityState->isNew) {
-					this->controlThread.requestInsertTransition(this->threadIndex, currentIndex, sPrime, stateProbabilityPair.second);
+				if (currentProbabilityState->isNew()) {
+					this->transitionBatch.emplace_back(currentIndex, sPrime, stateProbabilityPair.second);
 				}
 			}
 		}
 
 		firstChoiceOfState = false;
 	}
+	// Requests for successors with no transition (e.g. the rate was 0) are not needed any more
+	this->statesToRequestCrossExploration.clear();
 
-	currentProbabilityState->isNew = false;
+	currentProbabilityState->setNew(false);
 
 	if (currentProbabilityState->isTerminal() && numberTerminal > 0) {
 		numberTerminal--;
 	}
-	currentProbabilityState->setTerminal(false);
-	currentProbabilityState->setPi(0.0);
+	this->stateMap->setTerminal(currentProbabilityState, false);
 
 }
 
@@ -85,6 +85,8 @@ Options::setArgs(struct arguments * arguments) {
 	rank_transitions = arguments->rank_transitions;
 	max_iterations = arguments->max_iterations;
 	max_states = arguments->max_states;
+	max_transitions = arguments->max_transitions;
+	max_memory = arguments->max_memory;
 	method = arguments->method;
 	threads = arguments->threads;
 	preterminate = arguments->preterminate;
@@ -92,6 +94,10 @@ Options::setArgs(struct arguments * arguments) {
 	event = arguments->event;
 	distance_weight = arguments->distance_weight;
 	quiet = arguments->quiet;
+	joint_solver = arguments->joint_solver;
+	warm_start = arguments->warm_start;
+	incremental_matrix = arguments->incremental_matrix;
+	compiled_generator = arguments->compiled_generator;
 }
 
 } // namespace core
@@ -65,7 +65,9 @@ namespace stamina {
 			inline static std::string export_trans;
 			inline static bool rank_transitions;
 			inline static uint64_t max_iterations;
-			inline static uint64_t max_states;
+			inline static uint64_t max_states; // Exploration budgets. 0 means no limit
+			inline static uint64_t max_transitions;
+			inline static uint64_t max_memory; // In megabytes of resident memory
 			inline static uint8_t method;
 			inline static uint8_t threads;
 			inline static bool preterminate;
@@ -73,6 +75,10 @@ namespace stamina {
 			// Rare and common events
 			inline static uint8_t event;
 			inline static double distance_weight; // The weighting of the "distance" metric (a multiplier)
+			inline static bool incremental_matrix; // Reuse transition matrix rows between iterations
+			inline static bool warm_start; // Warm-start the transient solver between refinement iterations
+			inline static bool joint_solver; // Check Pmin and Pmax in one uniformisation sweep
+			inline static bool compiled_generator; // Expand states with the compiled PRISM generator
 		};
 		/**
 		* Tells us if a string ends with another
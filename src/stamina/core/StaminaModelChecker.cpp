@@ -25,6 +25,7 @@
 #include "StaminaModelChecker.h"
 #include "ANSIColors.h"
 #include "StaminaMessages.h"
+#include "StaminaTransientSolver.h"
 
 #include "core/StateSpaceInformation.h"
 
@@ -115,6 +116,14 @@ StaminaModelChecker::initialize(
 	this->propertiesVector = propertiesVector;
 }
 
+std::shared_ptr<threads::ExplorationThreadPool<double, uint32_t>>
+StaminaModelChecker::getExplorationPool() {
+	if (!explorationPool || explorationPool->getNumberOfExplorationThreads() != Options::threads) {
+		explorationPool = std::make_shared<threads::ExplorationThreadPool<double, uint32_t>>(Options::threads);
+	}
+	return explorationPool;
+}
+
 std::unique_ptr<storm::modelchecker::CheckResult>
 StaminaModelChecker::modelCheckProperty(
 	storm::jani::Property propMin
@@ -134,7 +143,7 @@ StaminaModelChecker::modelCheckProperty(
 	storm::builder::BuilderOptions options;
 	options = BuilderOptions(formulasVector);
 	// Create PrismNextStateGenerator. May need to create a NextStateGeneratorOptions for it if default is not working
-	auto generator = std::make_shared<storm::generator::PrismNextStateGenerator<double, uint32_t>>(modulesFile, options);
+	auto generator = stamina::generator::makeNextStateGenerator<double, uint32_t>(modulesFile, options);
 	StateSpaceInformation::setVariableInformation(generator->getVariableInformation());
 	if (Options::method == STAMINA_METHODS::ITERATIVE_METHOD) {
 		// The reason that this splits into two separate classes is that when calling STAMINA
@@ -149,28 +158,26 @@ StaminaModelChecker::modelCheckProperty(
 			StaminaMessages::info("Using thread-count: " + std::to_string(Options::threads));
 			auto builderPointer = std::make_shared<StaminaThreadedIterativeModelBuilder<double>> (generator, modulesFile, options);
 			builder = std::static_pointer_cast<StaminaModelBuilder<double>>(builderPointer);
-			std::vector<std::shared_ptr<storm::generator::PrismNextStateGenerator<double, uint32_t>>> generators;
-			for (int i = 0; i < Options::threads; i++) {
-				generators.push_back(std::make_shared<storm::generator::PrismNextStateGenerator<double, uint32_t>>(modulesFile, options));
-			}
+			// The pool and its generators outlive this builder, so they are only created once
+			auto pool = getExplorationPool();
+			builderPointer->setExplorationPool(pool);
 			// Give to model builder.
 			//
 			// This must be builderPointer because when we pointer-cast to a
 			// std::shared_ptr<StaminaModelBuilder> we lose the knowledge that this is a
 			// StaminaThreadedIterativeModelBuilder, which has this method.
-			builderPointer->setGeneratorsVector(generators);
+			builderPointer->setGeneratorsVector(pool->getGenerators(modulesFile, formulasVector));
 		}
 	}
 	else if (Options::method == STAMINA_METHODS::PRIORITY_METHOD) {
 		StaminaMessages::warning("Not fully implemented yet!");
 		// Create StaminaModelBuilder
-		auto builderPointer = std::make_shared<StaminaPriorityModelBuilder<double>> (generator, modulesFile, options);
-		builderPointer->initializeEventStatePriority(&propMin);
-		builder = std::static_pointer_cast<StaminaModelBuilder<double>>(builderPointer);
+		// Specialised for the event mode in Options
+		builder = makePriorityModelBuilder<double>(generator, modulesFile, options, &propMin);
 	}
 	else if (Options::method == STAMINA_METHODS::RE_EXPLORING_METHOD) {
 		if (Options::threads != 1) {
-			StaminaMessages::error("The re-exploring method (STAMINA 2.0) does not support multithreading!");
+			StaminaMessages::warning("The re-exploring method (STAMINA 2.0) explores on one thread. Other threads are only used to connect perimeter states to the absorbing state.");
 		}
 		auto builderPointer = std::make_shared<StaminaReExploringModelBuilder<double>> (generator, modulesFile, options);
 		builder = std::static_pointer_cast<StaminaModelBuilder<double>>(builderPointer);
@@ -178,6 +185,13 @@ StaminaModelChecker::modelCheckProperty(
 	else {
 		StaminaMessages::errorAndExit("Truncation method is invalid!");
 	}
+	// Builders which explore on one thread still connect perimeter states to the absorbing
+	// state in parallel on the shared pool
+	if (Options::threads > 1 && builder->getExplorationPool() == nullptr) {
+		auto pool = getExplorationPool();
+		builder->setExplorationPool(pool);
+		builder->setGeneratorsVector(pool->getGenerators(modulesFile, formulasVector));
+	}
 
 	auto startTime = std::chrono::high_resolution_clock::now();
 	auto modelTime = startTime;
@@ -190,6 +204,14 @@ StaminaModelChecker::modelCheckProperty(
 	double reachThreshold = Options::kappa;
 	StaminaMessages::info("Created min prop: " + propMin.asPrismSyntax());
 	StaminaMessages::info("Created max prop: " + propMax.asPrismSyntax());
+	// Upper bounds are only valid for the model of a single property
+	upperBounds.clear();
+	bool useTransientSolver = (Options::warm_start || Options::joint_solver)
+		&& StaminaTransientSolver::supportsFormula(*(propMin.getRawFormula()))
+		&& StaminaTransientSolver::supportsFormula(*(propMax.getRawFormula()));
+	if ((Options::warm_start || Options::joint_solver) && !useTransientSolver) {
+		StaminaMessages::warning("Property is not of the form P=? [ phi1 U[0,t] phi2 ]. Cannot use the STAMINA transient solver!");
+	}
 	// Property refinement optimization
 	if (!Options::no_prop_refine) {
 		// Get the expression for the current property
@@ -201,7 +223,7 @@ StaminaModelChecker::modelCheckProperty(
 	// While we should not terminate
 	// All versions of the STAMINA algorithm (except for the heuristic version use refinement iterations)
 	while (numRefineIterations == 0
-		|| (!terminateModelCheck() && numRefineIterations < Options::max_approx_count)
+		|| (!terminateModelCheck() && numRefineIterations < Options::max_approx_count && !builder->isExplorationBudgetExhausted())
 	) {
 		// Print out our current refinement iteration
 		StaminaMessages::info("Approximation [Refine Iterations: " + std::to_string(numRefineIterations) + ", kappa = " + std::to_string(reachThreshold) + "]");
@@ -223,18 +245,23 @@ StaminaModelChecker::modelCheckProperty(
 		// Instruct STORM to compute P_min and P_max
 		// We will need to get info from the terminal states
 		try {
-			// storm::Environment env;
-			// env.solver().native().setPrecision(storm::utility::convertNumber<storm::RationalNumber>(1e-9));
-			auto result_lower = checker->check(
-				// env,
-				storm::modelchecker::CheckTask<>(*(propMin.getRawFormula()), true)
-			);
-			min_results->result = result_lower->asExplicitQuantitativeCheckResult<double>()[*model->getInitialStates().begin()];
-			auto result_upper = checker->check(
-				// env,
-				storm::modelchecker::CheckTask<>(*(propMax.getRawFormula()), true)
-			);
-			max_results->result = result_upper->asExplicitQuantitativeCheckResult<double>()[*model->getInitialStates().begin()];
+			if (useTransientSolver) {
+				checkWithTransientSolver(propMin, propMax);
+			}
+			else {
+				// storm::Environment env;
+				// env.solver().native().setPrecision(storm::utility::convertNumber<storm::RationalNumber>(1e-9));
+				auto result_lower = checker->check(
+					// env,
+					storm::modelchecker::CheckTask<>(*(propMin.getRawFormula()), true)
+				);
+				min_results->result = result_lower->asExplicitQuantitativeCheckResult<double>()[*model->getInitialStates().begin()];
+				auto result_upper = checker->check(
+					// env,
+					storm::modelchecker::CheckTask<>(*(propMax.getRawFormula()), true)
+				);
+				max_results->result = result_upper->asExplicitQuantitativeCheckResult<double>()[*model->getInitialStates().begin()];
+			}
 			// min_results->result = max_results->result - result_upper->asExplicitQuantitativeCheckResult<double>()[1]; // value of the absorbing state
 			builder->printStateSpaceInformation();
 			StaminaMessages::info(std::string("At this refine iteration, the following result values are found:\n") +
@@ -263,6 +290,9 @@ StaminaModelChecker::modelCheckProperty(
 		// Increment number of refine iterations
 		++numRefineIterations;
 	}
+	if (builder->isExplorationBudgetExhausted()) {
+		StaminaMessages::warning("Stopped refining at the " + builder->getExplorationBudget().getReason() + ". The results are sound bounds, but may be further apart than the probability window.");
+	}
 
 	// Export transitions to file if desired
 	if (Options::export_trans != "") {
@@ -324,7 +354,7 @@ StaminaModelChecker::estimateResultProperty(
 	storm::builder::BuilderOptions options;
 	options = BuilderOptions(formulasVector);
 	// Create PrismNextStateGenerator. May need to create a NextStateGeneratorOptions for it if default is not working
-	auto generator = std::make_shared<storm::generator::PrismNextStateGenerator<double, uint32_t>>(modulesFile, options);
+	auto generator = stamina::generator::makeNextStateGenerator<double, uint32_t>(modulesFile, options);
 	StateSpaceInformation::setVariableInformation(generator->getVariableInformation());
 	if (Options::method == STAMINA_METHODS::ITERATIVE_METHOD) {
 		// The reason that this splits into two separate classes is that when calling STAMINA
@@ -339,28 +369,26 @@ StaminaModelChecker::estimateResultProperty(
 			StaminaMessages::info("Using thread-count: " + std::to_string(Options::threads));
 			auto builderPointer = std::make_shared<StaminaThreadedIterativeModelBuilder<double>> (generator, modulesFile, options);
 			builder = std::static_pointer_cast<StaminaModelBuilder<double>>(builderPointer);
-			std::vector<std::shared_ptr<storm::generator::PrismNextStateGenerator<double, uint32_t>>> generators;
-			for (int i = 0; i < Options::threads; i++) {
-				generators.push_back(std::make_shared<storm::generator::PrismNextStateGenerator<double, uint32_t>>(modulesFile, options));
-			}
+			// The pool and its generators outlive this builder, so they are only created once
+			auto pool = getExplorationPool();
+			builderPointer->setExplorationPool(pool);
 			// Give to model builder.
 			//
 			// This must be builderPointer because when we pointer-cast to a
 			// std::shared_ptr<StaminaModelBuilder> we lose the knowledge that this is a
 			// StaminaThreadedIterativeModelBuilder, which has this method.
-			builderPointer->setGeneratorsVector(generators);
+			builderPointer->setGeneratorsVector(pool->getGenerators(modulesFile, formulasVector));
 		}
 	}
 	else if (Options::method == STAMINA_METHODS::PRIORITY_METHOD) {
 		StaminaMessages::warning("Not fully implemented yet!");
 		// Create StaminaModelBuilder
-		auto builderPointer = std::make_shared<StaminaPriorityModelBuilder<double>> (generator, modulesFile, options);
-		builderPointer->initializeEventStatePriority(&propOriginal);
-		builder = std::static_pointer_cast<StaminaModelBuilder<double>>(builderPointer);
+		// Specialised for the event mode in Options
+		builder = makePriorityModelBuilder<double>(generator, modulesFile, options, &propOriginal);
 	}
 	else if (Options::method == STAMINA_METHODS::RE_EXPLORING_METHOD) {
 		if (Options::threads != 1) {
-			StaminaMessages::error("The re-exploring method (STAMINA 2.0) does not support multithreading!");
+			StaminaMessages::warning("The re-exploring method (STAMINA 2.0) explores on one thread. Other threads are only used to connect perimeter states to the absorbing state.");
 		}
 		auto builderPointer = std::make_shared<StaminaReExploringModelBuilder<double>> (generator, modulesFile, options);
 		builder = std::static_pointer_cast<StaminaModelBuilder<double>>(builderPointer);
@@ -368,6 +396,13 @@ StaminaModelChecker::estimateResultProperty(
 	else {
 		StaminaMessages::errorAndExit("Truncation method is invalid!");
 	}
+	// Builders which explore on one thread still connect perimeter states to the absorbing
+	// state in parallel on the shared pool
+	if (Options::threads > 1 && builder->getExplorationPool() == nullptr) {
+		auto pool = getExplorationPool();
+		builder->setExplorationPool(pool);
+		builder->setGeneratorsVector(pool->getGenerators(modulesFile, formulasVector));
+	}
 
 	auto startTime = std::chrono::high_resolution_clock::now();
 	auto modelTime = startTime;
@@ -389,7 +424,7 @@ StaminaModelChecker::estimateResultProperty(
 	// While we should not terminate
 	// All versions of the STAMINA algorithm (except for the heuristic version use refinement iterations)
 	while (numRefineIterations == 0
-		|| (!terminateModelCheck() && numRefineIterations < Options::max_approx_count)
+		|| (!terminateModelCheck() && numRefineIterations < Options::max_approx_count && !builder->isExplorationBudgetExhausted())
 	) {
 		// Print out our current refinement iteration
 		StaminaMessages::info("Approximation [Refine Iterations: " + std::to_string(numRefineIterations) + ", kappa = " + std::to_string(reachThreshold) + "]");
@@ -445,6 +480,9 @@ StaminaModelChecker::estimateResultProperty(
 		// Increment number of refine iterations
 		++numRefineIterations;
 	}
+	if (builder->isExplorationBudgetExhausted()) {
+		StaminaMessages::warning("Stopped refining at the " + builder->getExplorationBudget().getReason() + ". The results are sound bounds, but may be further apart than the probability window.");
+	}
 
 	// Export transitions to file if desired
 	if (Options::export_trans != "") {
@@ -556,6 +594,31 @@ StaminaModelChecker::checkFromBuiltModel(
 	StaminaMessages::writeResults(r, std::cout, isEstimate);
 }
 
+void
+StaminaModelChecker::checkWithTransientSolver(
+	storm::jani::Property const & propMin
+	, storm::jani::Property const & propMax
+) {
+	StaminaTransientSolver solver(*model, *checker);
+	auto initialState = *model->getInitialStates().begin();
+	// Without warm-starting, the upper bounds are recomputed from scratch
+	if (!Options::warm_start) {
+		upperBounds.clear();
+	}
+	// Pmin and Pmax share one uniformised matrix and one sweep. The upper bounds (for Pmax) are also
+	// upper bounds for Pmin (since Pmin <= Pmax), and for Pmax of the next (larger) truncated model
+	auto results = solver.computeBoundedUntilMinMax(
+		*(propMin.getRawFormula())
+		, *(propMax.getRawFormula())
+		, upperBounds
+	);
+	min_results->result = results.first[initialState];
+	max_results->result = results.second[initialState];
+	if (Options::warm_start) {
+		StaminaMessages::info("Warm-started transient solver saved " + std::to_string(solver.getIterationsSaved()) + " of " + std::to_string(solver.getIterations() + solver.getIterationsSaved()) + " iterations.");
+	}
+}
+
 std::shared_ptr<std::vector<std::pair<std::string, uint64_t>>>
 StaminaModelChecker::getLabelsAndCount() {
 	std::shared_ptr<std::vector<std::pair<std::string, uint64_t>>> labelsAndCount(
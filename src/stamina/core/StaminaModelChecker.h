@@ -172,6 +172,25 @@ namespace stamina {
 			* @return Terminate?
 			* */
 			bool terminateModelCheck();
+			/**
+			 * Checks Pmin and Pmax together using the STAMINA transient solver, which is warm-started with
+			 * the upper bounds from the previous refinement iteration if Options::warm_start is set. Sets
+			 * min_results and max_results.
+			 *
+			 * @param propMin Minimum variant of the property to check
+			 * @param propMax Maximum variant of the property to check
+			 * */
+			void checkWithTransientSolver(
+				storm::jani::Property const & propMin
+				, storm::jani::Property const & propMax
+			);
+			/**
+			 * Gets the pool the threaded builders run on, creating it the first time (or if the thread
+			 * count has changed since it was created).
+			 *
+			 * @return The exploration thread pool
+			 * */
+			std::shared_ptr<threads::ExplorationThreadPool<double, uint32_t>> getExplorationPool();
 			/**
 			* Writes perimeter states to a specified file.
 			* */
@@ -198,9 +217,13 @@ namespace stamina {
 			// The model
 			std::shared_ptr<storm::models::sparse::Ctmc<double, storm::models::sparse::StandardRewardModel<double>>> model;
 			std::shared_ptr<CtmcModelChecker> checker;
+			// Upper bounds on reachability from the previous refinement iteration (for warm-starting)
+			std::vector<double> upperBounds;
 			// The results for all of the properties we check
 			std::vector<ResultTableRow> resultTable;
 			std::shared_ptr<StaminaModelBuilder<double>> builder;
+			// Long-lived threads and generators shared by every threaded builder
+			std::shared_ptr<threads::ExplorationThreadPool<double, uint32_t>> explorationPool;
 			std::shared_ptr<storm::prism::Program> modulesFile;
 			std::shared_ptr<std::vector<storm::jani::Property>> propertiesVector;
 			storm::expressions::ExpressionManager expressionManager;
@@ -0,0 +1,250 @@
+/**
+ * STAMINA - the [ST]ochasic [A]pproximate [M]odel-checker for [IN]finite-state [A]nalysis
+ * Copyright (C) 2023 Fluent Verification, Utah State University
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see https://www.gnu.org/licenses/.
+ *
+ **/
+
+#include "StaminaTransientSolver.h"
+#include "StaminaMessages.h"
+
+#include "storm/modelchecker/results/ExplicitQualitativeCheckResult.h"
+#include "storm/utility/graph.h"
+#include "storm/utility/numerical.h"
+
+#include <algorithm>
+
+namespace stamina {
+namespace core {
+
+StaminaTransientSolver::StaminaTransientSolver(
+	Ctmc const & model
+	, CtmcModelChecker & checker
+) : model(model)
+	, checker(checker)
+	, iterations(0)
+	, iterationsSaved(0)
+{
+	// Intentionally left empty
+}
+
+bool
+StaminaTransientSolver::supportsFormula(storm::logic::Formula const & formula) {
+	if (!formula.isProbabilityOperatorFormula()) {
+		return false;
+	}
+	auto const & pathFormula = formula.asProbabilityOperatorFormula().getSubformula();
+	if (!pathFormula.isBoundedUntilFormula()) {
+		return false;
+	}
+	auto const & boundedUntilFormula = pathFormula.asBoundedUntilFormula();
+	if (boundedUntilFormula.isMultiDimensional()
+		|| !boundedUntilFormula.getTimeBoundReference().isTimeBound()
+		|| !boundedUntilFormula.hasUpperBound()
+	) {
+		return false;
+	}
+	// Intervals [t1, t2] with t1 > 0 need a second transient analysis which is left to STORM
+	if (boundedUntilFormula.hasLowerBound() && boundedUntilFormula.getLowerBound<double>() > 0.0) {
+		return false;
+	}
+	return true;
+}
+
+std::vector<double>
+StaminaTransientSolver::computeBoundedUntil(
+	storm::logic::Formula const & formula
+	, std::vector<double> & upperBounds
+) {
+	return computeBoundedUntilColumns({&formula}, upperBounds)[0];
+}
+
+std::pair<std::vector<double>, std::vector<double>>
+StaminaTransientSolver::computeBoundedUntilMinMax(
+	storm::logic::Formula const & formulaMin
+	, storm::logic::Formula const & formulaMax
+	, std::vector<double> & upperBounds
+) {
+	auto results = computeBoundedUntilColumns({&formulaMin, &formulaMax}, upperBounds);
+	return std::make_pair(std::move(results[0]), std::move(results[1]));
+}
+
+std::vector<std::vector<double>>
+StaminaTransientSolver::computeBoundedUntilColumns(
+	std::vector<storm::logic::Formula const *> const & formulas
+	, std::vector<double> & upperBounds
+) {
+	uint64_t columns = formulas.size();
+	if (columns == 0 || columns > MAX_COLUMNS) {
+		StaminaMessages::errorAndExit("Transient solver can check between 1 and " + std::to_string(MAX_COLUMNS) + " formulas at once!");
+	}
+	// Each state stores its values for all columns (and the upper bound) next to one another, so
+	// that a single pass over the matrix row updates all of them
+	uint64_t width = columns + 1;
+	uint64_t upperColumn = columns;
+
+	uint64_t numberOfStates = model.getNumberOfStates();
+	auto const & transitionMatrix = model.getTransitionMatrix();
+	auto const & exitRates = model.getExitRateVector();
+	auto const & backwardTransitions = model.getBackwardTransitions();
+	iterations = 0;
+	iterationsSaved = 0;
+
+	double timeBound = 0.0;
+	std::vector<double> current(width * numberOfStates, 0.0);
+	// Which columns a state is a "maybe" state for, i.e., for which columns its value still changes
+	std::vector<uint8_t> maybeMask(numberOfStates, 0);
+	// Map the upper bounds onto the states of this model. New states have a (trivial) upper bound of 1
+	upperBounds.resize(numberOfStates, 1.0);
+	for (uint64_t column = 0; column < columns; ++column) {
+		auto const & pathFormula = formulas[column]->asProbabilityOperatorFormula().getSubformula().asBoundedUntilFormula();
+		double columnTimeBound = pathFormula.getUpperBound<double>();
+		if (column == 0) {
+			timeBound = columnTimeBound;
+		}
+		else if (columnTimeBound != timeBound) {
+			StaminaMessages::errorAndExit("Formulas checked together by the transient solver must have the same time bound!");
+		}
+		storm::storage::BitVector phi1States = evaluateStateFormula(pathFormula.getLeftSubformula());
+		storm::storage::BitVector phi2States = evaluateStateFormula(pathFormula.getRightSubformula());
+		// States which cannot reach phi2 at all. Without removing these, u_k would not converge to v
+		storm::storage::BitVector statesWithProbability0 = storm::utility::graph::performProb0(
+			backwardTransitions
+			, phi1States
+			, phi2States
+		);
+		// v_0 is the indicator vector of phi2
+		for (auto state : phi2States) {
+			current[state * width + column] = 1.0;
+		}
+		storm::storage::BitVector maybeStates = ~(statesWithProbability0 | phi2States);
+		for (auto state : maybeStates) {
+			maybeMask[state] |= 1 << column;
+		}
+		// The upper bounds belong to the last column
+		if (column == columns - 1) {
+			for (auto state : statesWithProbability0) {
+				upperBounds[state] = 0.0;
+			}
+			for (auto state : phi2States) {
+				upperBounds[state] = 1.0;
+			}
+		}
+	}
+
+	std::vector<uint64_t> maybeStateIndices;
+	double uniformisationRate = 0.0;
+	double maximumGap = 0.0;
+	for (uint64_t state = 0; state < numberOfStates; ++state) {
+		current[state * width + upperColumn] = upperBounds[state];
+		if (maybeMask[state] == 0) {
+			continue;
+		}
+		maybeStateIndices.push_back(state);
+		uniformisationRate = std::max(uniformisationRate, exitRates[state]);
+		maximumGap = std::max(maximumGap, upperBounds[state]);
+	}
+
+	std::vector<std::vector<double>> results(columns, std::vector<double>(numberOfStates, 0.0));
+	// Nothing can change state before the time bound
+	if (maybeStateIndices.empty() || uniformisationRate == 0.0 || timeBound == 0.0) {
+		for (uint64_t state = 0; state < numberOfStates; ++state) {
+			for (uint64_t column = 0; column < columns; ++column) {
+				results[column][state] = current[state * width + column];
+			}
+		}
+		return results;
+	}
+	// Same headroom as PRISM uses so that no state is left with a probability of 0 to stay
+	uniformisationRate *= 1.02;
+
+	auto foxGlynnResult = storm::utility::numerical::foxGlynn(uniformisationRate * timeBound, precision / 2.0);
+	for (auto & weight : foxGlynnResult.weights) {
+		weight /= foxGlynnResult.totalWeight;
+	}
+
+	std::vector<double> accumulated(columns * numberOfStates, 0.0);
+	std::vector<double> next(current);
+	double remainingWeight = 1.0;
+	for (uint64_t k = 0; k <= foxGlynnResult.right; ++k) {
+		double weight = 0.0;
+		if (k >= foxGlynnResult.left) {
+			weight = foxGlynnResult.weights[k - foxGlynnResult.left];
+			remainingWeight = std::max(remainingWeight - weight, 0.0);
+		}
+		// All remaining terms v_j are between v_k and u_k, so we may cut off the series here
+		bool cutOff = remainingWeight * maximumGap <= precision / 2.0;
+		if (cutOff) {
+			weight += remainingWeight;
+			iterationsSaved = foxGlynnResult.right - k;
+		}
+		if (weight > 0.0) {
+			for (uint64_t state = 0; state < numberOfStates; ++state) {
+				for (uint64_t column = 0; column < columns; ++column) {
+					accumulated[state * columns + column] += weight * current[state * width + column];
+				}
+			}
+		}
+		if (cutOff || k == foxGlynnResult.right) {
+			break;
+		}
+		// Compute v_{k+1} and u_{k+1} for all columns in one pass over the matrix
+		maximumGap = 0.0;
+		for (auto state : maybeStateIndices) {
+			double sums[MAX_COLUMNS + 1] = { 0.0 };
+			for (auto const & entry : transitionMatrix.getRow(state)) {
+				double const * successor = &current[entry.getColumn() * width];
+				for (uint64_t column = 0; column < width; ++column) {
+					sums[column] += entry.getValue() * successor[column];
+				}
+			}
+			double stayProbability = 1.0 - exitRates[state] / uniformisationRate;
+			double const * values = &current[state * width];
+			double * nextValues = &next[state * width];
+			uint8_t mask = maybeMask[state];
+			if (mask & (1 << (columns - 1))) {
+				nextValues[upperColumn] = std::min(
+					values[upperColumn]
+					, stayProbability * values[upperColumn] + sums[upperColumn] / uniformisationRate
+				);
+			}
+			for (uint64_t column = 0; column < columns; ++column) {
+				if (mask & (1 << column)) {
+					nextValues[column] = stayProbability * values[column] + sums[column] / uniformisationRate;
+					maximumGap = std::max(maximumGap, nextValues[upperColumn] - nextValues[column]);
+				}
+			}
+		}
+		std::swap(current, next);
+		++iterations;
+	}
+
+	for (uint64_t state = 0; state < numberOfStates; ++state) {
+		upperBounds[state] = current[state * width + upperColumn];
+		for (uint64_t column = 0; column < columns; ++column) {
+			results[column][state] = accumulated[state * columns + column];
+		}
+	}
+	return results;
+}
+
+storm::storage::BitVector
+StaminaTransientSolver::evaluateStateFormula(storm::logic::Formula const & formula) {
+	auto result = checker.check(storm::modelchecker::CheckTask<storm::logic::Formula, double>(formula));
+	return result->asExplicitQualitativeCheckResult().getTruthValuesVector();
+}
+
+} // namespace core
+} // namespace stamina
@@ -0,0 +1,136 @@
+/**
+ * STAMINA - the [ST]ochasic [A]pproximate [M]odel-checker for [IN]finite-state [A]nalysis
+ * Copyright (C) 2023 Fluent Verification, Utah State University
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see https://www.gnu.org/licenses/.
+ *
+ **/
+
+/**
+ * A transient (uniformisation) solver for time-bounded until properties, P=? [ phi1 U[0,t] phi2 ],
+ * which can be warm-started from a previous refinement iteration.
+ *
+ * Let v_k be the probability of reaching phi2 within k steps of the uniformised DTMC, and v be the
+ * (unbounded) probability of eventually reaching phi2. Then v_k <= v_j <= v for all j >= k. Alongside
+ * v_k, we also iterate an upper bound u_k >= v, which never leaves being an upper bound since v is a
+ * fixed point of the (monotone) uniformised operator. Once the remaining Fox-Glynn weight multiplied
+ * by max(u_k - v_k) is less than the precision, the remaining terms of the series can be cut off.
+ *
+ * Because the state indices of the truncated model are stable between refinement iterations, the
+ * upper bound from the previous iteration (for the "max" property, where the absorbing state satisfies
+ * phi2) is still an upper bound for the next truncated model, and is much tighter than starting from 1.
+ * */
+#ifndef STAMINA_CORE_STAMINATRANSIENTSOLVER_H
+#define STAMINA_CORE_STAMINATRANSIENTSOLVER_H
+
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+#include "__storm_needed_for_checker.h"
+
+namespace stamina {
+	namespace core {
+		class StaminaTransientSolver {
+		public:
+			typedef storm::models::sparse::Ctmc<double> Ctmc;
+			typedef storm::modelchecker::SparseCtmcCslModelChecker<Ctmc> CtmcModelChecker;
+			/**
+			 * Constructs a StaminaTransientSolver for a specific (built) model
+			 *
+			 * @param model The CTMC to check
+			 * @param checker A model checker for the same CTMC, used to evaluate state formulas
+			 * */
+			StaminaTransientSolver(Ctmc const & model, CtmcModelChecker & checker);
+			/**
+			 * Whether or not this solver is able to check a formula. Only properties of the form
+			 * P=? [ phi1 U[0,t] phi2 ] (with a single time bound) are supported.
+			 *
+			 * @param formula The formula to check
+			 * @return Whether or not computeBoundedUntil() can be used
+			 * */
+			static bool supportsFormula(storm::logic::Formula const & formula);
+			/**
+			 * Computes the probability of a time-bounded until formula for all states
+			 *
+			 * @param formula The formula to check. Must be supported (see supportsFormula())
+			 * @param upperBounds Upper bounds on the unbounded reachability of each state. May come from a
+			 * previous (smaller) model, in which case states not in the vector are assumed to have an upper
+			 * bound of 1. Is set to the tightened upper bounds after the call.
+			 * @return The probability for each state
+			 * */
+			std::vector<double> computeBoundedUntil(
+				storm::logic::Formula const & formula
+				, std::vector<double> & upperBounds
+			);
+			/**
+			 * Computes the probabilities of Pmin and Pmax in a single uniformisation sweep. Both properties
+			 * must have the same time bound, and Pmin must be less than or equal to Pmax in every state
+			 * (as is the case for properties created by util::ModelModify::modifyProperty()).
+			 *
+			 * @param formulaMin The formula for Pmin
+			 * @param formulaMax The formula for Pmax
+			 * @param upperBounds Upper bounds on the unbounded reachability of each state for Pmax (see
+			 * computeBoundedUntil())
+			 * @return The probabilities of Pmin and Pmax (in that order) for each state
+			 * */
+			std::pair<std::vector<double>, std::vector<double>> computeBoundedUntilMinMax(
+				storm::logic::Formula const & formulaMin
+				, storm::logic::Formula const & formulaMax
+				, std::vector<double> & upperBounds
+			);
+			/**
+			 * Gets the number of uniformisation iterations performed in the last call to computeBoundedUntil()
+			 * */
+			uint64_t getIterations() const { return iterations; }
+			/**
+			 * Gets the number of uniformisation iterations skipped in the last call to computeBoundedUntil()
+			 * */
+			uint64_t getIterationsSaved() const { return iterationsSaved; }
+			// Precision of the transient computation (matches the default in STORM)
+			constexpr static double precision = 1e-6;
+			// Maximum number of formulas which can be checked in one sweep
+			constexpr static uint64_t MAX_COLUMNS = 4;
+		protected:
+			/**
+			 * Computes the probabilities of several time-bounded until formulas over the same uniformised
+			 * matrix. Every right-hand vector is propagated in the same pass over the matrix (a blocked
+			 * SpMV). The upper bounds belong to the last formula, which must have the greatest probability
+			 * in every state.
+			 *
+			 * @param formulas The formulas to check (must all have the same time bound)
+			 * @param upperBounds Upper bounds on the unbounded reachability of the last formula
+			 * @return The probability for each state, for each formula
+			 * */
+			std::vector<std::vector<double>> computeBoundedUntilColumns(
+				std::vector<storm::logic::Formula const *> const & formulas
+				, std::vector<double> & upperBounds
+			);
+			/**
+			 * Evaluates a state formula on all states of the model
+			 *
+			 * @param formula The state formula
+			 * @return A bitvector of the states satisfying the formula
+			 * */
+			storm::storage::BitVector evaluateStateFormula(storm::logic::Formula const & formula);
+		private:
+			Ctmc const & model;
+			CtmcModelChecker & checker;
+			uint64_t iterations;
+			uint64_t iterationsSaved;
+		};
+	} // namespace core
+} // namespace stamina
+
+#endif // STAMINA_CORE_STAMINATRANSIENTSOLVER_H
@@ -0,0 +1,124 @@
+/**
+ * STAMINA - the [ST]ochasic [A]pproximate [M]odel-checker for [IN]finite-state [A]nalysis
+ * Copyright (C) 2023 Fluent Verification, Utah State University
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see https://www.gnu.org/licenses/.
+ *
+ **/
+
+#include "CompiledPrismNextStateGenerator.h"
+
+#include "core/Options.h"
+#include "core/StaminaMessages.h"
+
+namespace stamina {
+namespace generator {
+
+using namespace stamina::core;
+
+template <typename ValueType, typename StateType>
+CompiledPrismNextStateGenerator<ValueType, StateType>::CompiledPrismNextStateGenerator(
+	storm::prism::Program const & program
+	, storm::generator::NextStateGeneratorOptions const & options
+) : storm::generator::PrismNextStateGenerator<ValueType, StateType>(program, options)
+	// Compile the generator's copy of the program, which has its constants and formulas substituted
+	, compiledProgram(std::make_shared<CompiledPrismProgram<ValueType>>(this->program, this->variableInformation))
+	, compiled(false)
+	, context(compiledProgram->makeContext())
+{
+	if (!compiledProgram->isSupported()) {
+		unsupportedReason = compiledProgram->getUnsupportedReason();
+	}
+	else if (!this->rewardModels.empty()) {
+		unsupportedReason = "reward models are built";
+	}
+	else if (this->options.isBuildChoiceLabelsSet() || this->options.isBuildChoiceOriginsSet()) {
+		unsupportedReason = "choice labels or origins are built";
+	}
+	else if (this->options.isAddOutOfBoundsStateSet() || this->options.isAddOverlappingGuardLabelSet()) {
+		unsupportedReason = "out of bounds states or overlapping guards are tracked";
+	}
+	else if (!this->terminalStates.empty()) {
+		unsupportedReason = "terminal states are set";
+	}
+	else {
+		compiled = true;
+	}
+}
+
+template <typename ValueType, typename StateType>
+storm::generator::StateBehavior<ValueType, StateType>
+CompiledPrismNextStateGenerator<ValueType, StateType>::expand(StateToIdCallback const & stateToIdCallback) {
+	if (!compiled) {
+		return storm::generator::PrismNextStateGenerator<ValueType, StateType>::expand(stateToIdCallback);
+	}
+	auto result = compiledProgram->template expand<StateType>(*this->state, context, stateToIdCallback);
+	this->postprocess(result);
+	return result;
+}
+
+template <typename ValueType, typename StateType>
+bool
+CompiledPrismNextStateGenerator<ValueType, StateType>::isCompiled() const {
+	return compiled;
+}
+
+template <typename ValueType, typename StateType>
+std::string const &
+CompiledPrismNextStateGenerator<ValueType, StateType>::getUnsupportedReason() const {
+	return unsupportedReason;
+}
+
+template <typename ValueType, typename StateType>
+std::shared_ptr<CompiledPrismProgram<ValueType> const>
+CompiledPrismNextStateGenerator<ValueType, StateType>::getCompiledProgram() const {
+	return compiledProgram;
+}
+
+template <typename ValueType, typename StateType>
+uint64_t
+CompiledPrismNextStateGenerator<ValueType, StateType>::getNumberOfGuardEvaluations() const {
+	return context.guardEvaluations;
+}
+
+template <typename ValueType, typename StateType>
+std::shared_ptr<storm::generator::PrismNextStateGenerator<ValueType, StateType>>
+makeNextStateGenerator(
+	storm::prism::Program const & program
+	, storm::generator::NextStateGeneratorOptions const & options
+) {
+	if (!Options::compiled_generator) {
+		return std::make_shared<storm::generator::PrismNextStateGenerator<ValueType, StateType>>(program, options);
+	}
+	auto generator = std::make_shared<CompiledPrismNextStateGenerator<ValueType, StateType>>(program, options);
+	// Generators are created again for each iteration by some builders, so only say this once
+	static bool warned = false;
+	if (!generator->isCompiled() && !warned) {
+		StaminaMessages::warning(
+			"Cannot use the compiled generator (" + generator->getUnsupportedReason() + "). Falling back to storm's generator."
+		);
+		warned = true;
+	}
+	return generator;
+}
+
+// Explicitly instantiate
+template class CompiledPrismNextStateGenerator<double, uint32_t>;
+template std::shared_ptr<storm::generator::PrismNextStateGenerator<double, uint32_t>> makeNextStateGenerator<double, uint32_t>(
+	storm::prism::Program const & program
+	, storm::generator::NextStateGeneratorOptions const & options
+);
+
+} // namespace generator
+} // namespace stamina
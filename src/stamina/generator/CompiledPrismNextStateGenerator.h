@@ -0,0 +1,108 @@
+/**
+ * STAMINA - the [ST]ochasic [A]pproximate [M]odel-checker for [IN]finite-state [A]nalysis
+ * Copyright (C) 2023 Fluent Verification, Utah State University
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see https://www.gnu.org/licenses/.
+ *
+ **/
+
+#ifndef STAMINA_GENERATOR_COMPILEDPRISMNEXTSTATEGENERATOR_H
+#define STAMINA_GENERATOR_COMPILEDPRISMNEXTSTATEGENERATOR_H
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+#include <storm/generator/PrismNextStateGenerator.h>
+
+#include "generator/CompiledPrismProgram.h"
+
+/**
+ * Drop-in replacement for storm::generator::PrismNextStateGenerator which expands states with a
+ * CompiledPrismProgram rather than storm's expression evaluator. Everything other than expand() (initial
+ * states, labeling, state valuations) is still done by storm.
+ *
+ * The compiled program only builds what STAMINA needs: a single merged choice per state with no rewards,
+ * choice labels or choice origins. If the program or the generator options need any of those, or the
+ * program could not be compiled, expand() falls back to storm.
+ *
+ * The generator remembers which commands were enabled in the state it expanded last. When it expands
+ * the next one, it only evaluates the guards which read a variable whose value changed, since all other
+ * guards must still have the same value. Successive states in exploration usually differ in only a few
+ * variables, so in models with many commands most guards are never evaluated.
+ *
+ * Like storm's generator, this may only be used by one thread at a time. See
+ * threadsafe::generator::ThreadsafePrismNextStateGenerator for a generator threads can share.
+ * */
+namespace stamina {
+	namespace generator {
+		template <typename ValueType, typename StateType = uint32_t>
+		class CompiledPrismNextStateGenerator : public storm::generator::PrismNextStateGenerator<ValueType, StateType> {
+		public:
+			typedef typename storm::generator::NextStateGenerator<ValueType, StateType>::StateToIdCallback StateToIdCallback;
+			/**
+			 * Constructs the generator and compiles the program
+			 *
+			 * @param program The PRISM program
+			 * @param options Options for the generator
+			 * */
+			CompiledPrismNextStateGenerator(
+				storm::prism::Program const & program
+				, storm::generator::NextStateGeneratorOptions const & options = storm::generator::NextStateGeneratorOptions()
+			);
+			/**
+			 * Expands the currently loaded state
+			 *
+			 * @param stateToIdCallback Callback which gives the index of each successor
+			 * @return The behavior of the state
+			 * */
+			storm::generator::StateBehavior<ValueType, StateType> expand(StateToIdCallback const & stateToIdCallback) override;
+			/**
+			 * Whether states are expanded by the compiled program (rather than storm)
+			 * */
+			bool isCompiled() const;
+			/**
+			 * Gets why states are not expanded by the compiled program
+			 * */
+			std::string const & getUnsupportedReason() const;
+			std::shared_ptr<CompiledPrismProgram<ValueType> const> getCompiledProgram() const;
+			/**
+			 * Gets the number of guards the compiled program evaluated, over all calls to expand()
+			 * */
+			virtual uint64_t getNumberOfGuardEvaluations() const;
+		protected:
+			std::shared_ptr<CompiledPrismProgram<ValueType> const> compiledProgram;
+			bool compiled;
+			// Used by expand()
+			typename CompiledPrismProgram<ValueType>::Context context;
+		private:
+			std::string unsupportedReason;
+		};
+		/**
+		 * Creates the generator the model builders should use: a CompiledPrismNextStateGenerator if
+		 * Options::compiled_generator is set, otherwise storm's PrismNextStateGenerator.
+		 *
+		 * @param program The PRISM program
+		 * @param options Options for the generator
+		 * @return The generator
+		 * */
+		template <typename ValueType, typename StateType = uint32_t>
+		std::shared_ptr<storm::generator::PrismNextStateGenerator<ValueType, StateType>> makeNextStateGenerator(
+			storm::prism::Program const & program
+			, storm::generator::NextStateGeneratorOptions const & options
+		);
+	}
+}
+
+#endif // STAMINA_GENERATOR_COMPILEDPRISMNEXTSTATEGENERATOR_H
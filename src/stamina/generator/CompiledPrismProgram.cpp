@@ -0,0 +1,522 @@
+/**
+ * STAMINA - the [ST]ochasic [A]pproximate [M]odel-checker for [IN]finite-state [A]nalysis
+ * Copyright (C) 2023 Fluent Verification, Utah State University
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see https://www.gnu.org/licenses/.
+ *
+ **/
+
+#include "CompiledPrismProgram.h"
+
+#include "core/StaminaMessages.h"
+
+#include <bit>
+#include <cmath>
+#include <algorithm>
+#include <exception>
+
+#include <storm/generator/Choice.h>
+#include <storm/utility/constants.h>
+
+#include <storm/storage/expressions/BaseExpression.h>
+#include <storm/storage/expressions/OperatorType.h>
+#include <storm/storage/expressions/VariableExpression.h>
+
+namespace stamina {
+namespace generator {
+
+using namespace stamina::core;
+
+template <typename ValueType>
+CompiledPrismProgram<ValueType>::CompiledPrismProgram(
+	storm::prism::Program const & program
+	, storm::generator::VariableInformation const & variableInformation
+) : stackDepth(1)
+	, supported(true)
+{
+	if (program.getModelType() != storm::prism::Program::ModelType::CTMC) {
+		unsupported("only CTMCs are compiled");
+		return;
+	}
+	addVariables(variableInformation);
+	// Storm expands commands without an action first, module by module...
+	for (auto const & module : program.getModules()) {
+		for (auto const & command : module.getCommands()) {
+			if (!command.isLabeled() && !compileCommand(command)) {
+				return;
+			}
+		}
+	}
+	// ...and then labeled commands, action by action. An action which is only used in one module does not
+	// synchronize with anything, so its commands behave exactly like unlabeled ones.
+	for (auto actionIndex : program.getSynchronizingActionIndices()) {
+		storm::prism::Module const * owner = nullptr;
+		for (auto const & module : program.getModules()) {
+			if (!module.hasActionIndex(actionIndex)) {
+				continue;
+			}
+			if (owner) {
+				unsupported("action " + program.getActionName(actionIndex) + " synchronizes between modules");
+				return;
+			}
+			owner = &module;
+		}
+		if (!owner) {
+			continue;
+		}
+		for (auto commandIndex : owner->getCommandIndicesByActionIndex(actionIndex)) {
+			if (!compileCommand(owner->getCommand(commandIndex))) {
+				return;
+			}
+		}
+	}
+}
+
+template <typename ValueType>
+CompiledPrismProgram<ValueType>::CompiledPrismProgram(
+	storm::generator::VariableInformation const & variableInformation
+) : stackDepth(1)
+	, supported(true)
+{
+	addVariables(variableInformation);
+}
+
+template <typename ValueType>
+bool
+CompiledPrismProgram<ValueType>::isSupported() const {
+	return supported;
+}
+
+template <typename ValueType>
+std::string const &
+CompiledPrismProgram<ValueType>::getUnsupportedReason() const {
+	return unsupportedReason;
+}
+
+template <typename ValueType>
+std::vector<typename CompiledPrismProgram<ValueType>::Command> const &
+CompiledPrismProgram<ValueType>::getCommands() const {
+	return commands;
+}
+
+template <typename ValueType>
+std::vector<typename CompiledPrismProgram<ValueType>::VariableLocation> const &
+CompiledPrismProgram<ValueType>::getVariables() const {
+	return variables;
+}
+
+template <typename ValueType>
+std::vector<std::vector<uint32_t>> const &
+CompiledPrismProgram<ValueType>::getGuardDependencies() const {
+	return guardDependencies;
+}
+
+template <typename ValueType>
+uint32_t
+CompiledPrismProgram<ValueType>::getStackDepth() const {
+	return stackDepth;
+}
+
+template <typename ValueType>
+bool
+CompiledPrismProgram<ValueType>::compile(storm::expressions::Expression const & expression, Bytecode & bytecode) {
+	bytecode.instructions.clear();
+	bytecode.stackDepth = 0;
+	return compileExpression(expression, bytecode, 0);
+}
+
+template <typename ValueType>
+typename CompiledPrismProgram<ValueType>::Context
+CompiledPrismProgram<ValueType>::makeContext() const {
+	Context context;
+	context.stack.resize(stackDepth);
+	context.enabledCommands.resize((commands.size() + 63) / 64, 0);
+	context.lastEvaluated.resize(commands.size(), 0);
+	return context;
+}
+
+template <typename ValueType>
+template <typename StateType>
+storm::generator::StateBehavior<ValueType, StateType>
+CompiledPrismProgram<ValueType>::expand(
+	CompressedState const & state
+	, Context & context
+	, std::function<StateType (CompressedState const &)> const & stateToIdCallback
+) const {
+	storm::generator::StateBehavior<ValueType, StateType> result;
+	result.setExpanded();
+	updateEnabledCommands(state, context);
+	storm::generator::Choice<ValueType, StateType> choice;
+	bool anyEnabled = false;
+	// Visit the enabled commands in order, so that successors are found in the same order as storm finds them
+	for (std::size_t word = 0; word < context.enabledCommands.size(); word++) {
+		for (uint64_t bits = context.enabledCommands[word]; bits != 0; bits &= bits - 1) {
+			auto const & command = commands[word * 64 + std::countr_zero(bits)];
+			anyEnabled = true;
+			for (auto const & update : command.updates) {
+				// Like storm, skip updates with a zero rate before applying them, so their successors are
+				// never registered (and may even be out of bounds)
+				ValueType rate = evaluate(update.rate, state, context.stack.data());
+				if (storm::utility::isZero(rate)) {
+					continue;
+				}
+				context.successor = state;
+				applyUpdate(update, state, context.successor, context.stack.data());
+				choice.addProbability(stateToIdCallback(context.successor), rate);
+			}
+		}
+	}
+	// A state with no enabled commands is a deadlock and has no choices
+	if (anyEnabled) {
+		result.addChoice(std::move(choice));
+	}
+	return result;
+}
+
+template <typename ValueType>
+ValueType
+CompiledPrismProgram<ValueType>::evaluate(
+	Bytecode const & bytecode
+	, CompressedState const & state
+	, ValueType * stack
+) {
+	// Points at the value on the top of the stack
+	ValueType * top = stack - 1;
+	for (auto const & instruction : bytecode.instructions) {
+		switch (instruction.opcode) {
+			case Opcode::Constant:
+				*++top = instruction.value;
+				break;
+			case Opcode::Integer:
+				*++top = static_cast<ValueType>(state.getAsInt(instruction.bitOffset, instruction.bitWidth)) + instruction.value;
+				break;
+			case Opcode::Boolean:
+				*++top = state.get(instruction.bitOffset) ? 1 : 0;
+				break;
+			case Opcode::Add:
+				top[-1] = top[-1] + top[0]; --top;
+				break;
+			case Opcode::Subtract:
+				top[-1] = top[-1] - top[0]; --top;
+				break;
+			case Opcode::Multiply:
+				top[-1] = top[-1] * top[0]; --top;
+				break;
+			case Opcode::Divide:
+				top[-1] = top[-1] / top[0]; --top;
+				break;
+			case Opcode::Modulo:
+				top[-1] = std::fmod(top[-1], top[0]); --top;
+				break;
+			case Opcode::Power:
+				top[-1] = std::pow(top[-1], top[0]); --top;
+				break;
+			case Opcode::Minimum:
+				top[-1] = std::min(top[-1], top[0]); --top;
+				break;
+			case Opcode::Maximum:
+				top[-1] = std::max(top[-1], top[0]); --top;
+				break;
+			case Opcode::Negate:
+				top[0] = -top[0];
+				break;
+			case Opcode::Floor:
+				top[0] = std::floor(top[0]);
+				break;
+			case Opcode::Ceil:
+				top[0] = std::ceil(top[0]);
+				break;
+			case Opcode::Equal:
+				top[-1] = top[-1] == top[0]; --top;
+				break;
+			case Opcode::NotEqual:
+				top[-1] = top[-1] != top[0]; --top;
+				break;
+			case Opcode::Less:
+				top[-1] = top[-1] < top[0]; --top;
+				break;
+			case Opcode::LessOrEqual:
+				top[-1] = top[-1] <= top[0]; --top;
+				break;
+			case Opcode::Greater:
+				top[-1] = top[-1] > top[0]; --top;
+				break;
+			case Opcode::GreaterOrEqual:
+				top[-1] = top[-1] >= top[0]; --top;
+				break;
+			case Opcode::And:
+				top[-1] = top[-1] != 0 && top[0] != 0; --top;
+				break;
+			case Opcode::Or:
+				top[-1] = top[-1] != 0 || top[0] != 0; --top;
+				break;
+			case Opcode::Xor:
+				top[-1] = (top[-1] != 0) != (top[0] != 0); --top;
+				break;
+			case Opcode::Implies:
+				top[-1] = top[-1] == 0 || top[0] != 0; --top;
+				break;
+			case Opcode::Iff:
+				top[-1] = (top[-1] != 0) == (top[0] != 0); --top;
+				break;
+			case Opcode::Not:
+				top[0] = top[0] == 0;
+				break;
+			case Opcode::IfThenElse:
+				top[-2] = top[-2] != 0 ? top[-1] : top[0]; top -= 2;
+				break;
+		}
+	}
+	return *top;
+}
+
+template <typename ValueType>
+void
+CompiledPrismProgram<ValueType>::applyUpdate(
+	Update const & update
+	, CompressedState const & state
+	, CompressedState & successor
+	, ValueType * stack
+) {
+	for (auto const & assignment : update.assignments) {
+		ValueType value = evaluate(assignment.expression, state, stack);
+		if (assignment.bitWidth == 0) {
+			successor.set(assignment.bitOffset, value != 0);
+			continue;
+		}
+		int64_t integerValue = static_cast<int64_t>(value);
+		if (integerValue < assignment.lowerBound || integerValue > assignment.upperBound) {
+			StaminaMessages::errorAndExit(
+				"Assignment to variable " + assignment.variableName + " results in value "
+				+ std::to_string(integerValue) + ", which is out of its bounds ["
+				+ std::to_string(assignment.lowerBound) + ", " + std::to_string(assignment.upperBound) + "]"
+			);
+		}
+		successor.setFromInt(assignment.bitOffset, assignment.bitWidth, integerValue - assignment.lowerBound);
+	}
+}
+
+template <typename ValueType>
+void
+CompiledPrismProgram<ValueType>::updateEnabledCommands(CompressedState const & state, Context & context) const {
+	context.expansions++;
+	if (!context.hasPreviousState) {
+		for (uint32_t commandIndex = 0; commandIndex < commands.size(); commandIndex++) {
+			evaluateGuard(commandIndex, state, context);
+		}
+	}
+	else {
+		for (std::size_t variable = 0; variable < variables.size(); variable++) {
+			if (!variables[variable].differs(state, context.previousState)) {
+				continue;
+			}
+			for (auto commandIndex : guardDependencies[variable]) {
+				// A guard reading several changed variables only needs to be evaluated once
+				if (context.lastEvaluated[commandIndex] != context.expansions) {
+					evaluateGuard(commandIndex, state, context);
+				}
+			}
+		}
+	}
+	context.previousState = state;
+	context.hasPreviousState = true;
+}
+
+template <typename ValueType>
+void
+CompiledPrismProgram<ValueType>::evaluateGuard(uint32_t commandIndex, CompressedState const & state, Context & context) const {
+	uint64_t bit = 1ULL << (commandIndex % 64);
+	if (evaluate(commands[commandIndex].guard, state, context.stack.data()) != 0) {
+		context.enabledCommands[commandIndex / 64] |= bit;
+	}
+	else {
+		context.enabledCommands[commandIndex / 64] &= ~bit;
+	}
+	context.lastEvaluated[commandIndex] = context.expansions;
+	context.guardEvaluations++;
+}
+
+template <typename ValueType>
+void
+CompiledPrismProgram<ValueType>::addVariables(storm::generator::VariableInformation const & variableInformation) {
+	for (auto const & integerVariable : variableInformation.integerVariables) {
+		variableIndices[integerVariable.variable] = variables.size();
+		variables.push_back(VariableLocation{
+			integerVariable.bitOffset
+			, static_cast<uint8_t>(integerVariable.bitWidth)
+			, integerVariable.lowerBound
+			, integerVariable.upperBound
+		});
+	}
+	for (auto const & booleanVariable : variableInformation.booleanVariables) {
+		variableIndices[booleanVariable.variable] = variables.size();
+		variables.push_back(VariableLocation{booleanVariable.bitOffset, 0, 0, 1});
+	}
+	guardDependencies.resize(variables.size());
+}
+
+template <typename ValueType>
+bool
+CompiledPrismProgram<ValueType>::compileCommand(storm::prism::Command const & command) {
+	Command compiled;
+	compiled.globalIndex = command.getGlobalIndex();
+	if (!compileExpression(command.getGuardExpression(), compiled.guard, 0)) {
+		return false;
+	}
+	// Any variable the guard reads has passed through compileExpression(), so it has an index
+	uint32_t commandIndex = commands.size();
+	for (auto const & variable : command.getGuardExpression().getVariables()) {
+		guardDependencies[variableIndices.at(variable)].push_back(commandIndex);
+	}
+	for (auto const & update : command.getUpdates()) {
+		Update compiledUpdate;
+		if (!compileExpression(update.getLikelihoodExpression(), compiledUpdate.rate, 0)) {
+			return false;
+		}
+		for (auto const & assignment : update.getAssignments()) {
+			auto index = variableIndices.find(assignment.getVariable());
+			if (index == variableIndices.end()) {
+				return unsupported("variable " + assignment.getVariableName() + " is not in the state");
+			}
+			Assignment compiledAssignment;
+			if (!compileExpression(assignment.getExpression(), compiledAssignment.expression, 0)) {
+				return false;
+			}
+			auto const & location = variables[index->second];
+			compiledAssignment.bitOffset = location.bitOffset;
+			compiledAssignment.bitWidth = location.bitWidth;
+			compiledAssignment.lowerBound = location.lowerBound;
+			compiledAssignment.upperBound = location.upperBound;
+			compiledAssignment.variableName = assignment.getVariableName();
+			compiledUpdate.assignments.push_back(std::move(compiledAssignment));
+		}
+		compiled.updates.push_back(std::move(compiledUpdate));
+	}
+	commands.push_back(std::move(compiled));
+	return true;
+}
+
+template <typename ValueType>
+bool
+CompiledPrismProgram<ValueType>::compileExpression(
+	storm::expressions::Expression const & expression
+	, Bytecode & bytecode
+	, uint32_t depth
+) {
+	bytecode.stackDepth = std::max(bytecode.stackDepth, depth + 1);
+	stackDepth = std::max(stackDepth, bytecode.stackDepth);
+	// Anything without variables (including literals) is folded into a single constant
+	if (!expression.containsVariables()) {
+		ValueType value;
+		try {
+			if (expression.hasBooleanType()) {
+				value = expression.evaluateAsBool() ? 1 : 0;
+			}
+			else if (expression.hasIntegerType()) {
+				value = static_cast<ValueType>(expression.evaluateAsInt());
+			}
+			else {
+				value = static_cast<ValueType>(expression.evaluateAsDouble());
+			}
+		}
+		catch (std::exception const & e) {
+			return unsupported("cannot evaluate constant " + expression.toString() + ": " + e.what());
+		}
+		bytecode.instructions.push_back(Instruction{Opcode::Constant, 0, 0, value});
+		return true;
+	}
+	if (expression.isVariable()) {
+		auto const & variable = expression.getBaseExpression().asVariableExpression().getVariable();
+		auto index = variableIndices.find(variable);
+		if (index == variableIndices.end()) {
+			return unsupported("variable " + variable.getName() + " is not in the state");
+		}
+		auto const & location = variables[index->second];
+		if (location.bitWidth == 0) {
+			bytecode.instructions.push_back(Instruction{Opcode::Boolean, 0, location.bitOffset, 0});
+		}
+		else {
+			bytecode.instructions.push_back(Instruction{
+				Opcode::Integer
+				, location.bitWidth
+				, location.bitOffset
+				, static_cast<ValueType>(location.lowerBound)
+			});
+		}
+		return true;
+	}
+	if (!expression.isFunctionApplication()) {
+		return unsupported("cannot compile " + expression.toString());
+	}
+	uint64_t arity = expression.getArity();
+	for (uint64_t i = 0; i < arity; i++) {
+		if (!compileExpression(expression.getOperand(i), bytecode, depth + i)) {
+			return false;
+		}
+	}
+	Opcode opcode;
+	typedef storm::expressions::OperatorType OperatorType;
+	switch (expression.getOperator()) {
+		case OperatorType::And: opcode = Opcode::And; break;
+		case OperatorType::Or: opcode = Opcode::Or; break;
+		case OperatorType::Xor: opcode = Opcode::Xor; break;
+		case OperatorType::Implies: opcode = Opcode::Implies; break;
+		case OperatorType::Iff: opcode = Opcode::Iff; break;
+		case OperatorType::Plus: opcode = Opcode::Add; break;
+		case OperatorType::Minus: opcode = arity == 1 ? Opcode::Negate : Opcode::Subtract; break;
+		case OperatorType::Times: opcode = Opcode::Multiply; break;
+		case OperatorType::Divide: opcode = Opcode::Divide; break;
+		case OperatorType::Min: opcode = Opcode::Minimum; break;
+		case OperatorType::Max: opcode = Opcode::Maximum; break;
+		case OperatorType::Power: opcode = Opcode::Power; break;
+		case OperatorType::Modulo: opcode = Opcode::Modulo; break;
+		case OperatorType::Equal: opcode = Opcode::Equal; break;
+		case OperatorType::NotEqual: opcode = Opcode::NotEqual; break;
+		case OperatorType::Less: opcode = Opcode::Less; break;
+		case OperatorType::LessOrEqual: opcode = Opcode::LessOrEqual; break;
+		case OperatorType::Greater: opcode = Opcode::Greater; break;
+		case OperatorType::GreaterOrEqual: opcode = Opcode::GreaterOrEqual; break;
+		case OperatorType::Not: opcode = Opcode::Not; break;
+		case OperatorType::Floor: opcode = Opcode::Floor; break;
+		case OperatorType::Ceil: opcode = Opcode::Ceil; break;
+		case OperatorType::Ite: opcode = Opcode::IfThenElse; break;
+		default:
+			return unsupported("cannot compile operator in " + expression.toString());
+	}
+	bytecode.instructions.push_back(Instruction{opcode, 0, 0, 0});
+	return true;
+}
+
+template <typename ValueType>
+bool
+CompiledPrismProgram<ValueType>::unsupported(std::string reason) {
+	supported = false;
+	unsupportedReason = reason;
+	commands.clear();
+	for (auto & dependents : guardDependencies) {
+		dependents.clear();
+	}
+	return false;
+}
+
+// Explicitly instantiate
+template class CompiledPrismProgram<double>;
+template storm::generator::StateBehavior<double, uint32_t> CompiledPrismProgram<double>::expand<uint32_t>(
+	CompressedState const & state
+	, Context & context
+	, std::function<uint32_t (CompressedState const &)> const & stateToIdCallback
+) const;
+
+} // namespace generator
+} // namespace stamina
@@ -0,0 +1,310 @@
+/**
+ * STAMINA - the [ST]ochasic [A]pproximate [M]odel-checker for [IN]finite-state [A]nalysis
+ * Copyright (C) 2023 Fluent Verification, Utah State University
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see https://www.gnu.org/licenses/.
+ *
+ **/
+
+#ifndef STAMINA_GENERATOR_COMPILEDPRISMPROGRAM_H
+#define STAMINA_GENERATOR_COMPILEDPRISMPROGRAM_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+
+#include <storm/generator/CompressedState.h>
+#include <storm/generator/StateBehavior.h>
+#include <storm/generator/VariableInformation.h>
+#include <storm/storage/prism/Program.h>
+#include <storm/storage/expressions/Expression.h>
+#include <storm/storage/expressions/Variable.h>
+
+/**
+ * The guards, rates and assignments of a PRISM CTMC compiled to a flat, stack-based bytecode which
+ * reads variables straight out of the bits of a CompressedState (using the layout in storm's
+ * VariableInformation). Storm's PrismNextStateGenerator first unpacks every variable of a state into
+ * its expression evaluator and then evaluates each guard through it; for models with many commands
+ * over a few bounded integers (such as CRNs) this program only touches the bits each expression reads.
+ *
+ * Each command also records which variables its guard reads. expand() remembers which commands were
+ * enabled in the state it expanded last, and only evaluates again the guards which read a variable that
+ * changed since then (see getGuardDependencies()).
+ *
+ * A compiled program is immutable once constructed, so it may be shared between generators and
+ * threads. Everything which changes while expanding states is kept in a Context, which each thread
+ * needs its own of.
+ *
+ * Programs using constructs which are not compiled (synchronization between modules, non-CTMC models,
+ * or operators outside of arithmetic, comparison, boolean logic and if-then-else) are reported as not
+ * supported, and generators should fall back to storm for them.
+ * */
+namespace stamina {
+	namespace generator {
+		template <typename ValueType>
+		class CompiledPrismProgram {
+		public:
+			typedef storm::generator::CompressedState CompressedState;
+			enum class Opcode : uint8_t {
+				Constant
+				, Integer
+				, Boolean
+				, Add
+				, Subtract
+				, Multiply
+				, Divide
+				, Modulo
+				, Power
+				, Minimum
+				, Maximum
+				, Negate
+				, Floor
+				, Ceil
+				, Equal
+				, NotEqual
+				, Less
+				, LessOrEqual
+				, Greater
+				, GreaterOrEqual
+				, And
+				, Or
+				, Xor
+				, Implies
+				, Iff
+				, Not
+				, IfThenElse
+			};
+			/**
+			 * A single instruction. Loads use `bitOffset` and `bitWidth`, and integer loads add `value`
+			 * (the lower bound of the variable). Constants push `value`.
+			 * */
+			struct Instruction {
+				Opcode opcode;
+				uint8_t bitWidth;
+				uint64_t bitOffset;
+				ValueType value;
+			};
+			/**
+			 * A compiled expression, in postfix order
+			 * */
+			struct Bytecode {
+				std::vector<Instruction> instructions;
+				uint32_t stackDepth = 0;
+			};
+			struct Assignment {
+				Bytecode expression;
+				uint64_t bitOffset;
+				// 0 for boolean variables
+				uint8_t bitWidth;
+				int64_t lowerBound;
+				int64_t upperBound;
+				std::string variableName;
+			};
+			struct Update {
+				Bytecode rate;
+				std::vector<Assignment> assignments;
+			};
+			/**
+			 * Where a variable lives in a CompressedState
+			 * */
+			struct VariableLocation {
+				uint64_t bitOffset;
+				// 0 for boolean variables
+				uint8_t bitWidth;
+				int64_t lowerBound;
+				int64_t upperBound;
+				/**
+				 * Whether this variable has different values in two states
+				 * */
+				bool differs(CompressedState const & first, CompressedState const & second) const {
+					if (bitWidth == 0) {
+						return first.get(bitOffset) != second.get(bitOffset);
+					}
+					return first.getAsInt(bitOffset, bitWidth) != second.getAsInt(bitOffset, bitWidth);
+				}
+			};
+			struct Command {
+				Bytecode guard;
+				std::vector<Update> updates;
+				// The index of the command in the (uncompiled) program
+				uint64_t globalIndex;
+			};
+			/**
+			 * Scratch space for expanding states, and the commands which were enabled in the state expanded
+			 * last. A context may only be used by one thread at a time.
+			 * */
+			struct Context {
+				std::vector<ValueType> stack;
+				CompressedState successor;
+				CompressedState previousState;
+				bool hasPreviousState = false;
+				// A bitset over the commands
+				std::vector<uint64_t> enabledCommands;
+				// The value of `expansions` when each command's guard was last evaluated
+				std::vector<uint64_t> lastEvaluated;
+				uint64_t expansions = 0;
+				uint64_t guardEvaluations = 0;
+			};
+			/**
+			 * Compiles a program. The program should have its constants and formulas substituted.
+			 *
+			 * @param program The program to compile
+			 * @param variableInformation The bit layout of states of the program
+			 * */
+			CompiledPrismProgram(
+				storm::prism::Program const & program
+				, storm::generator::VariableInformation const & variableInformation
+			);
+			/**
+			 * Creates a program with the bit layout of states but no commands, which is only used to compile
+			 * other expressions over states (see compile()).
+			 *
+			 * @param variableInformation The bit layout of states
+			 * */
+			explicit CompiledPrismProgram(storm::generator::VariableInformation const & variableInformation);
+			/**
+			 * Whether every command of the program was compiled. If not, the program must not be used.
+			 * */
+			bool isSupported() const;
+			/**
+			 * Gets why the program could not be compiled
+			 * */
+			std::string const & getUnsupportedReason() const;
+			/**
+			 * Gets the compiled commands, in the order in which storm would expand them
+			 * */
+			std::vector<Command> const & getCommands() const;
+			/**
+			 * Gets the location of each variable in the state. Variables are numbered by their position in this vector.
+			 * */
+			std::vector<VariableLocation> const & getVariables() const;
+			/**
+			 * Gets, for each variable, the indices (into getCommands()) of the commands whose guards read it, in
+			 * ascending order. A guard can only change its value between two states if one of these variables differs.
+			 * */
+			std::vector<std::vector<uint32_t>> const & getGuardDependencies() const;
+			/**
+			 * Gets the number of values needed on the stack to evaluate any expression in this program
+			 * */
+			uint32_t getStackDepth() const;
+			/**
+			 * Compiles an expression over the variables of this program, such as a state formula. If it cannot
+			 * be compiled, the program is marked as not supported, with the reason.
+			 *
+			 * @param expression The expression to compile
+			 * @param bytecode The bytecode to compile into
+			 * @return Whether the expression could be compiled
+			 * */
+			bool compile(storm::expressions::Expression const & expression, Bytecode & bytecode);
+			/**
+			 * Creates a context for expanding states of this program
+			 * */
+			Context makeContext() const;
+			/**
+			 * Expands a state. All commands are merged into a single choice, as storm does for CTMCs, and
+			 * successors are given to the callback in the order in which storm would find them.
+			 *
+			 * @param state The state to expand
+			 * @param context The calling thread's context
+			 * @param stateToIdCallback Callback which gives the index of each successor
+			 * @return The behavior of the state, with no choices if it is a deadlock
+			 * */
+			template <typename StateType>
+			storm::generator::StateBehavior<ValueType, StateType> expand(
+				CompressedState const & state
+				, Context & context
+				, std::function<StateType (CompressedState const &)> const & stateToIdCallback
+			) const;
+			/**
+			 * Evaluates an expression in a state.
+			 *
+			 * @param bytecode The compiled expression
+			 * @param state The state to read variables from
+			 * @param stack Scratch space for at least `bytecode.stackDepth` values
+			 * @return The value of the expression. Booleans are 0 or 1.
+			 * */
+			static ValueType evaluate(
+				Bytecode const & bytecode
+				, CompressedState const & state
+				, ValueType * stack
+			);
+			/**
+			 * Applies the assignments of an update to a state. Every assignment is evaluated in `state`, and
+			 * written into `successor`, which should start out as a copy of `state`. Exits if an integer is
+			 * assigned a value outside of its bounds.
+			 *
+			 * @param update The update to apply
+			 * @param state The state the update is applied in
+			 * @param successor The state to write into
+			 * @param stack Scratch space for at least getStackDepth() values
+			 * */
+			static void applyUpdate(
+				Update const & update
+				, CompressedState const & state
+				, CompressedState & successor
+				, ValueType * stack
+			);
+		protected:
+			/**
+			 * Brings the enabled commands of a context up to date for a state
+			 * */
+			void updateEnabledCommands(CompressedState const & state, Context & context) const;
+			/**
+			 * Evaluates the guard of a command and records in a context whether it is enabled
+			 * */
+			void evaluateGuard(uint32_t commandIndex, CompressedState const & state, Context & context) const;
+			/**
+			 * Records where each variable lives in the state
+			 * */
+			void addVariables(storm::generator::VariableInformation const & variableInformation);
+			/**
+			 * Compiles a command and appends it to `commands`
+			 *
+			 * @return Whether the command could be compiled
+			 * */
+			bool compileCommand(storm::prism::Command const & command);
+			/**
+			 * Compiles an expression, appending its instructions to a bytecode.
+			 *
+			 * @param expression The expression to compile
+			 * @param bytecode The bytecode to append to
+			 * @param depth The number of values already on the stack when this expression is evaluated
+			 * @return Whether the expression could be compiled
+			 * */
+			bool compileExpression(
+				storm::expressions::Expression const & expression
+				, Bytecode & bytecode
+				, uint32_t depth
+			);
+			/**
+			 * Marks the program as unsupported
+			 *
+			 * @return false
+			 * */
+			bool unsupported(std::string reason);
+		private:
+			std::vector<Command> commands;
+			std::vector<VariableLocation> variables;
+			std::unordered_map<storm::expressions::Variable, uint32_t> variableIndices;
+			std::vector<std::vector<uint32_t>> guardDependencies;
+			uint32_t stackDepth;
+			bool supported;
+			std::string unsupportedReason;
+		};
+	}
+}
+
+#endif // STAMINA_GENERATOR_COMPILEDPRISMPROGRAM_H
@@ -0,0 +1,59 @@
+/**
+ * STAMINA - the [ST]ochasic [A]pproximate [M]odel-checker for [IN]finite-state [A]nalysis
+ * Copyright (C) 2023 Fluent Verification, Utah State University
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see https://www.gnu.org/licenses/.
+ *
+ **/
+
+#include "CompiledStateExpression.h"
+
+namespace stamina {
+namespace generator {
+
+template <typename ValueType>
+CompiledStateExpression<ValueType>::CompiledStateExpression(
+	storm::expressions::Expression const & expression
+	, storm::generator::VariableInformation const & variableInformation
+) {
+	// Only the layout of the state is needed, not the commands of the program
+	CompiledPrismProgram<ValueType> layout(variableInformation);
+	compiled = layout.compile(expression, bytecode);
+	unsupportedReason = layout.getUnsupportedReason();
+	stack.resize(bytecode.stackDepth);
+}
+
+template <typename ValueType>
+bool
+CompiledStateExpression<ValueType>::isCompiled() const {
+	return compiled;
+}
+
+template <typename ValueType>
+std::string const &
+CompiledStateExpression<ValueType>::getUnsupportedReason() const {
+	return unsupportedReason;
+}
+
+template <typename ValueType>
+bool
+CompiledStateExpression<ValueType>::evaluateAsBool(CompressedState const & state) {
+	return CompiledPrismProgram<ValueType>::evaluate(bytecode, state, stack.data()) != 0;
+}
+
+// Explicitly instantiate
+template class CompiledStateExpression<double>;
+
+} // namespace generator
+} // namespace stamina
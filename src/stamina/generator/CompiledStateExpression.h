@@ -0,0 +1,73 @@
+/**
+ * STAMINA - the [ST]ochasic [A]pproximate [M]odel-checker for [IN]finite-state [A]nalysis
+ * Copyright (C) 2023 Fluent Verification, Utah State University
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see https://www.gnu.org/licenses/.
+ *
+ **/
+
+/**
+ * A boolean expression over the variables of a state (such as phi1 or phi2 of a property
+ * P=? [ phi1 U phi2 ]) compiled to the same bytecode as a CompiledPrismProgram, so that it reads
+ * variables straight out of the bits of a CompressedState. Evaluating storm's expression instead needs
+ * the state unpacked into a SimpleValuation first.
+ *
+ * Each instance keeps its own scratch space, so it may only be used by one thread at a time.
+ * */
+#ifndef STAMINA_GENERATOR_COMPILEDSTATEEXPRESSION_H
+#define STAMINA_GENERATOR_COMPILEDSTATEEXPRESSION_H
+
+#include "CompiledPrismProgram.h"
+
+namespace stamina {
+	namespace generator {
+		template <typename ValueType>
+		class CompiledStateExpression {
+		public:
+			typedef storm::generator::CompressedState CompressedState;
+			/**
+			 * Compiles an expression
+			 *
+			 * @param expression The expression to compile
+			 * @param variableInformation The bit layout of the states it is evaluated in
+			 * */
+			CompiledStateExpression(
+				storm::expressions::Expression const & expression
+				, storm::generator::VariableInformation const & variableInformation
+			);
+			/**
+			 * Whether the expression was compiled. If not, it must not be evaluated.
+			 * */
+			bool isCompiled() const;
+			/**
+			 * Gets why the expression could not be compiled
+			 * */
+			std::string const & getUnsupportedReason() const;
+			/**
+			 * Evaluates the expression in a state
+			 *
+			 * @param state The state
+			 * @return Whether the expression holds in the state
+			 * */
+			bool evaluateAsBool(CompressedState const & state);
+		private:
+			typename CompiledPrismProgram<ValueType>::Bytecode bytecode;
+			std::vector<ValueType> stack;
+			bool compiled;
+			std::string unsupportedReason;
+		};
+	}
+}
+
+#endif // STAMINA_GENERATOR_COMPILEDSTATEEXPRESSION_H
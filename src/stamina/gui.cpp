@@ -53,12 +53,19 @@ set_default_values() {
 	core::Options::export_trans = "";
 	core::Options::rank_transitions = false;
 	core::Options::max_iterations = 10000;
+	core::Options::max_states = 0;
+	core::Options::max_transitions = 0;
+	core::Options::max_memory = 0;
 	core::Options::method = STAMINA_METHODS::ITERATIVE_METHOD;
 	core::Options::threads = 1;
 	core::Options::preterminate = false;
 	core::Options::event = EVENTS::UNDEFINED;
 	core::Options::distance_weight = 1.0;
 	core::Options::quiet = false;
+	core::Options::joint_solver = false;
+	core::Options::warm_start = false;
+	core::Options::incremental_matrix = false;
+	core::Options::compiled_generator = false;
 }
 
 namespace gui {
@@ -1685,7 +1685,7 @@ MainWindow::populateTruncatedStates() {
 		// State ID
 		ui.earlyTerminatedTable->setItem(row, col++, new QTableWidgetItem(QString::number(perimeterState->index)));
 		// Estimated reachability
-		ui.earlyTerminatedTable->setItem(row, col++, new QTableWidgetItem(QString::number(perimeterState->pi)));
+		ui.earlyTerminatedTable->setItem(row, col++, new QTableWidgetItem(QString::number(perimeterState->getPi())));
 		// Integer variables
 		for (auto & iVar : integerVariables) {
 			uint_fast64_t bitOffset = iVar.bitOffset;
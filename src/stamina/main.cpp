@@ -36,12 +36,19 @@ set_default_values(struct arguments * arguments) {
 	arguments->export_trans = "";
 	arguments->rank_transitions = false;
 	arguments->max_iterations = 10000;
+	arguments->max_states = 0;
+	arguments->max_transitions = 0;
+	arguments->max_memory = 0;
 	arguments->method = STAMINA_METHODS::ITERATIVE_METHOD;
 	arguments->threads = 1;
 	arguments->preterminate = false;
 	arguments->event = EVENTS::UNDEFINED;
 	arguments->distance_weight = 1.0;
 	arguments->quiet = false;
+	arguments->joint_solver = false;
+	arguments->warm_start = false;
+	arguments->incremental_matrix = false;
+	arguments->compiled_generator = false;
 }
 
 /**
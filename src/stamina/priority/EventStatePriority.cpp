@@ -37,41 +37,29 @@ const float SMALL_VALUE = 0.0001;
 
 template <typename StateType>
 float
-EventStatePriority<StateType>::priority(std::shared_ptr<builder::ProbabilityStatePair<StateType>> state) {
-	float distance = tree.distance(state->second);
-	state->distance = std::min(distance, 1.0f);
+EventStatePriority<StateType>::priority(builder::ProbabilityStatePair<StateType> & state) {
+	float distance = tree.distance(state.second);
+	state.distance = std::min(distance, 1.0f);
 	return distance;
 }
 
 template <typename StateType>
 bool
 EventStatePriority<StateType>::operatorValue(
-	const std::shared_ptr<builder::ProbabilityStatePair<StateType>> first
-	, const std::shared_ptr<builder::ProbabilityStatePair<StateType>> second
+	const builder::ProbabilityStatePair<StateType> & first
+	, const builder::ProbabilityStatePair<StateType> & second
 ) {
-	/**
-	 * Explainer to make this code a little less obtuse:
-	 * builder::ProbabilityStatePair->second is the state (CompressedState &)
-	 * builder::ProbabilityStatePair->first is the state's probability information
-	 *
-	 * So:
-	 * first->second is the state values of the first pair passed in
-	 * second->second is the state values of the second pair passed in
-	 * first->first is the probability information of the first pair
-	 * second->first is the probability information of the second pair
-	 * */
-	// TODO: change to make it so these are calculated ONCE (when the state is
-	// first encountered) and stored
-	float distanceFirst = tree.distance(first->second);
-	float distanceSecond = tree.distance(second->second);
+	// The distances were calculated once, by priority(), when each state was enqueued
+	float distanceFirst = first.distance;
+	float distanceSecond = second.distance;
 	// TODO: should invert based on rare event? Or invert at the PrimitiveNode level
 	if (rareEvent) {
 		// Prevent division by zero errors
 		distanceFirst = 1 / std::max(distanceFirst, SMALL_VALUE);
 		distanceSecond = 1 / std::max(distanceSecond, SMALL_VALUE);
 	}
-	float compositeFirst = distanceFirst * first->first->pi;
-	float compositeSecond = distanceSecond * second->first->pi;
+	float compositeFirst = distanceFirst * first.first->getPi();
+	float compositeSecond = distanceSecond * second.first->getPi();
 	// Create a max heap on the composite (distance * reachability)
 	return compositeFirst < compositeSecond;
 }
@@ -91,13 +79,96 @@ PriorityTree::Node::addChild(std::shared_ptr<Node> child) {
 
 /* Implementation for PriorityTree::operatorNode */
 
+void
+PriorityTree::OperatorNode::lower(std::vector<Instruction> & program) {
+	// Operand counts are checked once here, rather than every time the distance is computed
+	if (m_operator == OPERATORS::LESS_THAN_EQ && children.size() != 2) {
+		StaminaMessages::errorAndExit("< or <= operator should have two operand! Got " + std::to_string(children.size()));
+	}
+	else if (m_operator == OPERATORS::GREATER_THAN_EQ && children.size() != 2) {
+		StaminaMessages::errorAndExit("> or >= operator should have two operand! Got " + std::to_string(children.size()));
+	}
+	else if (m_operator == OPERATORS::NOT && children.size() != 1) {
+		StaminaMessages::errorAndExit("! operator requires only one operand! Got " + std::to_string(children.size()));
+	}
+	else if (m_operator == OPERATORS::EQUAL && children.size() > 2) {
+		StaminaMessages::errorAndExit("Can only have less than two operators for equal!");
+	}
+	else if (m_operator > OPERATORS::EQUAL) {
+		StaminaMessages::errorAndExit("Unknown operator! (integer value " + std::to_string(m_operator) + ")");
+	}
+	for (auto child : children) {
+		child->lower(program);
+	}
+	program.push_back(Instruction{
+		Instruction::OPERATOR
+		, m_operator
+		, static_cast<uint32_t>(children.size())
+		, 0
+		, 0
+		, 0
+	});
+}
+
+/* Implementation for PriorityTree::PrimitiveNode */
+
+template <typename ValueType>
+void
+PriorityTree::PrimitiveNode<ValueType>::lower(std::vector<Instruction> & program) {
+	program.push_back(Instruction{Instruction::CONSTANT, 0, 0, 0, 0, static_cast<float>(value)});
+}
+
+/* Implementation for PriorityTree::IntegerVariableNode */
+
+void
+PriorityTree::IntegerVariableNode::lower(std::vector<Instruction> & program) {
+	if (bitWidth > 64) {
+		StaminaMessages::warning("Int size is " + std::to_string(bitWidth));
+	}
+	// The first bit of the variable is skipped
+	program.push_back(Instruction{Instruction::INTEGER_VARIABLE, 0, 0, bitOffset + 1, bitWidth - 1, 0});
+}
+
+/* Implementation for PriorityTree::BooleanVariableNode */
+
+void
+PriorityTree::BooleanVariableNode::lower(std::vector<Instruction> & program) {
+	program.push_back(Instruction{Instruction::BOOLEAN_VARIABLE, 0, 0, bitOffset, 1, 0});
+}
+
+/* Implementation for PriorityTree */
+
 float
-PriorityTree::OperatorNode::accumulate(CompressedState & state) {
-	if (m_operator == OPERATORS::LESS_THAN_EQ) {
-		// Require only 2 operands
-		if (children.size() != 2) {
-			StaminaMessages::errorAndExit("< or <= operator should have two operand! Got " + std::to_string(children.size()));
+PriorityTree::distance(CompressedState const & state) {
+	if (!wasInitialized()) {
+		StaminaMessages::warning("Priority tree was not initialized! Returning 0 for distance!");
+		return 0.0;
+	}
+	// Points at the value on top of the stack
+	float * top = stack.data() - 1;
+	for (auto const & instruction : program) {
+		switch (instruction.kind) {
+			case Instruction::CONSTANT:
+				*++top = instruction.value;
+				break;
+			case Instruction::INTEGER_VARIABLE:
+				*++top = (float) state.getAsInt(instruction.bitOffset, instruction.bitWidth);
+				break;
+			case Instruction::BOOLEAN_VARIABLE:
+				*++top = state.get(instruction.bitOffset) ? 1.0 : 0.0;
+				break;
+			case Instruction::OPERATOR:
+				top -= instruction.arity - 1;
+				*top = applyOperator(instruction.m_operator, top, instruction.arity);
+				break;
 		}
+	}
+	return *top;
+}
+
+float
+PriorityTree::applyOperator(operator_t m_operator, float const * operands, uint32_t arity) {
+	if (m_operator == OPERATORS::LESS_THAN_EQ) {
 		/**
 		 * For var < val, the distance is calculated as
 		 *       var - val
@@ -105,15 +176,11 @@ PriorityTree::OperatorNode::accumulate(CompressedState & state) {
 		 *          var
 		 * since we want a higher d for a lower var
 		 * */
-		float var = children[0]->accumulate(state);
-		float val = children[1]->accumulate(state);
+		float var = operands[0];
+		float val = operands[1];
 		return std::max(var - val, 0.0f) / std::max(var, SMALL_VALUE);
 	}
 	else if (m_operator == OPERATORS::GREATER_THAN_EQ) {
-		// Require only 2 operands
-		if (children.size() != 2) {
-			StaminaMessages::errorAndExit("> or >= operator should have two operand! Got " + std::to_string(children.size()));
-		}
 		/**
 		 * For var > val, the distance is calculated as
 		 *       val - var
@@ -121,94 +188,33 @@ PriorityTree::OperatorNode::accumulate(CompressedState & state) {
 		 *          val
 		 * since we want a higher d for a lower var
 		 * */
-		float var = children[0]->accumulate(state);
-		float val = children[1]->accumulate(state);
+		float var = operands[0];
+		float val = operands[1];
 		return std::max(val - var, 0.0f) / std::max(val, SMALL_VALUE);
 	}
 	else if (m_operator == OPERATORS::AND || m_operator == OPERATORS::OR) {
 		// For the "and" operator, we can chain all of the distances of the children
 		// together using multiplication
 		float distance = 0;
-		for (auto child : children) {
-			distance += child->accumulate(state);
+		for (uint32_t i = 0; i < arity; i++) {
+			distance += operands[i];
 		}
 		// We subtract 1 because we pass in propMin when creating the tree, which includes (Absorbing = False)
-		return (distance - 1) / children.size();
+		return (distance - 1) / arity;
 	}
-	/*else if (m_operator == OPERATORS::) {
-		// For the "or" operator, we also chain the distances of the children using
-		// the addition operator
-		float distance = 1;
-		for (auto child : children) {
-			distance *= child->accumulate(state);
-		}
-		return distance; // TODO: Normalize or not?
-	}*/
 	else if (m_operator == OPERATORS::NOT) {
 		// For this, we just invert the first operator
-		if (children.size() != 1) {
-			StaminaMessages::errorAndExit("! operator requires only one operand! Got " + std::to_string(children.size()));
-		}
-		return 1 - children[0]->accumulate(state);
-	}
-	else if (m_operator == OPERATORS::EQUAL) {
-		if (children.size() > 2) {
-			StaminaMessages::errorAndExit("Can only have less than two operators for equal!");
-		}
-		// If the size is 1, we assume the value is a boolean and say
-		// is the value == 1. Therefore the distance is value - 1
-		else if (children.size() == 1) {
-			float var = children[0]->accumulate(state);
-			return std::abs(var - 1);
-		}
-		else {
-			float var = children[0]->accumulate(state);
-			float val = children[1]->accumulate(state);
-			return std::abs(var - val) / val; // Assumes val > 0
-		}
-	}
-	else {
-		StaminaMessages::errorAndExit("Unknown operator! (integer value " + std::to_string(m_operator) + ")");
-	}
-}
-
-/* Implementation for PriorityTree::PrimitiveNode */
-
-template <typename ValueType>
-float
-PriorityTree::PrimitiveNode<ValueType>::accumulate(CompressedState & state) {
-	return value;
-}
-
-/* Implementation for PriorityTree::IntegerVariableNode */
-
-float
-PriorityTree::IntegerVariableNode::accumulate(CompressedState & state) {
-	uint_fast64_t bitOffset = this->bitOffset;
-	uint16_t bitWidth = this->bitWidth;
-	if (bitWidth > 64) {
-		StaminaMessages::warning("Int size is " + std::to_string(bitWidth));
+		return 1 - operands[0];
 	}
-	return (float) state.getAsInt(bitOffset + 1, bitWidth - 1);
-}
-
-/* Implementation for PriorityTree::BooleanVariableNode */
-
-float
-PriorityTree::BooleanVariableNode::accumulate(CompressedState & state) {
-	uint_fast64_t offset = this->bitOffset;
-	return 1.0 ? state.get(offset) : 0.0;
-}
-
-/* Implementation for PriorityTree */
-
-float
-PriorityTree::distance(CompressedState & state) {
-	if (!wasInitialized()) {
-		StaminaMessages::warning("Priority tree was not initialized! Returning 0 for distance!");
-		return 0.0;
+	// OPERATORS::EQUAL, since lower() rejects anything else
+	// If the size is 1, we assume the value is a boolean and say
+	// is the value == 1. Therefore the distance is value - 1
+	if (arity == 1) {
+		return std::abs(operands[0] - 1);
 	}
-	return root->accumulate(state);
+	float var = operands[0];
+	float val = operands[1];
+	return std::abs(var - val) / val; // Assumes val > 0
 }
 
 void
@@ -230,6 +236,16 @@ PriorityTree::initialize(storm::jani::Property * property) {
 	auto nonNestedExpression = simplifiedExpression.reduceNesting();
 	// createNodeFromExpression is recursive
 	this->root = createNodeFromExpression(expression);
+	// Lower the tree so that distance() does not have to walk it for every state
+	program.clear();
+	this->root->lower(program);
+	uint32_t depth = 0;
+	uint32_t maximumDepth = 0;
+	for (auto const & instruction : program) {
+		depth = (instruction.kind == Instruction::OPERATOR) ? depth - instruction.arity + 1 : depth + 1;
+		maximumDepth = std::max(maximumDepth, depth);
+	}
+	stack.resize(maximumDepth);
 }
 
 std::shared_ptr<PriorityTree::Node>
@@ -44,10 +44,32 @@ namespace stamina {
 				, NOT = 4
 				, EQUAL = 5
 			};
+			/**
+			 * A node of the tree lowered to a single postfix instruction. Variables are read from
+			 * `bitOffset` and `bitWidth`, constants push `value`, and operators replace the top
+			 * `arity` values on the stack with their result.
+			 * */
+			struct Instruction {
+				enum KIND : uint8_t {
+					CONSTANT
+					, INTEGER_VARIABLE
+					, BOOLEAN_VARIABLE
+					, OPERATOR
+				};
+				KIND kind;
+				operator_t m_operator;
+				uint32_t arity;
+				uint_fast64_t bitOffset;
+				uint64_t bitWidth;
+				float value;
+			};
 			class Node {
 			public:
 				Node() = default;
-				virtual float accumulate(CompressedState & state) = 0;
+				/**
+				 * Appends the instructions which compute this node (after its children) to a program
+				 * */
+				virtual void lower(std::vector<Instruction> & program) = 0;
 				void addChild(std::shared_ptr<Node> child);
 			protected:
 				std::vector<std::shared_ptr<Node>> children;
@@ -55,7 +77,7 @@ namespace stamina {
 			class OperatorNode : public Node {
 			public:
 				OperatorNode(operator_t m_operator) : m_operator(m_operator) {}
-				virtual float accumulate(CompressedState & state);
+				virtual void lower(std::vector<Instruction> & program);
 			private:
 				const operator_t m_operator;
 			};
@@ -68,7 +90,7 @@ namespace stamina {
 				PrimitiveNode() = default;
 				PrimitiveNode(ValueType value)
 					: value(value) {}
-				virtual float accumulate(CompressedState & state);
+				virtual void lower(std::vector<Instruction> & program);
 				ValueType value;
 			};
 			/**
@@ -79,7 +101,7 @@ namespace stamina {
 				IntegerVariableNode(storm::generator::IntegerVariableInformation variable)
 					: bitOffset(variable.bitOffset), bitWidth(variable.bitWidth) {}
 				/* Note: converts the value to a float */
-				virtual float accumulate(CompressedState & state);
+				virtual void lower(std::vector<Instruction> & program);
 				uint_fast64_t bitOffset;
 				uint64_t bitWidth;
 			};
@@ -91,7 +113,7 @@ namespace stamina {
 				BooleanVariableNode(storm::generator::BooleanVariableInformation variable)
 					: bitOffset(variable.bitOffset) {}
 				/* Converts false to 0.0 and true to 1.0 */
-				virtual float accumulate(CompressedState & state);
+				virtual void lower(std::vector<Instruction> & program);
 				uint_fast64_t bitOffset;
 			};
 			PriorityTree(
@@ -101,24 +123,42 @@ namespace stamina {
 			{}
 			/**
 			 * Calculates a composite of the "normalized" distance
-			 * from the state values to the threshold of the parameter that was setup
+			 * from the state values to the threshold of the parameter that was setup.
+			 * Runs the lowered program rather than walking the tree.
 			 *
 			 * @param state The state to calculate the distance
 			 * @return The distance to the threshold
 			 * */
-			float distance(CompressedState & state);
+			float distance(CompressedState const & state);
 			/**
-			 * Initializes the priority tree based on a particular property
+			 * Initializes the priority tree based on a particular property, and lowers it into
+			 * a flat postfix program
 			 *
 			 * @param property The property to initialize based on
 			 * */
 			void initialize(storm::jani::Property * property);
 			bool wasInitialized() { return root != nullptr; }
+			/**
+			 * Gets the tree lowered into postfix order
+			 * */
+			std::vector<Instruction> const & getProgram() const { return program; }
 		protected:
 			std::shared_ptr<Node> createNodeFromExpression(storm::expressions::Expression & expression);
+			/**
+			 * Applies an operator to the values it takes off of the stack
+			 *
+			 * @param m_operator The operator
+			 * @param operands The first of `arity` operands
+			 * @param arity The number of operands
+			 * @return The distance computed by the operator
+			 * */
+			static float applyOperator(operator_t m_operator, float const * operands, uint32_t arity);
 			storm::expressions::ExpressionManager & expressionManager;
 		private:
 			std::shared_ptr<Node> root;
+			std::vector<Instruction> program;
+			// Scratch space to run the program on, as deep as it needs
+			std::vector<float> stack;
 		};
 
 		template <typename StateType>
@@ -131,10 +171,10 @@ namespace stamina {
 				, expressionManager(expressionManager)
 				, tree(expressionManager)
 			{}
-			float priority(std::shared_ptr<builder::ProbabilityStatePair<StateType>> state) override;
+			float priority(builder::ProbabilityStatePair<StateType> & state) override;
 			bool operatorValue(
-				const std::shared_ptr<builder::ProbabilityStatePair<StateType>> first
-				, const std::shared_ptr<builder::ProbabilityStatePair<StateType>> second
+				const builder::ProbabilityStatePair<StateType> & first
+				, const builder::ProbabilityStatePair<StateType> & second
 			) override;
 			void initializePriorityTree(storm::jani::Property * property);
 			void initialize(storm::jani::Property * property) override { initializePriorityTree(property); }
@@ -45,10 +45,10 @@ namespace stamina {
 		template <typename StateType>
 		class StatePriority {
 		public:
-			virtual float priority(std::shared_ptr<builder::ProbabilityStatePair<StateType>> state) = 0;
+			virtual float priority(builder::ProbabilityStatePair<StateType> & state) = 0;
 			virtual bool operatorValue(
-				const std::shared_ptr<builder::ProbabilityStatePair<StateType>> first
-				, const std::shared_ptr<builder::ProbabilityStatePair<StateType>> second
+				const builder::ProbabilityStatePair<StateType> & first
+				, const builder::ProbabilityStatePair<StateType> & second
 			) = 0;
 			static void setupStatePriority();
 			virtual void initialize(storm::jani::Property * property) = 0;
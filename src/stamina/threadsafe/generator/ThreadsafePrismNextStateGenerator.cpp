@@ -25,32 +25,67 @@ namespace stamina {
 namespace threadsafe {
 namespace generator {
 
-template<typename ValueType, typename StateType = uint32_t>
+using namespace stamina::core;
+
+template<typename ValueType, typename StateType>
 ThreadsafePrismNextStateGenerator<ValueType, StateType>::ThreadsafePrismNextStateGenerator(
-	storm::prism::Program const& program
-	, storm::generator::NextStateGeneratorOptions const& options = NextStateGeneratorOptions()
-	, std::shared_ptr<ActionMask<ValueType, StateType>> const& = nullptr
-) : PrismNextStateGenerator<ValueType, StateType>(program, options)
-	, varInfoWasSetUp(false)
+	storm::prism::Program const & program
+	, storm::generator::NextStateGeneratorOptions const & options
+) : stamina::generator::CompiledPrismNextStateGenerator<ValueType, StateType>(program, options)
+	, id(nextId++)
 {
-	// intentionally left empty
+	// Intentionally left empty
 }
 
-template<typename ValueType, typename StateType = uint32_t>
-storm::storage::sparse::StateValuations
-ThreadsafePrismNextStateGenerator<ValueType, StateType>::makeObservationValuation() const {
-	if (varInfoWasSetUp) {
-		StaminaMessages::warning("Cannot make observation valuation");
+template<typename ValueType, typename StateType>
+storm::generator::StateBehavior<ValueType, StateType>
+ThreadsafePrismNextStateGenerator<ValueType, StateType>::expand(
+	storm::generator::CompressedState const & state
+	, StateToIdCallback const & stateToIdCallback
+) {
+	if (!this->compiled) {
+		StaminaMessages::errorAndExit("Cannot expand states from several threads with a program that could not be compiled!");
 	}
+	auto result = this->compiledProgram->template expand<StateType>(state, getContext(), stateToIdCallback);
+	this->postprocess(result);
+	return result;
 }
 
-template<typename ValueType, typename StateType = uint32_t>
-void
-ThreadsafePrismNextStateGenerator<ValueType, StateType>::addStateValuation(
-	storm::storage::sparse::state_type const& currentStateIndex
-	, storm::storage::sparse::StateValuationsBuilder& valuationsBuilder
-) const {
+template<typename ValueType, typename StateType>
+storm::expressions::SimpleValuation
+ThreadsafePrismNextStateGenerator<ValueType, StateType>::toSimpleValuation(storm::generator::CompressedState const & state) const {
+	return storm::generator::unpackStateIntoValuation(state, this->variableInformation, this->program.getManager());
+}
 
+template<typename ValueType, typename StateType>
+uint64_t
+ThreadsafePrismNextStateGenerator<ValueType, StateType>::getNumberOfGuardEvaluations() const {
+	uint64_t guardEvaluations = this->context.guardEvaluations;
+	std::lock_guard<std::mutex> lock(contextsMutex);
+	for (auto const & threadAndContext : contexts) {
+		guardEvaluations += threadAndContext.second->guardEvaluations;
+	}
+	return guardEvaluations;
+}
+
+template<typename ValueType, typename StateType>
+typename ThreadsafePrismNextStateGenerator<ValueType, StateType>::Context &
+ThreadsafePrismNextStateGenerator<ValueType, StateType>::getContext() {
+	// Threads almost always use the same generator for many states in a row, so they remember the last
+	// context they used and only lock when they switch generators
+	thread_local uint64_t cachedId = 0;
+	thread_local Context * cachedContext = nullptr;
+	if (cachedId == id) {
+		return *cachedContext;
+	}
+	std::lock_guard<std::mutex> lock(contextsMutex);
+	auto & context = contexts[std::this_thread::get_id()];
+	if (!context) {
+		context = std::make_unique<Context>(this->compiledProgram->makeContext());
+	}
+	cachedId = id;
+	cachedContext = context.get();
+	return *context;
 }
 
 template class ThreadsafePrismNextStateGenerator<double>;
@@ -58,5 +93,3 @@ template class ThreadsafePrismNextStateGenerator<double>;
 } // namespace generator
 } // namespace threadsafe
 } // namespace stamina
-
-
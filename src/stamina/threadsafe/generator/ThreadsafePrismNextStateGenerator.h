@@ -18,43 +18,90 @@
  **/
 
 /**
- * Threadsafe drop-in replacement to storm::generator::PrismNextStateGenerator
- * Overrides the following methods:
- *   storm::storage::sparse::StateValuations NextStateGenerator<ValueType, StateType>::makeObservationValuation() const
- *   void NextStateGenerator<ValueType, StateType>::addStateValuation(storm::storage::sparse::state_type const& currentStateIndex, storm::storage::sparse::StateValuationsBuilder& valuationsBuilder) const
+ * Threadsafe drop-in replacement to storm::generator::PrismNextStateGenerator.
+ *
+ * One instance can be shared by all exploration threads. It compiles the program once (see
+ * generator::CompiledPrismProgram), and the compiled program is immutable, so the only state kept per
+ * thread is a small Context of scratch space, which is created the first time a thread expands a state.
+ *
+ * Threads other than the one which constructed the generator must use the reentrant methods which take
+ * the state explicitly (expand(state, callback) and toSimpleValuation()), rather than load() followed by
+ * expand(), since load() keeps the state in the (shared) storm generator. The constructing thread may use
+ * either, and all of storm's other methods (labeling, state valuations) as usual.
+ *
+ * Programs which cannot be compiled cannot be expanded by several threads at once; isCompiled() tells
+ * whether one instance may be shared.
  * */
 #ifndef STAMINA_THREADSAFE_GENERATOR_THREADSAFEPRISMNEXTSTATEGENERATOR_H
 #define STAMINA_THREADSAFE_GENERATOR_THREADSAFEPRISMNEXTSTATEGENERATOR_H
 
 #include <mutex>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <unordered_map>
 
-#include "storm/generator/PrismNextStateGenerator.h"
+#include "generator/CompiledPrismNextStateGenerator.h"
+
+#include <storm/storage/expressions/SimpleValuation.h>
 
 namespace stamina {
 	namespace threadsafe {
 		namespace generator {
 
 			template<typename ValueType, typename StateType = uint32_t>
-			class ThreadsafePrismNextStateGenerator : public storm::generator::PrismNextStateGenerator<ValueType, StateType> {
+			class ThreadsafePrismNextStateGenerator : public stamina::generator::CompiledPrismNextStateGenerator<ValueType, StateType> {
 			public:
+				typedef typename stamina::generator::CompiledPrismNextStateGenerator<ValueType, StateType>::StateToIdCallback StateToIdCallback;
+				typedef typename stamina::generator::CompiledPrismProgram<ValueType>::Context Context;
+				/**
+				 * Constructs the generator and compiles the program
+				 *
+				 * @param program The PRISM program
+				 * @param options Options for the generator
+				 * */
 				ThreadsafePrismNextStateGenerator(
-					storm::prism::Program const& program
-					, storm::generator::NextStateGeneratorOptions const& options = NextStateGeneratorOptions()
-					, std::shared_ptr<ActionMask<ValueType, StateType>> const& = nullptr
+					storm::prism::Program const & program
+					, storm::generator::NextStateGeneratorOptions const & options = storm::generator::NextStateGeneratorOptions()
+				);
+				using stamina::generator::CompiledPrismNextStateGenerator<ValueType, StateType>::expand;
+				/**
+				 * Expands a state. May be called by several threads at once, as long as the program is compiled.
+				 *
+				 * @param state The state to expand. Does not need to be loaded.
+				 * @param stateToIdCallback Callback which gives the index of each successor
+				 * @return The behavior of the state
+				 * */
+				storm::generator::StateBehavior<ValueType, StateType> expand(
+					storm::generator::CompressedState const & state
+					, StateToIdCallback const & stateToIdCallback
 				);
-				storm::storage::sparse::StateValuations makeObservationValuation() const override;
-				void addStateValuation(
-					storm::storage::sparse::state_type const& currentStateIndex
-					, storm::storage::sparse::StateValuationsBuilder& valuationsBuilder
-				) const override;
+				/**
+				 * Gets the values of the variables in a state, like currentStateToSimpleValuation() does for the
+				 * loaded state. May be called by several threads at once.
+				 *
+				 * @param state The state
+				 * @return The valuation of the state
+				 * */
+				storm::expressions::SimpleValuation toSimpleValuation(storm::generator::CompressedState const & state) const;
+				/**
+				 * Gets the number of guards evaluated by all threads
+				 * */
+				uint64_t getNumberOfGuardEvaluations() const override;
+			protected:
+				/**
+				 * Gets the calling thread's context, creating it if needed
+				 * */
+				Context & getContext();
 			private:
-				std::mutex variableInformationMutex;
-				// Variable information should be set up *before* calls to expand()
-				bool varInfoWasSetUp;
+				// Distinguishes this generator from others in each thread's cached context
+				const uint64_t id;
+				mutable std::mutex contextsMutex;
+				std::unordered_map<std::thread::id, std::unique_ptr<Context>> contexts;
+				inline static std::atomic<uint64_t> nextId = 1;
 			};
 		} // namespace generator
 	} // namespace threadsafe
 } // namespace stamina
 
 #endif // STAMINA_THREADSAFE_GENERATOR_THREADSAFEPRISMNEXTSTATEGENERATOR_H
-
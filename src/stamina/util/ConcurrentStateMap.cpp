@@ -0,0 +1,347 @@
+/**
+ * STAMINA - the [ST]ochasic [A]pproximate [M]odel-checker for [IN]finite-state [A]nalysis
+ * Copyright (C) 2023 Fluent Verification, Utah State University
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see https://www.gnu.org/licenses/.
+ *
+ **/
+
+#include "ConcurrentStateMap.h"
+#include "core/StaminaMessages.h"
+
+#include <thread>
+#include <algorithm>
+
+namespace stamina {
+namespace util {
+
+namespace {
+	// Finalizer from splitmix64
+	inline uint64_t mix(uint64_t x) {
+		x ^= x >> 30;
+		x *= 0xBF58476D1CE4E5B9ULL;
+		x ^= x >> 27;
+		x *= 0x94D049BB133111EBULL;
+		x ^= x >> 31;
+		return x;
+	}
+} // namespace
+
+template <typename StateType>
+ConcurrentStateMap<StateType>::Table::Table(uint8_t capacityExponent, uint64_t wordsPerState)
+	: capacity(1ULL << capacityExponent)
+	, mask((1ULL << capacityExponent) - 1)
+	, slots(new std::atomic<uint64_t>[1ULL << capacityExponent]())
+	, keys(new uint64_t[(1ULL << capacityExponent) * wordsPerState])
+	, used(0)
+	, inFlight(0)
+	, sealed(false)
+{
+	// Intentionally left empty
+}
+
+template <typename StateType>
+ConcurrentStateMap<StateType>::ConcurrentStateMap(uint64_t bitsPerState, uint8_t initialCapacityExponent)
+	: bitsPerState(bitsPerState)
+	, wordsPerState((bitsPerState + 63) / 64)
+	, initialCapacityExponent(initialCapacityExponent)
+	, numberOfStates(0)
+	, nextIndex(1) // Index 0 is the absorbing state
+{
+	for (auto & table : tables) {
+		table.store(nullptr);
+	}
+	getOrCreateTable(0);
+}
+
+template <typename StateType>
+ConcurrentStateMap<StateType>::~ConcurrentStateMap() {
+	// Not clear(), which creates a new first table
+	for (auto & table : tables) {
+		delete table.exchange(nullptr);
+	}
+}
+
+template <typename StateType>
+typename ConcurrentStateMap<StateType>::OwnerAndIndex
+ConcurrentStateMap<StateType>::findOrAdd(
+	CompressedState const & state
+	, uint8_t owner
+	, StateType requestedIndex
+) {
+	static thread_local std::vector<uint64_t> words;
+	uint64_t hash = loadWords(state, words);
+	for (uint8_t tableIndex = 0; tableIndex < MAX_TABLES; ++tableIndex) {
+		Table * table = getOrCreateTable(tableIndex);
+		uint64_t position = hash & table->mask;
+		uint64_t probes = 0;
+		while (probes < table->capacity) {
+			uint64_t word = table->slots[position].load();
+			// Another thread is writing the key of this slot
+			while (word == BUSY) {
+				std::this_thread::yield();
+				word = table->slots[position].load();
+			}
+			if (word & OCCUPIED) {
+				if ((word & FINGERPRINT_MASK) == (pack(hash, 0, 0) & FINGERPRINT_MASK) && keyEquals(table, position, words)) {
+					return claim(table, position, word, owner);
+				}
+			}
+			else if (word == EMPTY) {
+				// The state is not in this table. New states may only go into an unsealed table, and
+				// we must be counted as in flight before we check, so that a thread which sees the seal
+				// waits for us (see below)
+				table->inFlight.fetch_add(1);
+				if (table->sealed.load()) {
+					table->inFlight.fetch_sub(1);
+					break;
+				}
+				uint64_t expected = EMPTY;
+				if (!table->slots[position].compare_exchange_strong(expected, BUSY)) {
+					// Someone else took this slot first: look at it again, it may be our state
+					table->inFlight.fetch_sub(1);
+					continue;
+				}
+				std::copy(words.begin(), words.end(), &table->keys[position * wordsPerState]);
+				StateType index;
+				if (requestedIndex != 0) {
+					index = requestedIndex;
+					reserveIndex(requestedIndex);
+				}
+				else {
+					index = nextIndex.fetch_add(1);
+				}
+				// Publishes the owner and index at the same time
+				table->slots[position].store(pack(hash, index, owner));
+				numberOfStates.fetch_add(1);
+				if (table->used.fetch_add(1) + 1 > table->capacity / 4 * 3) {
+					table->sealed.store(true);
+				}
+				table->inFlight.fetch_sub(1);
+				return std::make_pair(owner, index);
+			}
+			// Occupied by another state
+			position = (position + 1) & table->mask;
+			++probes;
+		}
+		// Also seal tables that were probed completely
+		table->sealed.store(true);
+		// Inserts which passed the sealed check before the table was sealed may still be putting our
+		// state into this table. Once they are done no more states can be added to it, so look once more
+		while (table->inFlight.load() != 0) {
+			std::this_thread::yield();
+		}
+		uint64_t word = findIn(table, hash, words, position);
+		if (word != EMPTY) {
+			return claim(table, position, word, owner);
+		}
+	}
+	StaminaMessages::errorAndExit("ConcurrentStateMap ran out of tables!");
+	return std::make_pair(0, 0);
+}
+
+template <typename StateType>
+typename ConcurrentStateMap<StateType>::OwnerAndIndex
+ConcurrentStateMap<StateType>::find(CompressedState const & state) const {
+	static thread_local std::vector<uint64_t> words;
+	uint64_t hash = loadWords(state, words);
+	for (uint8_t tableIndex = 0; tableIndex < MAX_TABLES; ++tableIndex) {
+		Table const * table = tables[tableIndex].load();
+		if (table == nullptr) {
+			break;
+		}
+		uint64_t position = hash & table->mask;
+		bool sawEmpty = false;
+		for (uint64_t probes = 0; probes < table->capacity; ++probes) {
+			uint64_t word = table->slots[position].load();
+			while (word == BUSY) {
+				std::this_thread::yield();
+				word = table->slots[position].load();
+			}
+			if (word == EMPTY) {
+				sawEmpty = true;
+				break;
+			}
+			if ((word & OCCUPIED)
+				&& (word & FINGERPRINT_MASK) == (pack(hash, 0, 0) & FINGERPRINT_MASK)
+				&& keyEquals(table, position, words)
+			) {
+				return std::make_pair(ownerOf(word), indexOf(word));
+			}
+			position = (position + 1) & table->mask;
+		}
+		// States only go into the next table once this one is sealed
+		if (sawEmpty && !table->sealed.load()) {
+			break;
+		}
+	}
+	return std::make_pair(0, 0);
+}
+
+template <typename StateType>
+uint64_t
+ConcurrentStateMap<StateType>::findIn(
+	Table const * table
+	, uint64_t hash
+	, std::vector<uint64_t> const & words
+	, uint64_t & position
+) const {
+	position = hash & table->mask;
+	for (uint64_t probes = 0; probes < table->capacity; ++probes) {
+		uint64_t word = table->slots[position].load();
+		while (word == BUSY) {
+			std::this_thread::yield();
+			word = table->slots[position].load();
+		}
+		if (word == EMPTY) {
+			break;
+		}
+		if ((word & FINGERPRINT_MASK) == (pack(hash, 0, 0) & FINGERPRINT_MASK) && keyEquals(table, position, words)) {
+			return word;
+		}
+		position = (position + 1) & table->mask;
+	}
+	return EMPTY;
+}
+
+template <typename StateType>
+typename ConcurrentStateMap<StateType>::OwnerAndIndex
+ConcurrentStateMap<StateType>::claim(Table * table, uint64_t position, uint64_t word, uint8_t owner) {
+	// Claim states which were registered without an owner
+	while (ownerOf(word) == 0 && owner != 0) {
+		if (table->slots[position].compare_exchange_weak(word, word | owner)) {
+			return std::make_pair(owner, indexOf(word));
+		}
+	}
+	return std::make_pair(ownerOf(word), indexOf(word));
+}
+
+template <typename StateType>
+bool
+ConcurrentStateMap<StateType>::contains(CompressedState const & state) const {
+	return find(state).second != 0;
+}
+
+template <typename StateType>
+uint64_t
+ConcurrentStateMap<StateType>::size() const {
+	return numberOfStates.load();
+}
+
+template <typename StateType>
+StateType
+ConcurrentStateMap<StateType>::getNextIndex() const {
+	return nextIndex.load();
+}
+
+template <typename StateType>
+void
+ConcurrentStateMap<StateType>::forEachSince(
+	StateType firstIndex
+	, std::function<void (CompressedState const &, uint8_t, StateType)> const & callback
+) const {
+	CompressedState state(bitsPerState);
+	for (auto const & tableAtomic : tables) {
+		Table const * table = tableAtomic.load();
+		if (table == nullptr) {
+			break;
+		}
+		for (uint64_t position = 0; position < table->capacity; ++position) {
+			uint64_t word = table->slots[position].load();
+			if (!(word & OCCUPIED) || indexOf(word) < firstIndex) {
+				continue;
+			}
+			uint64_t const * key = &table->keys[position * wordsPerState];
+			for (uint64_t i = 0; i < wordsPerState; ++i) {
+				uint64_t numberOfBits = std::min<uint64_t>(64, bitsPerState - i * 64);
+				state.setFromInt(i * 64, numberOfBits, key[i]);
+			}
+			callback(state, ownerOf(word), indexOf(word));
+		}
+	}
+}
+
+template <typename StateType>
+void
+ConcurrentStateMap<StateType>::clear() {
+	for (auto & table : tables) {
+		delete table.exchange(nullptr);
+	}
+	numberOfStates.store(0);
+	nextIndex.store(1);
+	getOrCreateTable(0);
+}
+
+template <typename StateType>
+typename ConcurrentStateMap<StateType>::Table *
+ConcurrentStateMap<StateType>::getOrCreateTable(uint8_t tableIndex) {
+	Table * table = tables[tableIndex].load();
+	if (table != nullptr) {
+		return table;
+	}
+	// Several threads may get here at once. Only one of them gets to install its table
+	Table * newTable = new Table(initialCapacityExponent + tableIndex, wordsPerState);
+	if (tables[tableIndex].compare_exchange_strong(table, newTable)) {
+		return newTable;
+	}
+	delete newTable;
+	return table;
+}
+
+template <typename StateType>
+uint64_t
+ConcurrentStateMap<StateType>::loadWords(CompressedState const & state, std::vector<uint64_t> & words) const {
+	words.resize(wordsPerState);
+	uint64_t hash = mix(bitsPerState);
+	for (uint64_t i = 0; i < wordsPerState; ++i) {
+		uint64_t numberOfBits = std::min<uint64_t>(64, bitsPerState - i * 64);
+		words[i] = state.getAsInt(i * 64, numberOfBits);
+		hash = mix(hash ^ (words[i] + i));
+	}
+	return hash;
+}
+
+template <typename StateType>
+bool
+ConcurrentStateMap<StateType>::keyEquals(
+	Table const * table
+	, uint64_t slot
+	, std::vector<uint64_t> const & words
+) const {
+	return std::equal(words.begin(), words.end(), &table->keys[slot * wordsPerState]);
+}
+
+template <typename StateType>
+void
+ConcurrentStateMap<StateType>::reserveIndex(StateType index) {
+	StateType current = nextIndex.load();
+	while (current <= index && !nextIndex.compare_exchange_weak(current, index + 1)) {
+		// Retry with the updated value of current
+	}
+}
+
+template <typename StateType>
+uint64_t
+ConcurrentStateMap<StateType>::pack(uint64_t hash, StateType index, uint8_t owner) {
+	return OCCUPIED
+		| (((hash >> 41) << 40) & FINGERPRINT_MASK)
+		| (static_cast<uint64_t>(index) << 8)
+		| owner;
+}
+
+// Explicitly instantiate
+template class ConcurrentStateMap<uint32_t>;
+
+} // namespace util
+} // namespace stamina
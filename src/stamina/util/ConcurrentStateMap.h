@@ -0,0 +1,185 @@
+/**
+ * STAMINA - the [ST]ochasic [A]pproximate [M]odel-checker for [IN]finite-state [A]nalysis
+ * Copyright (C) 2023 Fluent Verification, Utah State University
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see https://www.gnu.org/licenses/.
+ *
+ **/
+
+#ifndef STAMINA_UTIL_CONCURRENTSTATEMAP_H
+#define STAMINA_UTIL_CONCURRENTSTATEMAP_H
+
+#include <atomic>
+#include <array>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <utility>
+#include <functional>
+
+#include <storm/generator/CompressedState.h>
+
+/**
+ * A lock-free open-addressing hash map from CompressedState to the pair (owning thread, state index),
+ * used by the threaded model builders in place of a mutex-guarded storm::storage::BitVectorHashMap.
+ *
+ * Every slot has one 64-bit atomic word holding an occupied flag, a fingerprint of the hash, the state
+ * index and the owning thread. A new state is inserted by a single CAS which claims an empty slot, so
+ * the owner and index of a state become visible to other threads in one step. The key itself is written
+ * before the slot word is published, so readers which see an occupied slot can always compare keys.
+ *
+ * Tables never move. When a table becomes too full it is "sealed" and a table twice the size is chained
+ * after it. Each table counts the inserts in flight. A thread which finds a table sealed waits for them to
+ * finish and looks in that table once more before it moves on, so a state is only ever present in one table.
+ *
+ * Index 0 is reserved for the absorbing state and thread 0 means "no thread owns this state".
+ * */
+namespace stamina {
+	namespace util {
+		template <typename StateType>
+		class ConcurrentStateMap {
+		public:
+			typedef storm::generator::CompressedState CompressedState;
+			// Owning thread and state index
+			typedef std::pair<uint8_t, StateType> OwnerAndIndex;
+			/**
+			 * Constructs a ConcurrentStateMap
+			 *
+			 * @param bitsPerState The number of bits in each CompressedState
+			 * @param initialCapacityExponent The log2 of the number of slots in the first table
+			 * */
+			ConcurrentStateMap(uint64_t bitsPerState, uint8_t initialCapacityExponent = 16); // 2 ^ 16
+			~ConcurrentStateMap();
+			/**
+			 * Finds a state, or inserts it if it does not exist. If it did not exist, or existed but was not
+			 * owned by any thread, it is now owned by `owner`. If `requestedIndex` is 0, new states are given
+			 * the next free index, otherwise they are given `requestedIndex`.
+			 *
+			 * Safe to call from any number of threads at once.
+			 *
+			 * @param state The state to find or insert
+			 * @param owner The thread requesting ownership (may be 0 to only register the state)
+			 * @param requestedIndex The index to give the state if it is new
+			 * @return The (possibly different) owning thread and the index of the state
+			 * */
+			OwnerAndIndex findOrAdd(CompressedState const & state, uint8_t owner, StateType requestedIndex = 0);
+			/**
+			 * Finds a state without inserting it. Safe to call from any number of threads at once.
+			 *
+			 * @param state The state to look up
+			 * @return The owning thread and index of the state, or (0, 0) if it does not exist
+			 * */
+			OwnerAndIndex find(CompressedState const & state) const;
+			/**
+			 * Whether or not a state exists in the map
+			 *
+			 * @param state The state to look up
+			 * */
+			bool contains(CompressedState const & state) const;
+			/**
+			 * Number of states in the map
+			 * */
+			uint64_t size() const;
+			/**
+			 * The index the next new state will be given
+			 * */
+			StateType getNextIndex() const;
+			/**
+			 * Calls `callback` with every state whose index is at least `firstIndex`. This must NOT be called
+			 * while other threads are inserting.
+			 *
+			 * @param firstIndex The smallest index to visit
+			 * @param callback Called with the state, owning thread and index
+			 * */
+			void forEachSince(
+				StateType firstIndex
+				, std::function<void (CompressedState const &, uint8_t, StateType)> const & callback
+			) const;
+			/**
+			 * Frees all tables. This must NOT be called while other threads are using the map
+			 * */
+			void clear();
+			// Maximum number of chained tables (the last one has 2 ^ (initial + MAX_TABLES - 1) slots)
+			constexpr static uint8_t MAX_TABLES = 24;
+		protected:
+			/**
+			 * A single, fixed size table of slots
+			 * */
+			struct Table {
+				Table(uint8_t capacityExponent, uint64_t wordsPerState);
+				uint64_t capacity;
+				uint64_t mask;
+				std::unique_ptr<std::atomic<uint64_t>[]> slots;
+				std::unique_ptr<uint64_t[]> keys;
+				std::atomic<uint64_t> used;
+				// Inserts which have checked `sealed` but not published their slot yet
+				std::atomic<uint32_t> inFlight;
+				std::atomic<bool> sealed;
+			};
+			/**
+			 * Gets the table at a position in the chain, creating it if it does not exist yet
+			 * */
+			Table * getOrCreateTable(uint8_t tableIndex);
+			/**
+			 * Copies the words of a state into `words` and returns its hash
+			 * */
+			uint64_t loadWords(CompressedState const & state, std::vector<uint64_t> & words) const;
+			/**
+			 * Whether the key stored at `slot` in `table` is equal to `words`
+			 * */
+			bool keyEquals(Table const * table, uint64_t slot, std::vector<uint64_t> const & words) const;
+			/**
+			 * Looks for a state in a single table without inserting it
+			 *
+			 * @param position Set to the slot of the state, if it is found
+			 * @return The slot word of the state, or EMPTY if it is not in the table
+			 * */
+			uint64_t findIn(Table const * table, uint64_t hash, std::vector<uint64_t> const & words, uint64_t & position) const;
+			/**
+			 * Gives a state found at `position` to `owner` if no thread owns it yet
+			 *
+			 * @return The owning thread and index of the state
+			 * */
+			OwnerAndIndex claim(Table * table, uint64_t position, uint64_t word, uint8_t owner);
+			/**
+			 * Raises nextIndex so that it is greater than `index`
+			 * */
+			void reserveIndex(StateType index);
+			/*
+			 * Slot word layout:
+			 *     bit 63:      occupied
+			 *     bits 40-62:  fingerprint (upper bits of the hash)
+			 *     bits 8-39:   state index
+			 *     bits 0-7:    owning thread
+			 * */
+			constexpr static uint64_t EMPTY = 0;
+			constexpr static uint64_t BUSY = 1; // Claimed but key not yet written
+			constexpr static uint64_t OCCUPIED = 1ULL << 63;
+			constexpr static uint64_t FINGERPRINT_MASK = ((1ULL << 23) - 1) << 40;
+			static uint64_t pack(uint64_t hash, StateType index, uint8_t owner);
+			static uint8_t ownerOf(uint64_t word) { return static_cast<uint8_t>(word & 0xFF); }
+			static StateType indexOf(uint64_t word) { return static_cast<StateType>((word >> 8) & 0xFFFFFFFF); }
+		private:
+			const uint64_t bitsPerState;
+			const uint64_t wordsPerState;
+			const uint8_t initialCapacityExponent;
+			std::array<std::atomic<Table *>, MAX_TABLES> tables;
+			std::atomic<uint64_t> numberOfStates;
+			std::atomic<StateType> nextIndex;
+			static_assert(sizeof(StateType) <= 4, "State indices must fit into 32 bits of the slot word");
+		};
+	}
+}
+
+#endif // STAMINA_UTIL_CONCURRENTSTATEMAP_H
@@ -0,0 +1,98 @@
+/**
+ * STAMINA - the [ST]ochasic [A]pproximate [M]odel-checker for [IN]finite-state [A]nalysis
+ * Copyright (C) 2023 Fluent Verification, Utah State University
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see https://www.gnu.org/licenses/.
+ *
+ **/
+
+#include "ExplorationBudget.h"
+
+#include <fstream>
+#include <unistd.h>
+
+namespace stamina {
+namespace util {
+
+ExplorationBudget::ExplorationBudget(
+	uint64_t maxStates
+	, uint64_t maxTransitions
+	, uint64_t maxResidentBytes
+	, uint32_t memoryCheckInterval
+) : maxStates(maxStates)
+	, maxTransitions(maxTransitions)
+	, maxResidentBytes(maxResidentBytes)
+	, memoryCheckInterval(memoryCheckInterval == 0 ? 1 : memoryCheckInterval)
+	, checksSinceMemoryCheck(0)
+	, exhausted(false)
+{
+	// Intentionally left empty
+}
+
+bool
+ExplorationBudget::check(uint64_t numberOfStates, uint64_t numberOfTransitions) {
+	if (exhausted.load(std::memory_order_relaxed)) {
+		return true;
+	}
+	if (maxStates != 0 && numberOfStates >= maxStates) {
+		exhaust("state budget of " + std::to_string(maxStates) + " states");
+	}
+	else if (maxTransitions != 0 && numberOfTransitions >= maxTransitions) {
+		exhaust("transition budget of " + std::to_string(maxTransitions) + " transitions");
+	}
+	else if (maxResidentBytes != 0 && ++checksSinceMemoryCheck >= memoryCheckInterval) {
+		checksSinceMemoryCheck = 0;
+		if (getResidentBytes() >= maxResidentBytes) {
+			exhaust("memory budget of " + std::to_string(maxResidentBytes >> 20) + " MB");
+		}
+	}
+	return exhausted.load(std::memory_order_relaxed);
+}
+
+bool
+ExplorationBudget::isExhausted() const {
+	return exhausted.load(std::memory_order_acquire);
+}
+
+bool
+ExplorationBudget::isLimited() const {
+	return maxStates != 0 || maxTransitions != 0 || maxResidentBytes != 0;
+}
+
+std::string const &
+ExplorationBudget::getReason() const {
+	return reason;
+}
+
+uint64_t
+ExplorationBudget::getResidentBytes() {
+	// The second field of statm is the number of resident pages
+	std::ifstream statm("/proc/self/statm");
+	uint64_t totalPages = 0;
+	uint64_t residentPages = 0;
+	if (!(statm >> totalPages >> residentPages)) {
+		return 0;
+	}
+	return residentPages * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+}
+
+void
+ExplorationBudget::exhaust(std::string reason) {
+	// The reason is written before the flag is released, so readers which see the flag also see the reason
+	this->reason = std::move(reason);
+	exhausted.store(true, std::memory_order_release);
+}
+
+} // namespace util
+} // namespace stamina
@@ -0,0 +1,84 @@
+/**
+ * STAMINA - the [ST]ochasic [A]pproximate [M]odel-checker for [IN]finite-state [A]nalysis
+ * Copyright (C) 2023 Fluent Verification, Utah State University
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see https://www.gnu.org/licenses/.
+ *
+ **/
+
+#ifndef STAMINA_UTIL_EXPLORATIONBUDGET_H
+#define STAMINA_UTIL_EXPLORATIONBUDGET_H
+
+#include <atomic>
+#include <string>
+#include <cstdint>
+
+/**
+ * Caps how far the model builders may explore, by the number of states, the number of transitions and the
+ * resident memory of the process. A limit of 0 means no limit. Once any limit is reached, the budget stays
+ * exhausted: the builders stop expanding perimeter states and connect them to the absorbing state instead,
+ * so that Pmin and Pmax are still sound bounds (just wider ones).
+ *
+ * Reading the resident memory costs a system call, so it is only sampled every `memoryCheckInterval` checks.
+ * */
+namespace stamina {
+	namespace util {
+		class ExplorationBudget {
+		public:
+			ExplorationBudget(
+				uint64_t maxStates = 0
+				, uint64_t maxTransitions = 0
+				, uint64_t maxResidentBytes = 0
+				, uint32_t memoryCheckInterval = 1024
+			);
+			/**
+			 * Checks the counts against the budget. Only one thread may call this at a time.
+			 *
+			 * @param numberOfStates The number of states found so far
+			 * @param numberOfTransitions The number of transitions found so far
+			 * @return Whether the budget is exhausted
+			 * */
+			bool check(uint64_t numberOfStates, uint64_t numberOfTransitions);
+			/**
+			 * Whether a limit was reached by an earlier check(). Safe to call from any thread.
+			 * */
+			bool isExhausted() const;
+			/**
+			 * Whether there are any limits at all
+			 * */
+			bool isLimited() const;
+			/**
+			 * Describes the limit which was reached, or is empty if none was
+			 * */
+			std::string const & getReason() const;
+			/**
+			 * Gets the resident memory of this process, or 0 if it cannot be read on this platform
+			 *
+			 * @return The resident memory in bytes
+			 * */
+			static uint64_t getResidentBytes();
+		private:
+			void exhaust(std::string reason);
+			const uint64_t maxStates;
+			const uint64_t maxTransitions;
+			const uint64_t maxResidentBytes;
+			const uint32_t memoryCheckInterval;
+			uint32_t checksSinceMemoryCheck;
+			std::string reason;
+			std::atomic<bool> exhausted;
+		};
+	}
+}
+
+#endif // STAMINA_UTIL_EXPLORATIONBUDGET_H
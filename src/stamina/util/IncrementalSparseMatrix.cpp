@@ -0,0 +1,232 @@
+/**
+ * STAMINA - the [ST]ochasic [A]pproximate [M]odel-checker for [IN]finite-state [A]nalysis
+ * Copyright (C) 2023 Fluent Verification, Utah State University
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see https://www.gnu.org/licenses/.
+ *
+ **/
+
+#include "IncrementalSparseMatrix.h"
+
+#include <algorithm>
+
+namespace stamina {
+namespace util {
+
+template <typename ValueType, typename StateType>
+IncrementalSparseMatrix<ValueType, StateType>::IncrementalSparseMatrix()
+	: staleEntries(0)
+	, rowsRewritten(0)
+{
+	// Intentionally left empty
+}
+
+template <typename ValueType, typename StateType>
+void
+IncrementalSparseMatrix<ValueType, StateType>::replaceRow(
+	StateType row
+	, std::vector<TransitionInfo> const & transitions
+) {
+	scratch.clear();
+	for (auto const & transition : transitions) {
+		if (transition.transition == 0.0) {
+			continue;
+		}
+		scratch.emplace_back(transition.to, transition.transition);
+	}
+	replaceRowFromScratch(row);
+}
+
+template <typename ValueType, typename StateType>
+void
+IncrementalSparseMatrix<ValueType, StateType>::replaceRow(
+	StateType row
+	, TransitionStore<ValueType, StateType> const & transitions
+	, ValueType rateToAbsorbing
+) {
+	scratch.clear();
+	if (rateToAbsorbing != 0.0) {
+		scratch.emplace_back(0, rateToAbsorbing);
+	}
+	transitions.forEachTransition(row, [&](auto const & entry) {
+		ValueType rate = entry.rate;
+		if (rate == 0.0) {
+			return;
+		}
+		scratch.emplace_back(entry.to, rate);
+	});
+	replaceRowFromScratch(row);
+}
+
+template <typename ValueType, typename StateType>
+void
+IncrementalSparseMatrix<ValueType, StateType>::replaceRowFromScratch(StateType row) {
+	if (rowStart.size() <= row) {
+		rowStart.resize(row + 1, 0);
+		rowLength.resize(row + 1, 0);
+	}
+	auto byColumn = [](MatrixEntry const & a, MatrixEntry const & b) {
+		return a.getColumn() < b.getColumn();
+	};
+	// Successors usually come out of the generator in order already
+	if (!std::is_sorted(scratch.begin(), scratch.end(), byColumn)) {
+		std::stable_sort(scratch.begin(), scratch.end(), byColumn);
+	}
+	// Old entries for this row are now unreachable
+	staleEntries += rowLength[row];
+	rowStart[row] = entries.size();
+	IndexType length = 0;
+	for (auto const & entry : scratch) {
+		if (length > 0 && entries.back().getColumn() == entry.getColumn()) {
+			entries.back().setValue(entries.back().getValue() + entry.getValue());
+			continue;
+		}
+		entries.push_back(entry);
+		++length;
+	}
+	rowLength[row] = length;
+	++rowsRewritten;
+	if (staleEntries > entries.size() / 2) {
+		compact();
+	}
+}
+
+template <typename ValueType, typename StateType>
+typename IncrementalSparseMatrix<ValueType, StateType>::IndexType
+IncrementalSparseMatrix<ValueType, StateType>::getRowEntryCount(StateType row) const {
+	if (row >= rowLength.size()) {
+		return 0;
+	}
+	return rowLength[row];
+}
+
+template <typename ValueType, typename StateType>
+storm::storage::SparseMatrix<ValueType>
+IncrementalSparseMatrix<ValueType, StateType>::build(IndexType rowCount) {
+	std::vector<IndexType> rowIndications;
+	rowIndications.reserve(rowCount + 1);
+	std::vector<MatrixEntry> columnsAndValues;
+	columnsAndValues.reserve(entries.size() - staleEntries);
+	rowIndications.push_back(0);
+	IndexType row = 0;
+	while (row < rowCount) {
+		if (row >= rowStart.size()) {
+			rowIndications.push_back(columnsAndValues.size());
+			++row;
+			continue;
+		}
+		// Copy runs of rows which are contiguous in the entry array all at once
+		IndexType runStart = rowStart[row];
+		IndexType runEnd = runStart + rowLength[row];
+		rowIndications.push_back(columnsAndValues.size() + rowLength[row]);
+		++row;
+		while (row < rowCount && row < rowStart.size() && (rowStart[row] == runEnd || rowLength[row] == 0)) {
+			runEnd += rowLength[row];
+			rowIndications.push_back(columnsAndValues.size() + (runEnd - runStart));
+			++row;
+		}
+		columnsAndValues.insert(
+			columnsAndValues.end()
+			, entries.begin() + runStart
+			, entries.begin() + runEnd
+		);
+	}
+	rowsRewritten = 0;
+	return storm::storage::SparseMatrix<ValueType>(
+		rowCount
+		, std::move(rowIndications)
+		, std::move(columnsAndValues)
+		, boost::none
+	);
+}
+
+template <typename ValueType, typename StateType>
+storm::storage::SparseMatrix<ValueType>
+IncrementalSparseMatrix<ValueType, StateType>::release(IndexType rowCount) {
+	std::vector<IndexType> rowIndications;
+	rowIndications.reserve(rowCount + 1);
+	rowIndications.push_back(0);
+	bool inOrder = staleEntries == 0;
+	for (IndexType row = 0; row < rowStart.size() && inOrder; ++row) {
+		inOrder = rowLength[row] == 0 || rowStart[row] == rowIndications.back();
+		rowIndications.push_back(rowIndications.back() + rowLength[row]);
+	}
+	if (!inOrder) {
+		compact();
+		rowIndications.resize(1);
+		for (IndexType row = 0; row < rowStart.size(); ++row) {
+			rowIndications.push_back(rowIndications.back() + rowLength[row]);
+		}
+	}
+	// Rows which were never written are empty
+	while (rowIndications.size() < rowCount + 1) {
+		rowIndications.push_back(rowIndications.back());
+	}
+	rowIndications.resize(rowCount + 1);
+	std::vector<MatrixEntry> columnsAndValues = std::move(entries);
+	columnsAndValues.erase(columnsAndValues.begin() + rowIndications.back(), columnsAndValues.end());
+	clear();
+	return storm::storage::SparseMatrix<ValueType>(
+		rowCount
+		, std::move(rowIndications)
+		, std::move(columnsAndValues)
+		, boost::none
+	);
+}
+
+template <typename ValueType, typename StateType>
+uint64_t
+IncrementalSparseMatrix<ValueType, StateType>::getNumberOfRowsRewritten() const {
+	return rowsRewritten;
+}
+
+template <typename ValueType, typename StateType>
+typename IncrementalSparseMatrix<ValueType, StateType>::IndexType
+IncrementalSparseMatrix<ValueType, StateType>::getRowCount() const {
+	return rowStart.size();
+}
+
+template <typename ValueType, typename StateType>
+void
+IncrementalSparseMatrix<ValueType, StateType>::clear() {
+	rowStart.clear();
+	rowLength.clear();
+	entries.clear();
+	staleEntries = 0;
+	rowsRewritten = 0;
+}
+
+template <typename ValueType, typename StateType>
+void
+IncrementalSparseMatrix<ValueType, StateType>::compact() {
+	std::vector<MatrixEntry> compacted;
+	compacted.reserve(entries.size() - staleEntries);
+	for (IndexType row = 0; row < rowStart.size(); ++row) {
+		IndexType newStart = compacted.size();
+		compacted.insert(
+			compacted.end()
+			, entries.begin() + rowStart[row]
+			, entries.begin() + rowStart[row] + rowLength[row]
+		);
+		rowStart[row] = newStart;
+	}
+	entries = std::move(compacted);
+	staleEntries = 0;
+}
+
+// Explicitly instantiate
+template class IncrementalSparseMatrix<double, uint32_t>;
+
+} // namespace util
+} // namespace stamina
@@ -0,0 +1,132 @@
+/**
+ * STAMINA - the [ST]ochasic [A]pproximate [M]odel-checker for [IN]finite-state [A]nalysis
+ * Copyright (C) 2023 Fluent Verification, Utah State University
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see https://www.gnu.org/licenses/.
+ *
+ **/
+
+#ifndef STAMINA_UTIL_INCREMENTALSPARSEMATRIX_H
+#define STAMINA_UTIL_INCREMENTALSPARSEMATRIX_H
+
+#include <vector>
+#include <cstdint>
+
+#include <storm/storage/SparseMatrix.h>
+
+#include "builder/StateAndTransitions.h"
+#include "util/TransitionStore.h"
+
+/**
+ * Between refinement iterations, almost every row of the truncated CTMC stays the same: only
+ * newly explored states and perimeter states (whose edges to the absorbing state change) have
+ * rows that differ from the previous model. Rather than re-materialising the entire matrix
+ * through a storm::storage::SparseMatrixBuilder each time, this keeps the previous CSR entries
+ * and only rewrites the rows which were touched since the last build.
+ *
+ * Rewritten rows are appended to the end of the entry array, and the old entries for that row
+ * become "stale". When more than half of the entries are stale, the array is compacted.
+ *
+ * When every row is written exactly once and in order, the entry array already is the CSR column
+ * and value vector, so release() can move it into the storm::storage::SparseMatrix without copying.
+ * */
+namespace stamina {
+	namespace util {
+		template <typename ValueType, typename StateType>
+		class IncrementalSparseMatrix {
+		public:
+			typedef uint_fast64_t IndexType;
+			typedef storm::storage::MatrixEntry<IndexType, ValueType> MatrixEntry;
+			typedef builder::StaminaTransitionInfo<StateType> TransitionInfo;
+			IncrementalSparseMatrix();
+			/**
+			 * Replaces the row at index `row` with the (nonzero) transitions provided. Entries
+			 * are sorted by column and duplicate columns are summed, as storm's SparseMatrixBuilder
+			 * would do.
+			 *
+			 * @param row The row to replace
+			 * @param transitions The transitions out of the state at `row`
+			 * */
+			void replaceRow(StateType row, std::vector<TransitionInfo> const & transitions);
+			/**
+			 * Replaces the row at index `row` with the (nonzero) transitions for that row in a
+			 * TransitionStore.
+			 *
+			 * @param row The row to replace
+			 * @param transitions The store holding the transitions out of the state at `row`
+			 * @param rateToAbsorbing An additional rate into column 0 (the absorbing state)
+			 * */
+			void replaceRow(
+				StateType row
+				, TransitionStore<ValueType, StateType> const & transitions
+				, ValueType rateToAbsorbing = 0
+			);
+			/**
+			 * Gets the number of entries currently in a row
+			 *
+			 * @param row The row to check
+			 * @return The number of entries in that row (0 if it has never been written)
+			 * */
+			IndexType getRowEntryCount(StateType row) const;
+			/**
+			 * Creates a square storm::storage::SparseMatrix from the cached rows. Rows which
+			 * were never written are left empty.
+			 *
+			 * @param rowCount The number of rows (and columns) in the resulting matrix
+			 * @return The transition matrix
+			 * */
+			storm::storage::SparseMatrix<ValueType> build(IndexType rowCount);
+			/**
+			 * Like build(), but moves the cached entries into the matrix instead of copying them, and
+			 * leaves this empty. If rows were rewritten out of order, they are compacted first.
+			 *
+			 * @param rowCount The number of rows (and columns) in the resulting matrix
+			 * @return The transition matrix
+			 * */
+			storm::storage::SparseMatrix<ValueType> release(IndexType rowCount);
+			/**
+			 * Number of rows rewritten since the last call to build()
+			 * */
+			uint64_t getNumberOfRowsRewritten() const;
+			/**
+			 * Number of rows which have ever been written
+			 * */
+			IndexType getRowCount() const;
+			/**
+			 * Frees all cached rows
+			 * */
+			void clear();
+		protected:
+			/**
+			 * Writes the entries in `scratch` as the new contents of a row
+			 *
+			 * @param row The row to replace
+			 * */
+			void replaceRowFromScratch(StateType row);
+			/**
+			 * Rewrites the entry array in row order so that no stale entries remain
+			 * */
+			void compact();
+		private:
+			std::vector<IndexType> rowStart;
+			std::vector<IndexType> rowLength;
+			std::vector<MatrixEntry> entries;
+			std::vector<MatrixEntry> scratch;
+			IndexType staleEntries;
+			uint64_t rowsRewritten;
+		};
+	}
+}
+
+#endif // STAMINA_UTIL_INCREMENTALSPARSEMATRIX_H
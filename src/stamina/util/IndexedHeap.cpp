@@ -0,0 +1,180 @@
+/**
+ * STAMINA - the [ST]ochasic [A]pproximate [M]odel-checker for [IN]finite-state [A]nalysis
+ * Copyright (C) 2023 Fluent Verification, Utah State University
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see https://www.gnu.org/licenses/.
+ *
+ **/
+
+#include "IndexedHeap.h"
+
+#include "builder/ProbabilityState.h"
+
+#include <utility>
+#include <algorithm>
+
+namespace stamina {
+namespace util {
+
+template <typename Element, typename Compare, typename Key>
+IndexedHeap<Element, Compare, Key>::IndexedHeap(Compare compare)
+	: compare(compare)
+{
+	// Intentionally left empty
+}
+
+template <typename Element, typename Compare, typename Key>
+void
+IndexedHeap<Element, Compare, Key>::push(Key key, Element && element) {
+	if (contains(key)) {
+		get(key) = std::move(element);
+		update(key);
+		return;
+	}
+	if (key >= positions.size()) {
+		positions.resize(static_cast<std::size_t>(key) + 1, 0);
+	}
+	entries.push_back(Entry{key, std::move(element)});
+	positions[key] = entries.size();
+	siftUp(entries.size() - 1);
+}
+
+template <typename Element, typename Compare, typename Key>
+bool
+IndexedHeap<Element, Compare, Key>::contains(Key key) const {
+	return key < positions.size() && positions[key] != 0;
+}
+
+template <typename Element, typename Compare, typename Key>
+Element &
+IndexedHeap<Element, Compare, Key>::get(Key key) {
+	return entries[positions[key] - 1].element;
+}
+
+template <typename Element, typename Compare, typename Key>
+void
+IndexedHeap<Element, Compare, Key>::update(Key key) {
+	std::size_t position = positions[key] - 1;
+	siftUp(position);
+	// If it did not move up, it may have to move down
+	if (positions[key] - 1 == position) {
+		siftDown(position);
+	}
+}
+
+template <typename Element, typename Compare, typename Key>
+Element const &
+IndexedHeap<Element, Compare, Key>::top() const {
+	return entries.front().element;
+}
+
+template <typename Element, typename Compare, typename Key>
+Element
+IndexedHeap<Element, Compare, Key>::pop() {
+	Entry removed = std::move(entries.front());
+	positions[removed.key] = 0;
+	Entry last = std::move(entries.back());
+	entries.pop_back();
+	if (!entries.empty()) {
+		place(0, std::move(last));
+		siftDown(0);
+	}
+	return std::move(removed.element);
+}
+
+template <typename Element, typename Compare, typename Key>
+bool
+IndexedHeap<Element, Compare, Key>::empty() const {
+	return entries.empty();
+}
+
+template <typename Element, typename Compare, typename Key>
+std::size_t
+IndexedHeap<Element, Compare, Key>::size() const {
+	return entries.size();
+}
+
+template <typename Element, typename Compare, typename Key>
+void
+IndexedHeap<Element, Compare, Key>::clear() {
+	entries.clear();
+	positions.clear();
+}
+
+template <typename Element, typename Compare, typename Key>
+void
+IndexedHeap<Element, Compare, Key>::siftUp(std::size_t position) {
+	// Parents are shifted down into the hole rather than swapped
+	Entry entry = std::move(entries[position]);
+	while (position > 0) {
+		std::size_t parent = (position - 1) / arity;
+		if (!compare(entries[parent].element, entry.element)) {
+			break;
+		}
+		place(position, std::move(entries[parent]));
+		position = parent;
+	}
+	place(position, std::move(entry));
+}
+
+template <typename Element, typename Compare, typename Key>
+void
+IndexedHeap<Element, Compare, Key>::siftDown(std::size_t position) {
+	Entry entry = std::move(entries[position]);
+	std::size_t size = entries.size();
+	while (true) {
+		std::size_t firstChild = position * arity + 1;
+		if (firstChild >= size) {
+			break;
+		}
+		// Find the child with the highest priority
+		std::size_t best = firstChild;
+		std::size_t lastChild = std::min(firstChild + arity, size);
+		for (std::size_t child = firstChild + 1; child < lastChild; child++) {
+			if (compare(entries[best].element, entries[child].element)) {
+				best = child;
+			}
+		}
+		if (!compare(entry.element, entries[best].element)) {
+			break;
+		}
+		place(position, std::move(entries[best]));
+		position = best;
+	}
+	place(position, std::move(entry));
+}
+
+template <typename Element, typename Compare, typename Key>
+void
+IndexedHeap<Element, Compare, Key>::place(std::size_t position, Entry && entry) {
+	positions[entry.key] = position + 1;
+	entries[position] = std::move(entry);
+}
+
+// Explicitly instantiate
+template class IndexedHeap<
+	builder::ProbabilityStatePair<uint32_t>
+	, builder::ProbabilityStatePairComparison<uint32_t, EVENTS::UNDEFINED>
+>;
+template class IndexedHeap<
+	builder::ProbabilityStatePair<uint32_t>
+	, builder::ProbabilityStatePairComparison<uint32_t, EVENTS::RARE>
+>;
+template class IndexedHeap<
+	builder::ProbabilityStatePair<uint32_t>
+	, builder::ProbabilityStatePairComparison<uint32_t, EVENTS::COMMON>
+>;
+
+} // namespace util
+} // namespace stamina
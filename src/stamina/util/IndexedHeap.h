@@ -0,0 +1,117 @@
+/**
+ * STAMINA - the [ST]ochasic [A]pproximate [M]odel-checker for [IN]finite-state [A]nalysis
+ * Copyright (C) 2023 Fluent Verification, Utah State University
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see https://www.gnu.org/licenses/.
+ *
+ **/
+
+#ifndef STAMINA_UTIL_INDEXEDHEAP_H
+#define STAMINA_UTIL_INDEXEDHEAP_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * An addressable 4-ary max-heap. Every element has a key (a state index), and the heap knows where the
+ * element with each key is, so an element whose priority changed can be moved to its new place in
+ * O(log n) rather than pushed again as a duplicate. Elements are stored by value in one contiguous
+ * array, and a 4-ary heap is shallower and friendlier to the cache than a binary one.
+ *
+ * Like std::priority_queue, `compare(a, b)` is true if `a` has a lower priority than `b`, and top() is
+ * the element with the highest priority.
+ * */
+namespace stamina {
+	namespace util {
+		template <typename Element, typename Compare, typename Key = uint32_t>
+		class IndexedHeap {
+		public:
+			static constexpr std::size_t arity = 4;
+			IndexedHeap(Compare compare = Compare());
+			/**
+			 * Adds an element. If there already is an element with the same key, it is replaced.
+			 *
+			 * @param key The key of the element
+			 * @param element The element to move in
+			 * */
+			void push(Key key, Element && element);
+			/**
+			 * Whether there is an element with a key
+			 * */
+			bool contains(Key key) const;
+			/**
+			 * Gets the element with a key. If its priority is changed, update() must be called.
+			 *
+			 * @param key The key, which must be in the heap
+			 * @return The element
+			 * */
+			Element & get(Key key);
+			/**
+			 * Restores the heap after the priority of an element changed (in either direction)
+			 *
+			 * @param key The key of the element, which must be in the heap
+			 * */
+			void update(Key key);
+			/**
+			 * Gets the element with the highest priority. The heap must not be empty.
+			 * */
+			Element const & top() const;
+			/**
+			 * Removes the element with the highest priority. The heap must not be empty.
+			 *
+			 * @return The element which was removed
+			 * */
+			Element pop();
+			/**
+			 * Calls `function(Element const &)` for each element, in no particular order
+			 * */
+			template <typename Function>
+			void forEach(Function && function) const {
+				for (auto const & entry : entries) {
+					function(entry.element);
+				}
+			}
+			bool empty() const;
+			std::size_t size() const;
+			/**
+			 * Removes all elements
+			 * */
+			void clear();
+		private:
+			struct Entry {
+				Key key;
+				Element element;
+			};
+			/**
+			 * Moves the entry at a position towards the root until its parent has at least its priority
+			 * */
+			void siftUp(std::size_t position);
+			/**
+			 * Moves the entry at a position towards the leaves until none of its children has a higher priority
+			 * */
+			void siftDown(std::size_t position);
+			/**
+			 * Moves an entry into a position and records where it is
+			 * */
+			void place(std::size_t position, Entry && entry);
+			std::vector<Entry> entries;
+			// For each key, one more than the position of its entry, or 0 if it is not in the heap
+			std::vector<std::size_t> positions;
+			Compare compare;
+		};
+	}
+}
+
+#endif // STAMINA_UTIL_INDEXEDHEAP_H
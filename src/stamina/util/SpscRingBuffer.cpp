@@ -0,0 +1,96 @@
+/**
+ * STAMINA - the [ST]ochasic [A]pproximate [M]odel-checker for [IN]finite-state [A]nalysis
+ * Copyright (C) 2023 Fluent Verification, Utah State University
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see https://www.gnu.org/licenses/.
+ *
+ **/
+
+#include "SpscRingBuffer.h"
+
+#include "builder/StateAndTransitions.h"
+
+#include <thread>
+#include <vector>
+
+namespace stamina {
+namespace util {
+
+template <typename T>
+SpscRingBuffer<T>::SpscRingBuffer(uint8_t capacityExponent)
+	: capacity(1ULL << capacityExponent)
+	, mask((1ULL << capacityExponent) - 1)
+	, elements(new T[1ULL << capacityExponent])
+	, head(0)
+	, cachedTail(0)
+	, tail(0)
+	, cachedHead(0)
+{
+	// Intentionally left empty
+}
+
+template <typename T>
+bool
+SpscRingBuffer<T>::tryPush(T && element) {
+	uint64_t currentHead = head.load(std::memory_order_relaxed);
+	if (currentHead - cachedTail >= capacity) {
+		cachedTail = tail.load(std::memory_order_acquire);
+		if (currentHead - cachedTail >= capacity) {
+			return false;
+		}
+	}
+	elements[currentHead & mask] = std::move(element);
+	head.store(currentHead + 1, std::memory_order_release);
+	return true;
+}
+
+template <typename T>
+void
+SpscRingBuffer<T>::push(T && element) {
+	while (!tryPush(std::move(element))) {
+		// The consumer is behind. tryPush() does not move from element when it fails
+		std::this_thread::yield();
+	}
+}
+
+template <typename T>
+T *
+SpscRingBuffer<T>::front() {
+	uint64_t currentTail = tail.load(std::memory_order_relaxed);
+	if (currentTail == cachedHead) {
+		cachedHead = head.load(std::memory_order_acquire);
+		if (currentTail == cachedHead) {
+			return nullptr;
+		}
+	}
+	return &elements[currentTail & mask];
+}
+
+template <typename T>
+void
+SpscRingBuffer<T>::pop() {
+	tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+template <typename T>
+bool
+SpscRingBuffer<T>::empty() const {
+	return tail.load(std::memory_order_acquire) == head.load(std::memory_order_acquire);
+}
+
+// Explicitly instantiate
+template class SpscRingBuffer<std::vector<builder::StaminaTransitionInfo<uint32_t>>>;
+
+} // namespace util
+} // namespace stamina
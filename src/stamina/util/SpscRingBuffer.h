@@ -0,0 +1,84 @@
+/**
+ * STAMINA - the [ST]ochasic [A]pproximate [M]odel-checker for [IN]finite-state [A]nalysis
+ * Copyright (C) 2023 Fluent Verification, Utah State University
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see https://www.gnu.org/licenses/.
+ *
+ **/
+
+#ifndef STAMINA_UTIL_SPSCRINGBUFFER_H
+#define STAMINA_UTIL_SPSCRINGBUFFER_H
+
+#include <atomic>
+#include <memory>
+#include <cstdint>
+
+/**
+ * A bounded single-producer/single-consumer ring buffer. Exactly one thread may push and exactly one
+ * (other) thread may consume. Neither side ever locks: the producer only writes `head` and the consumer
+ * only writes `tail`, and each keeps a cached copy of the other's index so that it only touches the
+ * other's cache line when the buffer looks full (or empty).
+ *
+ * Elements are moved in and can be used in place by the consumer (see front()), so large elements such
+ * as vectors are never copied.
+ * */
+namespace stamina {
+	namespace util {
+		template <typename T>
+		class SpscRingBuffer {
+		public:
+			SpscRingBuffer(uint8_t capacityExponent = 10); // 2 ^ 10
+			/**
+			 * Moves an element into the buffer if there is space. Producer thread only.
+			 *
+			 * @param element The element to move in
+			 * @return Whether there was space for the element
+			 * */
+			bool tryPush(T && element);
+			/**
+			 * Moves an element into the buffer, yielding until there is space. Producer thread only.
+			 *
+			 * @param element The element to move in
+			 * */
+			void push(T && element);
+			/**
+			 * Gets the oldest element in the buffer without removing it. Consumer thread only.
+			 * The element may be modified (or moved from) until pop() is called.
+			 *
+			 * @return The oldest element or nullptr if the buffer is empty
+			 * */
+			T * front();
+			/**
+			 * Removes the oldest element. Consumer thread only, and only after front() returned an element.
+			 * */
+			void pop();
+			/**
+			 * Whether the buffer is (currently) empty
+			 * */
+			bool empty() const;
+		private:
+			const uint64_t capacity;
+			const uint64_t mask;
+			std::unique_ptr<T[]> elements;
+			// Written by the producer
+			alignas(64) std::atomic<uint64_t> head;
+			uint64_t cachedTail;
+			// Written by the consumer
+			alignas(64) std::atomic<uint64_t> tail;
+			uint64_t cachedHead;
+		};
+	}
+}
+
+#endif // STAMINA_UTIL_SPSCRINGBUFFER_H
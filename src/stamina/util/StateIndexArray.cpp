@@ -19,24 +19,33 @@
 
 #include "StateIndexArray.h"
 
+#include <atomic>
+
 #include "builder/StaminaModelBuilder.h"
 
 namespace stamina {
 namespace util {
 
+template <typename StateType, typename ProbabilityStateType>
+StateIndexArray<StateType, ProbabilityStateType>::Block::Block(uint32_t blockSize)
+	: states(new ProbabilityStateType[blockSize])
+	// Value-initialized, so no state is present
+	, present(new uint64_t[blockSize / 64]())
+	, terminal(new uint64_t[blockSize / 64]())
+{
+	// Intentionally left empty
+}
+
 template <typename StateType, typename ProbabilityStateType>
 StateIndexArray<StateType, ProbabilityStateType>::StateIndexArray(uint8_t blockSizeExponent)
 : blockSize(2 << blockSizeExponent)
 	, numElements(0)
+	, numberOfBlocks(0)
 {
-	std::shared_ptr<ProbabilityStateType *> subArray(
-		new ProbabilityStateType *[blockSize]
-		, std::default_delete<ProbabilityStateType *[]>()
-	);
-	for (int i = 0; i < blockSize; i++) {
-		subArray.get()[i] = nullptr;
-	}
-	stateArray.push_back(subArray);
+	for (auto & segment : segments) {
+		segment.store(nullptr);
+	}
+	addBlocks(0);
 }
 
 template <typename StateType, typename ProbabilityStateType>
@@ -47,7 +56,18 @@ StateIndexArray<StateType, ProbabilityStateType>::~StateIndexArray() {
 template <typename StateType, typename ProbabilityStateType>
 void
 StateIndexArray<StateType, ProbabilityStateType>::clear() {
-	this->stateArray.clear();
+	for (uint8_t segment = 0; segment < MAX_SEGMENTS; segment++) {
+		std::atomic<Block *> * blocks = segments[segment].exchange(nullptr);
+		if (blocks == nullptr) {
+			continue;
+		}
+		for (uint64_t block = 0; block < (1ULL << segment); block++) {
+			delete blocks[block].load();
+		}
+		delete[] blocks;
+	}
+	numberOfBlocks = 0;
+	numElements = 0;
 }
 
 template <typename StateType, typename ProbabilityStateType>
@@ -55,68 +75,103 @@ void
 StateIndexArray<StateType, ProbabilityStateType>::reserve(uint32_t numToReserve) {
 	this->clear();
 	uint32_t actualNumToReserve = sizeToActualSize(numToReserve);
-	uint16_t arrayIndex = actualNumToReserve / blockSize;
-	for (int i = 0; i < arrayIndex; i++) {
-		std::shared_ptr<ProbabilityStateType *> subArray(
-			new ProbabilityStateType *[blockSize]
-			, std::default_delete<ProbabilityStateType *[]>()
-		);
-		for (int j = 0; j < blockSize; j++) {
-			subArray.get()[j] = nullptr;
-		}
-		stateArray.push_back(subArray);
-	}
+	uint32_t arrayIndex = actualNumToReserve / blockSize;
+	addBlocks(arrayIndex);
 }
 
 template <typename StateType, typename ProbabilityStateType>
 ProbabilityStateType *
 StateIndexArray<StateType, ProbabilityStateType>::get(StateType index) const {
-	uint16_t arrayIndex = index / blockSize;
-	if (arrayIndex > stateArray.size() - 1) {
+	uint32_t arrayIndex = index / blockSize;
+	Block * block = getBlock(arrayIndex);
+	if (block == nullptr) {
 		return nullptr;
 	}
 	uint32_t subArrayIndex = index % blockSize;
-	return stateArray[arrayIndex].get()[subArrayIndex];
+	uint64_t present = std::atomic_ref<uint64_t>(block->present[subArrayIndex / 64]).load(std::memory_order_acquire);
+	if (!(present & (1ULL << (subArrayIndex % 64)))) {
+		return nullptr;
+	}
+	return &block->states[subArrayIndex];
 }
 
 template <typename StateType, typename ProbabilityStateType>
-void
+ProbabilityStateType *
 StateIndexArray<StateType, ProbabilityStateType>::put(
 	StateType index
-	, ProbabilityStateType * probabilityState
+	, ProbabilityStateType const & probabilityState
 ) {
-	numElements++;
-	uint16_t arrayIndex = index / blockSize;
+	uint32_t arrayIndex = index / blockSize;
 	uint32_t subArrayIndex = index % blockSize;
-	while (arrayIndex > stateArray.size() - 1) {
-		std::shared_ptr<ProbabilityStateType *> subArray(
-			new ProbabilityStateType *[blockSize]
-			, std::default_delete<ProbabilityStateType *[]>()
-		);
-		for (int j = 0; j < blockSize; j++) {
-			subArray.get()[j] = nullptr;
+	if (arrayIndex >= numberOfBlocks.load()) {
+		addBlocks(arrayIndex);
+	}
+	Block * block = getBlock(arrayIndex);
+	uint64_t presentBit = 1ULL << (subArrayIndex % 64);
+	ProbabilityStateType * slot = &block->states[subArrayIndex];
+	*slot = probabilityState;
+	// Other threads may be changing other states in the same words
+	uint64_t & terminalWord = block->terminal[subArrayIndex / 64];
+	if (slot->isTerminal()) {
+		std::atomic_ref<uint64_t>(terminalWord).fetch_or(presentBit);
+	}
+	else {
+		std::atomic_ref<uint64_t>(terminalWord).fetch_and(~presentBit);
+	}
+	// Only mark the state present once it has been written
+	uint64_t & presentWord = block->present[subArrayIndex / 64];
+	if (!(std::atomic_ref<uint64_t>(presentWord).fetch_or(presentBit, std::memory_order_release) & presentBit)) {
+		std::atomic_ref<uint32_t>(numElements).fetch_add(1);
+	}
+	return slot;
+}
+
+template <typename StateType, typename ProbabilityStateType>
+void
+StateIndexArray<StateType, ProbabilityStateType>::setTerminal(
+	ProbabilityStateType * probabilityState
+	, bool terminal
+) {
+	probabilityState->setTerminal(terminal);
+	StateType index = probabilityState->index;
+	uint64_t & terminalWord = getBlock(index / blockSize)->terminal[(index % blockSize) / 64];
+	uint64_t terminalBit = 1ULL << (index % 64);
+	// Other threads may be changing other states in the same word
+	if (terminal) {
+		std::atomic_ref<uint64_t>(terminalWord).fetch_or(terminalBit);
+	}
+	else {
+		std::atomic_ref<uint64_t>(terminalWord).fetch_and(~terminalBit);
+	}
+}
+
+template <typename StateType, typename ProbabilityStateType>
+uint32_t
+StateIndexArray<StateType, ProbabilityStateType>::getNumberTerminal() const {
+	uint32_t numberTerminal = 0;
+	for (uint64_t block = 0; block < numberOfBlocks.load(); block++) {
+		uint64_t const * terminal = getBlock(block)->terminal.get();
+		// Simple enough for the compiler to vectorize
+		for (uint32_t word = 0; word < blockSize / 64; word++) {
+			numberTerminal += std::popcount(terminal[word]);
 		}
-		stateArray.push_back(subArray);
 	}
-	stateArray[arrayIndex].get()[subArrayIndex] = probabilityState;
+	return numberTerminal;
 }
 
 template <typename StateType, typename ProbabilityStateType>
 uint32_t
-StateIndexArray<StateType, ProbabilityStateType>::getNumberTerminal() {
-	return getPerimeterStates().size();
+StateIndexArray<StateType, ProbabilityStateType>::size() const {
+	return numElements;
 }
 
 template <typename StateType, typename ProbabilityStateType>
 std::vector<StateType>
 StateIndexArray<StateType, ProbabilityStateType>::getPerimeterStates() {
 	std::vector<StateType> perimeterStates;
-	for (auto subArray : stateArray) {
-		for (int i = 0; i < blockSize; i++) {
-			if (subArray.get()[i] != nullptr && subArray.get()[i]->isTerminal()) {
-				perimeterStates.push_back(subArray.get()[i]->index);
-			}
-		}
+	perimeterStates.reserve(getNumberTerminal());
+	for (auto probabilityState : perimeter()) {
+		perimeterStates.push_back(probabilityState->index);
 	}
 	return perimeterStates;
 }
@@ -125,12 +180,9 @@ template <typename StateType, typename ProbabilityStateType>
 std::vector<ProbabilityStateType *>
 StateIndexArray<StateType, ProbabilityStateType>::getPerimeterStatesAsProbStates() {
 	std::vector<ProbabilityStateType *> perimeterStates;
-	for (auto subArray : stateArray) {
-		for (int i = 0; i < blockSize; i++) {
-			if (subArray.get()[i] != nullptr && subArray.get()[i]->isTerminal()) {
-				perimeterStates.push_back(subArray.get()[i]);
-			}
-		}
+	perimeterStates.reserve(getNumberTerminal());
+	for (auto probabilityState : perimeter()) {
+		perimeterStates.push_back(probabilityState);
 	}
 	return perimeterStates;
 }
@@ -143,6 +195,49 @@ StateIndexArray<StateType, ProbabilityStateType>::sizeToActualSize(uint32_t size
 	}
 	return size;
 }
+
+template <typename StateType, typename ProbabilityStateType>
+typename StateIndexArray<StateType, ProbabilityStateType>::Block *
+StateIndexArray<StateType, ProbabilityStateType>::getOrCreateBlock(uint64_t blockIndex) {
+	uint64_t segment = std::bit_width(blockIndex + 1) - 1;
+	std::atomic<Block *> * blocks = segments[segment].load(std::memory_order_acquire);
+	if (blocks == nullptr) {
+		// Several threads may get here at once. Only one of them gets to install its segment
+		std::atomic<Block *> * newBlocks = new std::atomic<Block *>[1ULL << segment]();
+		if (segments[segment].compare_exchange_strong(blocks, newBlocks)) {
+			blocks = newBlocks;
+		}
+		else {
+			delete[] newBlocks;
+		}
+	}
+	std::atomic<Block *> & slot = blocks[blockIndex + 1 - (1ULL << segment)];
+	Block * block = slot.load(std::memory_order_acquire);
+	if (block == nullptr) {
+		Block * newBlock = new Block(blockSize);
+		if (slot.compare_exchange_strong(block, newBlock)) {
+			block = newBlock;
+		}
+		else {
+			delete newBlock;
+		}
+	}
+	return block;
+}
+
+template <typename StateType, typename ProbabilityStateType>
+void
+StateIndexArray<StateType, ProbabilityStateType>::addBlocks(uint64_t blockIndex) {
+	for (uint64_t block = numberOfBlocks.load(); block <= blockIndex; block++) {
+		getOrCreateBlock(block);
+	}
+	// Only raise numberOfBlocks once all of the blocks below it exist
+	uint64_t current = numberOfBlocks.load();
+	while (current <= blockIndex && !numberOfBlocks.compare_exchange_weak(current, blockIndex + 1)) {
+		// Retry with the updated value of current
+	}
+}
+
 // Forward-declare
 template class StateIndexArray<
 	uint32_t
@@ -20,27 +20,34 @@
 #ifndef STAMINA_UTIL_STATEINDEXARRAY_H
 #define STAMINA_UTIL_STATEINDEXARRAY_H
 
-#include <boost/pool/object_pool.hpp>
-
 #include <vector>
+#include <array>
+#include <atomic>
 #include <cstdint>
 #include <memory>
+#include <bit>
 
 /**
  * Because state indecies are generally assigned in order, it is more efficient to
  * allocate a linear array which guarantees a O(1) lookup time and has an (at worst)
  * O(n / blockSize) insert.
  *
+ * The ProbabilityStates themselves are stored (by value) in the blocks, rather than pointers
+ * to states allocated elsewhere, and a bitmap per block records which indices hold a state.
+ * Blocks are never moved, so pointers returned by get() and put() stay valid until clear().
+ *
+ * The pointers to the blocks are kept in a directory of segments, where segment `s` holds 2 ^ s
+ * blocks. Segments are allocated when needed and never moved either, so exploration threads can
+ * call get() while another thread's put() adds blocks.
+ *
+ * A second bitmap per block tracks which states are terminal (perimeter) states, so counting them
+ * is a popcount and walking them skips 64 non-terminal states per word without touching the states.
+ * For this to stay correct, the terminal flag of a state in the array must only be changed through
+ * setTerminal().
+ *
  * Blocksizes are assumed to be large
  * */
 namespace stamina {
-	// Pool pointer is not within the util namespace
-	/* template <typename T, typename P = boost::object_pool<T>>
-	struct poolDeleter {
-
-	private:
-		P & pool;
-	}; */
 	namespace util {
 		template <typename StateType, typename ProbabilityStateType>
 		class StateIndexArray {
@@ -67,11 +74,79 @@ namespace stamina {
 			 * */
 			ProbabilityStateType * get(StateType index) const;
 			/**
-			 * Puts a ProbabilityState in at index and if needed, expands the array to accomodate
+			 * Copies a ProbabilityState in at index and if needed, expands the array to accomodate.
+			 * May be called by several threads at once for different indices.
+			 *
+			 * @param index The index to put the state at
+			 * @param probabilityState The state to copy in
+			 * @return A pointer to the state in the array
+			 * */
+			ProbabilityStateType * put(StateType index, ProbabilityStateType const & probabilityState);
+			/**
+			 * Sets whether a state in the array is terminal, keeping the terminal bitmap up to date.
+			 * May be called by several threads at once for different states.
+			 *
+			 * @param probabilityState A state in this array
+			 * @param terminal Whether the state is terminal
+			 * */
+			void setTerminal(ProbabilityStateType * probabilityState, bool terminal);
+			/**
+			 * Iterates over the terminal states in the array, in order of index, without allocating.
+			 * Must not be used while states are being put into the array.
+			 * */
+			class PerimeterIterator {
+			public:
+				PerimeterIterator(StateIndexArray const * array, uint64_t word)
+					: array(array)
+					, word(word)
+					, bits(0)
+				{
+					if (word < array->numberOfWords()) {
+						bits = array->terminalWord(word);
+						skipEmptyWords();
+					}
+				}
+				ProbabilityStateType * operator*() const {
+					uint64_t index = word * 64 + std::countr_zero(bits);
+					return &array->getBlock(index / array->blockSize)->states[index % array->blockSize];
+				}
+				PerimeterIterator & operator++() {
+					// Clear the lowest set bit
+					bits &= bits - 1;
+					skipEmptyWords();
+					return *this;
+				}
+				bool operator!=(PerimeterIterator const & other) const {
+					return word != other.word || bits != other.bits;
+				}
+			private:
+				void skipEmptyWords() {
+					uint64_t words = array->numberOfWords();
+					while (bits == 0 && ++word < words) {
+						bits = array->terminalWord(word);
+					}
+					if (bits == 0) {
+						word = words;
+					}
+				}
+				StateIndexArray const * array;
+				uint64_t word;
+				uint64_t bits;
+			};
+			/**
+			 * A range over the perimeter states, for use in range-based for loops
+			 * */
+			struct PerimeterRange {
+				PerimeterIterator begin() const { return PerimeterIterator(array, 0); }
+				PerimeterIterator end() const { return PerimeterIterator(array, array->numberOfWords()); }
+				StateIndexArray const * array;
+			};
+			/**
+			 * Gets all of the terminal states in the array without allocating
 			 *
-			 * @param probabilityState The state to emplace
+			 * @return A range of pointers to the perimeter states
 			 * */
-			void put(StateType index, ProbabilityStateType * probabilityState);
+			PerimeterRange perimeter() const { return PerimeterRange{this}; }
 			/**
 			 * Gets a vector of all of the terminal states in the stateIndexArray
 			 *
@@ -82,8 +157,38 @@ namespace stamina {
 			/**
 			 * Gets the actual number of terminal states in the map
 			 * */
-			uint32_t getNumberTerminal();
+			uint32_t getNumberTerminal() const;
+			/**
+			 * Gets the number of states in the map
+			 * */
+			uint32_t size() const;
 		protected:
+			/**
+			 * The states of one block, and its bitmaps
+			 * */
+			struct Block {
+				Block(uint32_t blockSize);
+				std::unique_ptr<ProbabilityStateType[]> states;
+				// One bit per index, set if a state has been put there
+				std::unique_ptr<uint64_t[]> present;
+				// One bit per index, set if the state there is terminal
+				std::unique_ptr<uint64_t[]> terminal;
+			};
+			/**
+			 * Gets a block, or nullptr if it does not exist yet
+			 * */
+			Block * getBlock(uint64_t blockIndex) const {
+				uint64_t segment = std::bit_width(blockIndex + 1) - 1;
+				std::atomic<Block *> * blocks = segments[segment].load(std::memory_order_acquire);
+				if (blocks == nullptr) {
+					return nullptr;
+				}
+				return blocks[blockIndex + 1 - (1ULL << segment)].load(std::memory_order_acquire);
+			}
+			/**
+			 * Gets a block, creating it (and the segment it is in) if it does not exist yet
+			 * */
+			Block * getOrCreateBlock(uint64_t blockIndex);
 			/**
 			 * Gets a size that is a multiple of blockSize
 			 *
@@ -91,10 +196,29 @@ namespace stamina {
 			 * @return The next size of a multiple of blockSize
 			 * */
 			uint32_t sizeToActualSize(uint32_t size);
+			/**
+			 * Makes sure that all blocks up to and including `blockIndex` exist
+			 * */
+			void addBlocks(uint64_t blockIndex);
+			/**
+			 * Gets the number of bitmap words over all blocks
+			 * */
+			uint64_t numberOfWords() const { return numberOfBlocks.load() * (blockSize / 64); }
+			/**
+			 * Gets a word of the terminal bitmap, counting words over all blocks
+			 * */
+			uint64_t terminalWord(uint64_t word) const {
+				uint64_t wordsPerBlock = blockSize / 64;
+				return getBlock(word / wordsPerBlock)->terminal[word % wordsPerBlock];
+			}
+			// Enough segments for every index a StateType can hold
+			constexpr static uint8_t MAX_SEGMENTS = 8 * sizeof(StateType);
 		private:
 			uint32_t numElements;
 			uint32_t blockSize;
-			std::vector<std::shared_ptr<ProbabilityStateType *>> stateArray;
+			// Blocks 0 to numberOfBlocks - 1 all exist
+			std::atomic<uint64_t> numberOfBlocks;
+			std::array<std::atomic<std::atomic<Block *> *>, MAX_SEGMENTS> segments;
 		};
 	}
 }
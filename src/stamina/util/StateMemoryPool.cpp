@@ -21,6 +21,10 @@
 #include "builder/StaminaModelBuilder.h"
 #include "core/StaminaMessages.h"
 
+#include <algorithm>
+#include <functional>
+#include <bit>
+
 /**
  * Implementation for StaminaMemoryPool methods
  *
@@ -33,48 +37,250 @@ namespace stamina {
 		StateMemoryPool<T>::StateMemoryPool(uint8_t blockSize)
 			: blockSize(2 << blockSize)
 			, usedThisBlock(0)
+			, hasRemoteFrees(false)
+			, liveElements(0)
+			, freeElements(0)
+			, reservedElements(0)
 		{
 			// Create the first block
-			blocks.push_back(new T[this->blockSize]);
+			addBlock(this->blockSize);
 		}
 
 		template <typename T>
 		StateMemoryPool<T>::~StateMemoryPool() {
-			// TODO: We get an error in freeAll()
-			// There would be a memory leak but this lasts until the end of program execution
-			// freeAll();
+			freeAll();
 		}
 
 		template <typename T>
 		void
 		StateMemoryPool<T>::freeAll() {
-			for (T * block : blocks) {
-				if (block) { delete block; }
+			for (Block & block : blocks) {
+				delete[] block.elements;
+			}
+			blocks.clear();
+			freeLists.clear();
+			{
+				std::lock_guard<std::mutex> guard(remoteFreesMutex);
+				remoteFrees.clear();
+				hasRemoteFrees = false;
 			}
+			usedThisBlock = 0;
+			liveElements = 0;
+			freeElements = 0;
+			reservedElements = 0;
 		}
 
 		template <typename T>
 		T *
 		StateMemoryPool<T>::allocate(uint32_t number) {
-			if (number > blockSize - usedThisBlock) {
-				// TODO: be smarter about this
-				StaminaMessages::error("Cannot allocate array of this size on current block!");
+			if (number == 0) {
+				StaminaMessages::error("Cannot allocate zero elements!");
 				return nullptr;
 			}
-			// We have enough memory in the current block to offer
-			T * addressToReturn = blocks[blocks.size() - 1] + usedThisBlock;
-			usedThisBlock += number;
-			// Create new block if necessary
-			if (usedThisBlock == blockSize) {
-				blocks.push_back(new T[blockSize]);
-				usedThisBlock = 0;
+			if (hasRemoteFrees.load(std::memory_order_acquire)) {
+				drainRemoteFrees();
+			}
+			if (blocks.empty()) {
+				// After freeAll()
+				addBlock(blockSize);
+			}
+			uint8_t sizeClass = StateMemoryPool<T>::sizeClass(number);
+			uint64_t classSize = 1ULL << sizeClass;
+			// Reuse freed memory first
+			if (sizeClass < freeLists.size() && !freeLists[sizeClass].empty()) {
+				T * addressToReturn = freeLists[sizeClass].back();
+				freeLists[sizeClass].pop_back();
+				freeElements -= classSize;
+				liveElements += classSize;
+				return addressToReturn;
 			}
+			if (classSize > blockSize) {
+				// Give this allocation a block of its own, but keep carving from the current block
+				Block block{new T[classSize], static_cast<uint32_t>(classSize)};
+				blocks.insert(blocks.end() - 1, block);
+				reservedElements += classSize;
+				liveElements += classSize;
+				return block.elements;
+			}
+			if (classSize > blockSize - usedThisBlock) {
+				// The rest of the current block stays usable through the free lists
+				pushFreeRun(blocks.back().elements + usedThisBlock, blockSize - usedThisBlock);
+				addBlock(blockSize);
+			}
+			T * addressToReturn = blocks.back().elements + usedThisBlock;
+			usedThisBlock += classSize;
+			liveElements += classSize;
 			return addressToReturn;
 		}
 
+		template <typename T>
+		void
+		StateMemoryPool<T>::free(T * address, uint32_t number) {
+			if (address == nullptr) {
+				return;
+			}
+			// Release what the elements own (e.g., the storage of a CompressedState), since only sizeof(T)
+			// per element is counted once it is on a free list
+			std::fill(address, address + number, T());
+			uint8_t sizeClass = StateMemoryPool<T>::sizeClass(number);
+			if (sizeClass >= freeLists.size()) {
+				freeLists.resize(sizeClass + 1);
+			}
+			freeLists[sizeClass].push_back(address);
+			liveElements -= 1ULL << sizeClass;
+			freeElements += 1ULL << sizeClass;
+		}
+
+		template <typename T>
+		void
+		StateMemoryPool<T>::freeRemote(T * address, uint32_t number) {
+			if (address == nullptr) {
+				return;
+			}
+			std::lock_guard<std::mutex> guard(remoteFreesMutex);
+			remoteFrees.emplace_back(address, number);
+			hasRemoteFrees.store(true, std::memory_order_release);
+		}
+
+		template <typename T>
+		void
+		StateMemoryPool<T>::drainRemoteFrees() {
+			std::vector<std::pair<T *, uint32_t>> drained;
+			{
+				std::lock_guard<std::mutex> guard(remoteFreesMutex);
+				drained.swap(remoteFrees);
+				hasRemoteFrees.store(false, std::memory_order_relaxed);
+			}
+			for (auto const & [address, number] : drained) {
+				free(address, number);
+			}
+		}
+
+		template <typename T>
+		void
+		StateMemoryPool<T>::defrag() {
+			drainRemoteFrees();
+			// Gather every free chunk in address order
+			std::vector<std::pair<T *, uint64_t>> chunks;
+			for (uint8_t sizeClass = 0; sizeClass < freeLists.size(); sizeClass++) {
+				for (T * address : freeLists[sizeClass]) {
+					chunks.emplace_back(address, 1ULL << sizeClass);
+				}
+				freeLists[sizeClass].clear();
+			}
+			freeElements = 0;
+			std::less<T *> before;
+			std::sort(chunks.begin(), chunks.end(), [&](auto const & a, auto const & b) { return before(a.first, b.first); });
+			std::vector<Block> keptBlocks;
+			for (uint32_t blockIndex = 0; blockIndex < blocks.size(); blockIndex++) {
+				Block & block = blocks[blockIndex];
+				bool isCurrent = blockIndex == blocks.size() - 1;
+				uint64_t usedInBlock = isCurrent ? usedThisBlock : block.size;
+				// The free chunks which lie in this block
+				auto first = std::lower_bound(chunks.begin(), chunks.end(), block.elements, [&](auto const & chunk, T * address) { return before(chunk.first, address); });
+				auto last = std::lower_bound(first, chunks.end(), block.elements + block.size, [&](auto const & chunk, T * address) { return before(chunk.first, address); });
+				uint64_t freeInBlock = 0;
+				for (auto chunk = first; chunk != last; ++chunk) {
+					freeInBlock += chunk->second;
+				}
+				if (freeInBlock == usedInBlock && !isCurrent) {
+					// Nothing in this block is live
+					delete[] block.elements;
+					reservedElements -= block.size;
+					continue;
+				}
+				// Merge adjacent chunks into runs
+				T * runStart = nullptr;
+				uint64_t runLength = 0;
+				for (auto chunk = first; chunk != last; ++chunk) {
+					if (runStart != nullptr && runStart + runLength == chunk->first) {
+						runLength += chunk->second;
+						continue;
+					}
+					if (runStart != nullptr) {
+						pushFreeRun(runStart, runLength);
+					}
+					runStart = chunk->first;
+					runLength = chunk->second;
+				}
+				if (runStart != nullptr) {
+					if (isCurrent && runStart + runLength == block.elements + usedThisBlock) {
+						// A free run at the end of the current block goes back to being carved from
+						usedThisBlock -= runLength;
+					}
+					else {
+						pushFreeRun(runStart, runLength);
+					}
+				}
+				keptBlocks.push_back(block);
+			}
+			blocks.swap(keptBlocks);
+		}
+
+		template <typename T>
+		void
+		StateMemoryPool<T>::pushFreeRun(T * address, uint64_t number) {
+			// Largest chunks first, so a merged run can serve large allocations
+			while (number > 0) {
+				uint8_t sizeClass = std::bit_width(number) - 1;
+				if (sizeClass >= freeLists.size()) {
+					freeLists.resize(sizeClass + 1);
+				}
+				freeLists[sizeClass].push_back(address);
+				freeElements += 1ULL << sizeClass;
+				address += 1ULL << sizeClass;
+				number -= 1ULL << sizeClass;
+			}
+		}
+
+		template <typename T>
+		void
+		StateMemoryPool<T>::addBlock(uint32_t size) {
+			blocks.push_back(Block{new T[size], size});
+			reservedElements += size;
+			usedThisBlock = 0;
+		}
+
+		template <typename T>
+		uint8_t
+		StateMemoryPool<T>::sizeClass(uint32_t number) {
+			return std::bit_width(number - 1);
+		}
+
+		template <typename T>
+		uint64_t
+		StateMemoryPool<T>::getLiveBytes() const {
+			return liveElements * sizeof(T);
+		}
+
+		template <typename T>
+		uint64_t
+		StateMemoryPool<T>::getReservedBytes() const {
+			return reservedElements * sizeof(T);
+		}
+
+		template <typename T>
+		uint64_t
+		StateMemoryPool<T>::getFreeBytes() const {
+			return freeElements * sizeof(T);
+		}
+
+		template <typename T>
+		double
+		StateMemoryPool<T>::getFragmentation() const {
+			uint64_t handedOut = liveElements + freeElements;
+			if (handedOut == 0) {
+				return 0.0;
+			}
+			return static_cast<double>(freeElements) / handedOut;
+		}
+
 		// Forward declare
 		template class StateMemoryPool<
 			builder::ProbabilityState<uint32_t>
 		>;
+		template class StateMemoryPool<
+			builder::ProbabilityStatePair<uint32_t>
+		>;
 	}
 }
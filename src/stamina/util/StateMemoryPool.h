@@ -20,10 +20,11 @@
 #ifndef STAMINA_UTIL_STATEMEMORYPOOL_H
 #define STAMINA_UTIL_STATEMEMORYPOOL_H
 
-// #include <deque>
-// #include <ordered_set>
 #include <cstdint>
 #include <vector>
+#include <mutex>
+#include <atomic>
+#include <utility>
 
 /**
  * Stamina Memory Pool allocator
@@ -34,10 +35,16 @@
  * call to malloc() -- invoked by new -- is a system call to ask for more memory)
  *
  * This memory pool makes a few assumptions to increase performance:
- *	1. All states are assumed to be in memory from allocation-time until the program. The STAMINA memory
- *	pool allows for dynamic deletion, but defragmentation must be explicitly invoked using the defrag()
- *	method and is not automatically called.
- *	2. For now, defrag() has not been implemented, requiring
+ *	1. The objects in the pool are constructed when their block is allocated and destructed when the
+ *	block is released, not on allocate(). Callers assign to the object they are given. free() resets
+ *	objects to T(), so memory on the free lists does not keep heap storage of its own (such as the bits
+ *	of a CompressedState) alive, which the byte counts below would not see.
+ *	2. Allocations are rounded up to a size class (a power of two number of elements), and freed
+ *	memory is kept on a free list per size class. Memory is only handed back to the system when
+ *	defrag() finds a block which is entirely free, or on freeAll().
+ *	3. A pool is an arena which belongs to one thread: only that thread may call allocate(), free()
+ *	and defrag(). Any other thread which ends up with memory from the pool returns it with
+ *	freeRemote(), which is picked up the next time the owner allocates.
  *
  * Future work:
  * 	1. Offload excess memory to a swapfile which is deleted on StateMemoryPool destruction
@@ -53,31 +60,95 @@ namespace stamina {
 			/**
 			 * Constructor. Creates the first block of the pool
 			 *
-			 * @param blockSize Exponent on 2 of
+			 * @param blockSize Exponent on 2 of half the number of elements per block
 			 * */
-			StateMemoryPool(uint8_t blockSize = 13); // 2 ^ 12
+			StateMemoryPool(uint8_t blockSize = 13); // 2 ^ 14
 			/**
 			 * Destructor. Frees all of the memory allocated by the memory pool
 			 * */
 			~StateMemoryPool();
 			/**
-			 * Allocates a T value and returns a pointer to it
+			 * Allocates a T value (or a contiguous array of them) and returns a pointer to it. Allocations
+			 * larger than a block get a block of their own.
+			 *
+			 * @param number The number of contiguous elements
+			 * @return A pointer to the first element
 			 * */
 			T * allocate(uint32_t number = 1);
 			/**
-			 * Clears all memory
+			 * Returns memory from allocate() to the pool, resetting the elements to T(). Owner thread only.
+			 *
+			 * @param address The address returned by allocate()
+			 * @param number The number of elements passed to allocate()
+			 * */
+			void free(T * address, uint32_t number = 1);
+			/**
+			 * Returns memory from allocate() to the pool from a thread which does not own the pool.
+			 * May be called by any thread.
+			 *
+			 * @param address The address returned by allocate()
+			 * @param number The number of elements passed to allocate()
+			 * */
+			void freeRemote(T * address, uint32_t number = 1);
+			/**
+			 * Releases blocks which are entirely free back to the system and merges adjacent free
+			 * memory into larger size classes. Live memory never moves, so pointers stay valid.
+			 * */
+			void defrag();
+			/**
+			 * Clears all memory. Every pointer handed out by this pool becomes invalid.
 			 * */
 			void freeAll();
-			// Methods that will be implemented when defragmentation is added
-			// void free(T * address); // knows the number used
-			// void defrag();
+			/**
+			 * Gets the number of bytes currently handed out
+			 * */
+			uint64_t getLiveBytes() const;
+			/**
+			 * Gets the number of bytes held in blocks, whether handed out, free or not yet used
+			 * */
+			uint64_t getReservedBytes() const;
+			/**
+			 * Gets the number of bytes on the free lists
+			 * */
+			uint64_t getFreeBytes() const;
+			/**
+			 * Gets the fraction of the memory handed out from blocks which sits on the free lists
+			 * */
+			double getFragmentation() const;
+		protected:
+			/**
+			 * Gets the size class of an allocation (the exponent of the next power of two)
+			 * */
+			static uint8_t sizeClass(uint32_t number);
+			/**
+			 * Allocates a new block and makes it the current block
+			 * */
+			void addBlock(uint32_t size);
+			/**
+			 * Splits a free run of elements into power-of-two chunks on the free lists
+			 * */
+			void pushFreeRun(T * address, uint64_t number);
+			/**
+			 * Moves memory freed by other threads onto the free lists
+			 * */
+			void drainRemoteFrees();
 		private:
+			struct Block {
+				T * elements;
+				uint32_t size;
+			};
 			const uint32_t blockSize;
 			uint32_t usedThisBlock;
-			std::vector<T *> blocks;
-			// Will be used when defragmentation is implemented
-			// std::deque<std::pair<T*, uint32_t>> deletedBlocks; // Blocks which have been deleted
-			// std::ordered_set<std::pair<T*, uint32_t>> nonSingleBlocks; // Blocks of arrays
+			// The last block is the current one, which allocations are carved from
+			std::vector<Block> blocks;
+			// One list of free chunks per size class
+			std::vector<std::vector<T *>> freeLists;
+			std::mutex remoteFreesMutex;
+			std::vector<std::pair<T *, uint32_t>> remoteFrees;
+			std::atomic<bool> hasRemoteFrees;
+			uint64_t liveElements;
+			uint64_t freeElements;
+			uint64_t reservedElements;
 		};
 	}
 }
@@ -0,0 +1,227 @@
+/**
+ * STAMINA - the [ST]ochasic [A]pproximate [M]odel-checker for [IN]finite-state [A]nalysis
+ * Copyright (C) 2023 Fluent Verification, Utah State University
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see https://www.gnu.org/licenses/.
+ *
+ **/
+
+#include "SuccessorCache.h"
+
+namespace stamina {
+namespace util {
+
+template <typename ValueType, typename StateType>
+SuccessorCache<ValueType, StateType>::SuccessorCache(uint64_t capacity)
+	: capacity(capacity)
+	, size(0)
+	, hits(0)
+	, misses(0)
+	, evictions(0)
+{
+	// Intentionally left empty
+}
+
+template <typename ValueType, typename StateType>
+bool
+SuccessorCache<ValueType, StateType>::replay(
+	StateType stateIndex
+	, StateToIdCallback const & stateToIdCallback
+	, StateBehavior & behavior
+	, bool keep
+) {
+	if (capacity == 0) {
+		return false;
+	}
+	std::shared_ptr<Successors const> successors;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto entry = entries.find(stateIndex);
+		if (entry == entries.end()) {
+			++misses;
+			return false;
+		}
+		++hits;
+		successors = entry->second.successors;
+		if (keep) {
+			recencyList.splice(recencyList.begin(), recencyList, entry->second.recency);
+		}
+		else {
+			size -= entry->second.bytes;
+			recencyList.erase(entry->second.recency);
+			entries.erase(entry);
+		}
+	}
+	// The callback may be slow (or take locks of its own), so it is called without holding ours
+	behavior = StateBehavior();
+	if (!successors->stateRewards.empty()) {
+		auto stateRewards = successors->stateRewards;
+		behavior.addStateRewards(std::move(stateRewards));
+	}
+	behavior.setExpanded();
+	if (!successors->hasChoice) {
+		return true;
+	}
+	storm::generator::Choice<ValueType, StateType> choice(successors->actionIndex, successors->markovian);
+	for (auto const & [successor, rate] : successors->successors) {
+		choice.addProbability(stateToIdCallback(successor), rate);
+	}
+	behavior.addChoice(std::move(choice));
+	return true;
+}
+
+template <typename ValueType, typename StateType>
+typename SuccessorCache<ValueType, StateType>::StateBehavior
+SuccessorCache<ValueType, StateType>::record(
+	storm::generator::PrismNextStateGenerator<ValueType, StateType> & generator
+	, StateType stateIndex
+	, StateToIdCallback const & stateToIdCallback
+) {
+	return record(
+		[&](StateToIdCallback const & callback) {
+			return generator.expand(callback);
+		}
+		, stateIndex
+		, stateToIdCallback
+	);
+}
+
+template <typename ValueType, typename StateType>
+typename SuccessorCache<ValueType, StateType>::StateBehavior
+SuccessorCache<ValueType, StateType>::record(
+	ExpandFunction const & expand
+	, StateType stateIndex
+	, StateToIdCallback const & stateToIdCallback
+) {
+	// The generator calls the callback once per update, so giving each call its own (local) index
+	// keeps every successor apart in the behavior, even ones which the real callback maps to the
+	// same index (such as the absorbing state)
+	std::vector<std::pair<CompressedState, StateType>> visited;
+	StateBehavior behavior = expand(
+		[&](CompressedState const & successor) {
+			visited.emplace_back(successor, stateToIdCallback(successor));
+			return static_cast<StateType>(visited.size() - 1);
+		}
+	);
+	StateBehavior remapped;
+	if (!behavior.getStateRewards().empty()) {
+		auto stateRewards = behavior.getStateRewards();
+		remapped.addStateRewards(std::move(stateRewards));
+	}
+	remapped.setExpanded();
+	// Only single-choice behaviors (which is all of them in a CTMC) can be replayed
+	bool cacheable = capacity != 0 && behavior.getNumberOfChoices() <= 1;
+	auto successors = std::make_shared<Successors>();
+	successors->stateRewards = behavior.getStateRewards();
+	successors->hasChoice = false;
+	uint64_t bytes = sizeof(Entry) + sizeof(Successors) + sizeof(ValueType) * successors->stateRewards.size();
+	for (auto const & choice : behavior) {
+		storm::generator::Choice<ValueType, StateType> remappedChoice(choice.getActionIndex(), choice.isMarkovian());
+		successors->hasChoice = true;
+		successors->actionIndex = choice.getActionIndex();
+		successors->markovian = choice.isMarkovian();
+		for (auto const & [localIndex, rate] : choice) {
+			remappedChoice.addProbability(visited[localIndex].second, rate);
+			if (cacheable) {
+				bytes += sizeof(std::pair<CompressedState, ValueType>) + (visited[localIndex].first.size() + 63) / 64 * sizeof(uint64_t);
+				successors->successors.emplace_back(std::move(visited[localIndex].first), rate);
+			}
+		}
+		remapped.addChoice(std::move(remappedChoice));
+	}
+	if (!cacheable || bytes > capacity) {
+		return remapped;
+	}
+	std::lock_guard<std::mutex> lock(mutex);
+	auto existing = entries.find(stateIndex);
+	if (existing != entries.end()) {
+		size -= existing->second.bytes;
+		recencyList.erase(existing->second.recency);
+		entries.erase(existing);
+	}
+	recencyList.push_front(stateIndex);
+	entries.emplace(stateIndex, Entry{std::move(successors), bytes, recencyList.begin()});
+	size += bytes;
+	evict();
+	return remapped;
+}
+
+template <typename ValueType, typename StateType>
+void
+SuccessorCache<ValueType, StateType>::setCapacity(uint64_t capacity) {
+	std::lock_guard<std::mutex> lock(mutex);
+	this->capacity = capacity;
+	evict();
+}
+
+template <typename ValueType, typename StateType>
+void
+SuccessorCache<ValueType, StateType>::clear() {
+	std::lock_guard<std::mutex> lock(mutex);
+	entries.clear();
+	recencyList.clear();
+	size = 0;
+}
+
+template <typename ValueType, typename StateType>
+bool
+SuccessorCache<ValueType, StateType>::isEnabled() const {
+	return capacity != 0;
+}
+
+template <typename ValueType, typename StateType>
+uint64_t
+SuccessorCache<ValueType, StateType>::getNumberOfHits() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return hits;
+}
+
+template <typename ValueType, typename StateType>
+uint64_t
+SuccessorCache<ValueType, StateType>::getNumberOfMisses() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return misses;
+}
+
+template <typename ValueType, typename StateType>
+uint64_t
+SuccessorCache<ValueType, StateType>::getNumberOfEvictions() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return evictions;
+}
+
+template <typename ValueType, typename StateType>
+uint64_t
+SuccessorCache<ValueType, StateType>::getSize() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return size;
+}
+
+template <typename ValueType, typename StateType>
+void
+SuccessorCache<ValueType, StateType>::evict() {
+	while (size > capacity && !recencyList.empty()) {
+		auto entry = entries.find(recencyList.back());
+		size -= entry->second.bytes;
+		entries.erase(entry);
+		recencyList.pop_back();
+		++evictions;
+	}
+}
+
+// Explicitly instantiate
+template class SuccessorCache<double, uint32_t>;
+
+} // namespace util
+} // namespace stamina
@@ -0,0 +1,163 @@
+/**
+ * STAMINA - the [ST]ochasic [A]pproximate [M]odel-checker for [IN]finite-state [A]nalysis
+ * Copyright (C) 2023 Fluent Verification, Utah State University
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see https://www.gnu.org/licenses/.
+ *
+ **/
+
+#ifndef STAMINA_UTIL_SUCCESSORCACHE_H
+#define STAMINA_UTIL_SUCCESSORCACHE_H
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+
+#include <storm/generator/CompressedState.h>
+#include <storm/generator/StateBehavior.h>
+#include <storm/generator/PrismNextStateGenerator.h>
+
+/**
+ * A bounded cache of the successors of perimeter states. A perimeter state is expanded when it is
+ * connected to the absorbing state at the end of one refinement iteration, and again when it is
+ * explored in the next. This keeps the (successor, rate) list from the first expansion so that the
+ * second (and any further perimeter connections) do not have to go through the generator again.
+ *
+ * Successors are kept as CompressedStates rather than indices, because a successor of a perimeter
+ * state may not have an index yet. They are given to the caller's stateToIdCallback in the same order
+ * as the generator would, so callbacks with side effects (such as enqueueing) behave the same on a hit.
+ *
+ * The cache evicts the least recently used entry once it holds more than its capacity in bytes. All
+ * methods are thread-safe.
+ * */
+namespace stamina {
+	namespace util {
+		template <typename ValueType, typename StateType>
+		class SuccessorCache {
+		public:
+			typedef storm::generator::CompressedState CompressedState;
+			typedef storm::generator::StateBehavior<ValueType, StateType> StateBehavior;
+			typedef std::function<StateType (CompressedState const &)> StateToIdCallback;
+			typedef std::function<StateBehavior (StateToIdCallback const &)> ExpandFunction;
+			/**
+			 * Constructs a SuccessorCache
+			 *
+			 * @param capacity The most bytes the cached successors may take up. 0 disables the cache.
+			 * */
+			SuccessorCache(uint64_t capacity = 64 * 1024 * 1024);
+			/**
+			 * Rebuilds the behavior of a state from the cache, if it is there.
+			 *
+			 * @param stateIndex The state
+			 * @param stateToIdCallback Called on each successor, in order
+			 * @param behavior Set to the behavior of the state on a hit
+			 * @param keep Whether to keep the entry. States which will not be expanded again (e.g., because
+			 * they are being explored and will no longer be on the perimeter) should not be kept.
+			 * @return Whether the state was in the cache
+			 * */
+			bool replay(
+				StateType stateIndex
+				, StateToIdCallback const & stateToIdCallback
+				, StateBehavior & behavior
+				, bool keep
+			);
+			/**
+			 * Expands the state currently loaded in a generator and caches its successors. The behavior
+			 * returned is the same as if `generator.expand(stateToIdCallback)` had been called.
+			 *
+			 * @param generator The generator, with the state already loaded
+			 * @param stateIndex The index of the loaded state
+			 * @param stateToIdCallback Called on each successor, in order
+			 * @return The behavior of the state
+			 * */
+			StateBehavior record(
+				storm::generator::PrismNextStateGenerator<ValueType, StateType> & generator
+				, StateType stateIndex
+				, StateToIdCallback const & stateToIdCallback
+			);
+			/**
+			 * Like record() above, but expands the state by calling `expand` with a callback, for generators
+			 * which take the state directly rather than having it loaded.
+			 *
+			 * @param expand Expands the state, calling the callback given to it on each successor
+			 * @param stateIndex The index of the state
+			 * @param stateToIdCallback Called on each successor, in order
+			 * @return The behavior of the state
+			 * */
+			StateBehavior record(
+				ExpandFunction const & expand
+				, StateType stateIndex
+				, StateToIdCallback const & stateToIdCallback
+			);
+			/**
+			 * Changes the capacity, evicting entries if needed
+			 *
+			 * @param capacity The most bytes the cached successors may take up. 0 disables the cache.
+			 * */
+			void setCapacity(uint64_t capacity);
+			/**
+			 * Removes all entries. Keeps the hit and miss counts.
+			 * */
+			void clear();
+			bool isEnabled() const;
+			uint64_t getNumberOfHits() const;
+			uint64_t getNumberOfMisses() const;
+			uint64_t getNumberOfEvictions() const;
+			/**
+			 * Gets the (estimated) number of bytes the cached successors take up
+			 * */
+			uint64_t getSize() const;
+		protected:
+			/**
+			 * The successors of one state, with the state rewards from its behavior
+			 * */
+			struct Successors {
+				std::vector<std::pair<CompressedState, ValueType>> successors;
+				std::vector<ValueType> stateRewards;
+				// The (only) choice of the state, if it had one
+				bool hasChoice;
+				uint_fast64_t actionIndex;
+				bool markovian;
+			};
+			struct Entry {
+				// Shared so that it can be replayed without holding the lock
+				std::shared_ptr<Successors const> successors;
+				uint64_t bytes;
+				// Position in the recency list
+				typename std::list<StateType>::iterator recency;
+			};
+			/**
+			 * Evicts least recently used entries until the cache fits in its capacity. Must hold `mutex`.
+			 * */
+			void evict();
+		private:
+			uint64_t capacity;
+			uint64_t size;
+			uint64_t hits;
+			uint64_t misses;
+			uint64_t evictions;
+			std::unordered_map<StateType, Entry> entries;
+			// Most recently used at the front
+			std::list<StateType> recencyList;
+			mutable std::mutex mutex;
+		};
+	}
+}
+
+#endif // STAMINA_UTIL_SUCCESSORCACHE_H
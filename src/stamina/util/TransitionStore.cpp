@@ -0,0 +1,237 @@
+/**
+ * STAMINA - the [ST]ochasic [A]pproximate [M]odel-checker for [IN]finite-state [A]nalysis
+ * Copyright (C) 2023 Fluent Verification, Utah State University
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see https://www.gnu.org/licenses/.
+ *
+ **/
+
+#include "TransitionStore.h"
+
+#include <cstring>
+
+namespace stamina {
+namespace util {
+
+template <typename ValueType, typename StateType>
+TransitionStore<ValueType, StateType>::TransitionStore(uint8_t chunkExponent)
+	: chunkExponent(chunkExponent)
+	, chunkMask((1ULL << chunkExponent) - 1)
+	, tail(0)
+	, removedEntries(0)
+{
+	// Intentionally left empty
+}
+
+template <typename ValueType, typename StateType>
+void
+TransitionStore<ValueType, StateType>::addRows(uint64_t numberOfRows) {
+	if (rows.size() < numberOfRows) {
+		// Grow geometrically since rows are usually added one state at a time
+		rows.reserve(std::max(numberOfRows, static_cast<uint64_t>(rows.size()) * 2));
+		rows.resize(numberOfRows, Segment{tail, 0, 0});
+	}
+}
+
+template <typename ValueType, typename StateType>
+void
+TransitionStore<ValueType, StateType>::append(StateType row, StateType to, ValueType rate) {
+	Segment * segment = &lastSegment(row);
+	uint64_t position = reserveEntry();
+	*entryAt(position) = Entry{to, rate};
+	if (segment->length == 0) {
+		segment->start = position;
+		segment->length = 1;
+	}
+	else if (segment->start + segment->length == position) {
+		++segment->length;
+	}
+	else {
+		// Some other row was written since this row was last appended to. `segment` may point
+		// into `overflow`, so it must be linked before the vector can grow.
+		segment->next = overflow.size() + 1;
+		overflow.push_back(Segment{position, 1, 0});
+	}
+}
+
+template <typename ValueType, typename StateType>
+void
+TransitionStore<ValueType, StateType>::append(StateType row, std::vector<TransitionInfo> const & transitions) {
+	if (transitions.empty()) {
+		return;
+	}
+	append(row, transitions.front().to, transitions.front().transition);
+	// The rest of the batch always extends the segment the first entry went into
+	Segment & segment = lastSegment(row);
+	for (auto it = transitions.begin() + 1; it != transitions.end(); ++it) {
+		*entryAt(reserveEntry()) = Entry{it->to, it->transition};
+		++segment.length;
+	}
+}
+
+template <typename ValueType, typename StateType>
+typename TransitionStore<ValueType, StateType>::Entry const *
+TransitionStore<ValueType, StateType>::back(StateType row) const {
+	Segment const * segment = &rows[row];
+	while (segment->next != 0) {
+		segment = &overflow[segment->next - 1];
+	}
+	if (segment->length == 0) {
+		return nullptr;
+	}
+	return entryAt(segment->start + segment->length - 1);
+}
+
+template <typename ValueType, typename StateType>
+uint64_t
+TransitionStore<ValueType, StateType>::removeTransitionsTo(StateType row, StateType to) {
+	uint64_t removed = 0;
+	Segment * segment = &rows[row];
+	while (true) {
+		uint64_t kept = 0;
+		for (uint64_t i = 0; i < segment->length; ++i) {
+			Entry * entry = entryAt(segment->start + i);
+			if (entry->to == to) {
+				continue;
+			}
+			if (kept != i) {
+				*entryAt(segment->start + kept) = *entry;
+			}
+			++kept;
+		}
+		removed += segment->length - kept;
+		segment->length = kept;
+		if (segment->next == 0) {
+			break;
+		}
+		segment = &overflow[segment->next - 1];
+	}
+	removedEntries += removed;
+	return removed;
+}
+
+template <typename ValueType, typename StateType>
+void
+TransitionStore<ValueType, StateType>::compact() {
+	std::vector<std::unique_ptr<Entry[]>> oldChunks = std::move(chunks);
+	std::vector<Segment> oldOverflow = std::move(overflow);
+	chunks.clear();
+	overflow.clear();
+	tail = 0;
+	// reserveEntry() works on the new chunks, so we read from the old ones by hand
+	auto oldEntryAt = [&](uint64_t position) {
+		return &oldChunks[position >> chunkExponent][position & chunkMask];
+	};
+	for (auto & row : rows) {
+		uint64_t newStart = tail;
+		Segment const * segment = &row;
+		while (true) {
+			for (uint64_t i = 0; i < segment->length; ++i) {
+				*entryAt(reserveEntry()) = *oldEntryAt(segment->start + i);
+			}
+			if (segment->next == 0) {
+				break;
+			}
+			segment = &oldOverflow[segment->next - 1];
+		}
+		row = Segment{newStart, static_cast<uint32_t>(tail - newStart), 0};
+	}
+	removedEntries = 0;
+}
+
+template <typename ValueType, typename StateType>
+bool
+TransitionStore<ValueType, StateType>::compactIfFragmented() {
+	if (overflow.size() > rows.size() / 4 || removedEntries > tail / 4) {
+		compact();
+		return true;
+	}
+	return false;
+}
+
+template <typename ValueType, typename StateType>
+void
+TransitionStore<ValueType, StateType>::clear() {
+	chunks.clear();
+	rows.clear();
+	overflow.clear();
+	tail = 0;
+	removedEntries = 0;
+}
+
+template <typename ValueType, typename StateType>
+uint64_t
+TransitionStore<ValueType, StateType>::getRowCount() const {
+	return rows.size();
+}
+
+template <typename ValueType, typename StateType>
+uint64_t
+TransitionStore<ValueType, StateType>::getRowEntryCount(StateType row) const {
+	if (row >= rows.size()) {
+		return 0;
+	}
+	uint64_t count = 0;
+	Segment const * segment = &rows[row];
+	while (true) {
+		count += segment->length;
+		if (segment->next == 0) {
+			return count;
+		}
+		segment = &overflow[segment->next - 1];
+	}
+}
+
+template <typename ValueType, typename StateType>
+uint64_t
+TransitionStore<ValueType, StateType>::getEntryCount() const {
+	return tail - removedEntries;
+}
+
+template <typename ValueType, typename StateType>
+uint64_t
+TransitionStore<ValueType, StateType>::getNumberOfOverflowSegments() const {
+	return overflow.size();
+}
+
+template <typename ValueType, typename StateType>
+uint64_t
+TransitionStore<ValueType, StateType>::getReservedBytes() const {
+	return chunks.size() * (chunkMask + 1) * sizeof(Entry);
+}
+
+template <typename ValueType, typename StateType>
+typename TransitionStore<ValueType, StateType>::Segment &
+TransitionStore<ValueType, StateType>::lastSegment(StateType row) {
+	Segment * segment = &rows[row];
+	while (segment->next != 0) {
+		segment = &overflow[segment->next - 1];
+	}
+	return *segment;
+}
+
+template <typename ValueType, typename StateType>
+uint64_t
+TransitionStore<ValueType, StateType>::reserveEntry() {
+	if ((tail >> chunkExponent) >= chunks.size()) {
+		chunks.emplace_back(new Entry[chunkMask + 1]);
+	}
+	return tail++;
+}
+
+// Explicitly instantiate
+template class TransitionStore<double, uint32_t>;
+
+} // namespace util
+} // namespace stamina
@@ -0,0 +1,221 @@
+/**
+ * STAMINA - the [ST]ochasic [A]pproximate [M]odel-checker for [IN]finite-state [A]nalysis
+ * Copyright (C) 2023 Fluent Verification, Utah State University
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see https://www.gnu.org/licenses/.
+ *
+ **/
+
+#ifndef STAMINA_UTIL_TRANSITIONSTORE_H
+#define STAMINA_UTIL_TRANSITIONSTORE_H
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <algorithm>
+
+#include "builder/StateAndTransitions.h"
+
+/**
+ * An append-only, CSR-like store for the transitions created while exploring. Rather than keeping a
+ * vector of transitions for every state (each with its own allocation, capacity slack and a redundant
+ * `from` field), the (to, rate) pairs of all rows are packed into large fixed-size chunks, and each row
+ * only records where its entries start and how many there are.
+ *
+ * Transitions are almost always created one row at a time, so a row's entries are usually contiguous.
+ * When a row receives more transitions after some other row was written (for example, a perimeter state
+ * explored again in a later iteration), the new entries are placed at the end of the store in an overflow
+ * segment which is chained onto that row. compact() rewrites the store in row order to remove the chains.
+ * */
+namespace stamina {
+	namespace util {
+		template <typename ValueType, typename StateType>
+		class TransitionStore {
+		public:
+			typedef builder::StaminaTransitionInfo<StateType> TransitionInfo;
+#pragma pack(push, 4)
+			/**
+			 * A single transition out of a row. Packed so that a uint32_t state and a double
+			 * rate take 12 bytes, which means `rate` may be misaligned: copy it rather than
+			 * binding a reference to it.
+			 * */
+			struct Entry {
+				StateType to;
+				ValueType rate;
+			};
+#pragma pack(pop)
+			TransitionStore(uint8_t chunkExponent = 16); // 2 ^ 16 entries per chunk
+			/**
+			 * Makes sure there are at least `numberOfRows` rows. New rows are empty.
+			 *
+			 * @param numberOfRows The number of rows needed
+			 * */
+			void addRows(uint64_t numberOfRows);
+			/**
+			 * Appends a transition to a row. The row must already exist.
+			 *
+			 * @param row The row (state the transition goes out of)
+			 * @param to The state the transition goes into
+			 * @param rate The rate of the transition
+			 * */
+			void append(StateType row, StateType to, ValueType rate);
+			/**
+			 * Appends a batch of transitions to a row. The row must already exist, and the `from` field of
+			 * each transition is ignored.
+			 *
+			 * @param row The row (state the transitions go out of)
+			 * @param transitions The transitions
+			 * */
+			void append(StateType row, std::vector<TransitionInfo> const & transitions);
+			/**
+			 * Gets the most recently appended entry of a row, if its newest segment is not empty.
+			 *
+			 * @param row The row
+			 * @return The last entry, or nullptr
+			 * */
+			Entry const * back(StateType row) const;
+			/**
+			 * Removes all entries in a row which go into a certain state. Entries are removed in place, so the
+			 * space they took up is not reclaimed until compact().
+			 *
+			 * @param row The row
+			 * @param to The state to remove transitions into
+			 * @return The number of entries removed
+			 * */
+			uint64_t removeTransitionsTo(StateType row, StateType to);
+			/**
+			 * Calls `function(Entry * begin, Entry * end)` for each contiguous run of entries in a row, in the
+			 * order in which they were appended.
+			 * */
+			template <typename Function>
+			void forEachRun(StateType row, Function && function) {
+				forEachRunIn(*this, row, function);
+			}
+			template <typename Function>
+			void forEachRun(StateType row, Function && function) const {
+				forEachRunIn(*this, row, function);
+			}
+			/**
+			 * Calls `function(Entry &)` for each entry in a row, in the order in which they were appended.
+			 * */
+			template <typename Function>
+			void forEachTransition(StateType row, Function && function) {
+				forEachRun(row, [&](Entry * begin, Entry * end) {
+					for (Entry * entry = begin; entry != end; ++entry) {
+						function(*entry);
+					}
+				});
+			}
+			template <typename Function>
+			void forEachTransition(StateType row, Function && function) const {
+				forEachRun(row, [&](Entry const * begin, Entry const * end) {
+					for (Entry const * entry = begin; entry != end; ++entry) {
+						function(*entry);
+					}
+				});
+			}
+			/**
+			 * Rewrites all entries in row order, so that each row is a single contiguous run again
+			 * and space taken up by removed entries is freed.
+			 * */
+			void compact();
+			/**
+			 * Compacts only if many rows have overflow segments or many entries have been removed
+			 *
+			 * @return Whether the store was compacted
+			 * */
+			bool compactIfFragmented();
+			/**
+			 * Removes all rows and entries and frees all chunks
+			 * */
+			void clear();
+			uint64_t getRowCount() const;
+			/**
+			 * Gets the number of entries in a row
+			 * */
+			uint64_t getRowEntryCount(StateType row) const;
+			/**
+			 * Gets the number of entries in all rows
+			 * */
+			uint64_t getEntryCount() const;
+			/**
+			 * Gets the number of overflow segments chained onto rows
+			 * */
+			uint64_t getNumberOfOverflowSegments() const;
+			/**
+			 * Gets the number of bytes allocated for entries (not including row headers)
+			 * */
+			uint64_t getReservedBytes() const;
+		protected:
+			/**
+			 * A contiguous run of entries. `next` is one more than the index of the next segment of the same
+			 * row in `overflow`, or 0 if this is the last segment of the row.
+			 * */
+			struct Segment {
+				uint64_t start;
+				uint32_t length;
+				uint32_t next;
+			};
+			/**
+			 * Gets the entry at a position in the store
+			 * */
+			Entry * entryAt(uint64_t position) const {
+				return &chunks[position >> chunkExponent][position & chunkMask];
+			}
+			/**
+			 * Gets the newest segment of a row
+			 * */
+			Segment & lastSegment(StateType row);
+			/**
+			 * Reserves an entry at the tail of the store, allocating a new chunk if needed
+			 *
+			 * @return The position of the entry
+			 * */
+			uint64_t reserveEntry();
+			template <typename Store, typename Function>
+			static void forEachRunIn(Store & store, StateType row, Function & function) {
+				Segment const * segment = &store.rows[row];
+				while (true) {
+					uint64_t position = segment->start;
+					uint64_t end = segment->start + segment->length;
+					while (position < end) {
+						// A segment may cross the end of a chunk
+						uint64_t chunkEnd = ((position >> store.chunkExponent) + 1) << store.chunkExponent;
+						uint64_t runEnd = std::min(end, chunkEnd);
+						auto begin = store.entryAt(position);
+						function(begin, begin + (runEnd - position));
+						position = runEnd;
+					}
+					if (segment->next == 0) {
+						break;
+					}
+					segment = &store.overflow[segment->next - 1];
+				}
+			}
+		private:
+			const uint8_t chunkExponent;
+			const uint64_t chunkMask;
+			std::vector<std::unique_ptr<Entry[]>> chunks;
+			// The first segment of each row
+			std::vector<Segment> rows;
+			// Segments of rows which received entries out of order
+			std::vector<Segment> overflow;
+			// One past the last entry written
+			uint64_t tail;
+			uint64_t removedEntries;
+		};
+	}
+}
+
+#endif // STAMINA_UTIL_TRANSITIONSTORE_H
@@ -0,0 +1,126 @@
+/**
+ * STAMINA - the [ST]ochasic [A]pproximate [M]odel-checker for [IN]finite-state [A]nalysis
+ * Copyright (C) 2023 Fluent Verification, Utah State University
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see https://www.gnu.org/licenses/.
+ *
+ **/
+
+#include "WorkStealingDeque.h"
+
+#include "builder/ProbabilityState.h"
+
+namespace stamina {
+namespace util {
+
+template <typename T>
+WorkStealingDeque<T>::Buffer::Buffer(int64_t capacity)
+	: capacity(capacity)
+	, mask(capacity - 1)
+	, elements(new std::atomic<T>[capacity])
+{
+	// Intentionally left empty
+}
+
+template <typename T>
+WorkStealingDeque<T>::WorkStealingDeque(uint8_t capacityExponent)
+	: top(0)
+	, bottom(0)
+{
+	buffers.emplace_back(new Buffer(int64_t(1) << capacityExponent));
+	buffer.store(buffers.back().get());
+}
+
+template <typename T>
+void
+WorkStealingDeque<T>::push(T element) {
+	int64_t b = bottom.load(std::memory_order_relaxed);
+	int64_t t = top.load(std::memory_order_acquire);
+	Buffer * a = buffer.load(std::memory_order_relaxed);
+	if (b - t > a->capacity - 1) {
+		a = grow(a, b, t);
+	}
+	a->put(b, element);
+	std::atomic_thread_fence(std::memory_order_release);
+	bottom.store(b + 1, std::memory_order_relaxed);
+}
+
+template <typename T>
+bool
+WorkStealingDeque<T>::take(T & element) {
+	int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+	Buffer * a = buffer.load(std::memory_order_relaxed);
+	bottom.store(b, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t t = top.load(std::memory_order_relaxed);
+	if (t > b) {
+		// Deque was already empty
+		bottom.store(b + 1, std::memory_order_relaxed);
+		return false;
+	}
+	element = a->get(b);
+	if (t == b) {
+		// Last element: race against thieves for it
+		bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+		bottom.store(b + 1, std::memory_order_relaxed);
+		return won;
+	}
+	return true;
+}
+
+template <typename T>
+bool
+WorkStealingDeque<T>::steal(T & element) {
+	int64_t t = top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t b = bottom.load(std::memory_order_acquire);
+	if (t >= b) {
+		return false;
+	}
+	Buffer * a = buffer.load(std::memory_order_acquire);
+	element = a->get(t);
+	return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+}
+
+template <typename T>
+bool
+WorkStealingDeque<T>::empty() const {
+	return size() <= 0;
+}
+
+template <typename T>
+int64_t
+WorkStealingDeque<T>::size() const {
+	int64_t b = bottom.load(std::memory_order_relaxed);
+	int64_t t = top.load(std::memory_order_relaxed);
+	return b - t;
+}
+
+template <typename T>
+typename WorkStealingDeque<T>::Buffer *
+WorkStealingDeque<T>::grow(Buffer * a, int64_t b, int64_t t) {
+	Buffer * newBuffer = new Buffer(a->capacity * 2);
+	for (int64_t i = t; i < b; ++i) {
+		newBuffer->put(i, a->get(i));
+	}
+	buffers.emplace_back(newBuffer);
+	buffer.store(newBuffer, std::memory_order_release);
+	return newBuffer;
+}
+
+// Explicitly instantiate
+template class WorkStealingDeque<builder::ProbabilityStatePair<uint32_t> *>;
+
+} // namespace util
+} // namespace stamina
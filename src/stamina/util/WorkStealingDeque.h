@@ -0,0 +1,99 @@
+/**
+ * STAMINA - the [ST]ochasic [A]pproximate [M]odel-checker for [IN]finite-state [A]nalysis
+ * Copyright (C) 2023 Fluent Verification, Utah State University
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see https://www.gnu.org/licenses/.
+ *
+ **/
+
+#ifndef STAMINA_UTIL_WORKSTEALINGDEQUE_H
+#define STAMINA_UTIL_WORKSTEALINGDEQUE_H
+
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+/**
+ * A Chase-Lev work-stealing deque (using the memory orderings from Le, Pop, Cohen and Zappa Nardelli,
+ * "Correct and Efficient Work-Stealing for Weak Memory Models", PPoPP 2013).
+ *
+ * Exactly one thread (the owner) may call push() and take(), which work on the bottom of the deque.
+ * Any number of other threads may call steal(), which takes from the top. The buffer grows when full;
+ * old buffers are kept until the deque is destroyed since a thief may still be reading from them.
+ *
+ * T should be a pointer or another small trivially copyable type.
+ * */
+namespace stamina {
+	namespace util {
+		template <typename T>
+		class WorkStealingDeque {
+		public:
+			WorkStealingDeque(uint8_t capacityExponent = 10); // 2 ^ 10
+			/**
+			 * Pushes an element onto the bottom of the deque. Owner thread only.
+			 *
+			 * @param element The element to push
+			 * */
+			void push(T element);
+			/**
+			 * Takes the most recently pushed element from the bottom of the deque. Owner thread only.
+			 *
+			 * @param element Set to the element taken, if any
+			 * @return Whether an element was taken
+			 * */
+			bool take(T & element);
+			/**
+			 * Steals the oldest element from the top of the deque. May be called by any thread.
+			 *
+			 * @param element Set to the element stolen, if any
+			 * @return Whether an element was stolen. May spuriously fail if another thread stole at the same time.
+			 * */
+			bool steal(T & element);
+			/**
+			 * Whether the deque (probably) has no elements. Exact only when called by the owner and there
+			 * are no thieves.
+			 * */
+			bool empty() const;
+			/**
+			 * Approximate number of elements in the deque
+			 * */
+			int64_t size() const;
+		protected:
+			/**
+			 * A circular buffer of elements
+			 * */
+			struct Buffer {
+				Buffer(int64_t capacity);
+				T get(int64_t index) const { return elements[index & mask].load(std::memory_order_relaxed); }
+				void put(int64_t index, T element) { elements[index & mask].store(element, std::memory_order_relaxed); }
+				int64_t capacity;
+				int64_t mask;
+				std::unique_ptr<std::atomic<T>[]> elements;
+			};
+			/**
+			 * Creates a buffer twice as large and copies all elements between top and bottom into it
+			 * */
+			Buffer * grow(Buffer * buffer, int64_t bottom, int64_t top);
+		private:
+			std::atomic<int64_t> top;
+			std::atomic<int64_t> bottom;
+			std::atomic<Buffer *> buffer;
+			// Every buffer ever allocated (only touched by the owner)
+			std::vector<std::unique_ptr<Buffer>> buffers;
+		};
+	}
+}
+
+#endif // STAMINA_UTIL_WORKSTEALINGDEQUE_H
@@ -61,12 +61,19 @@ static bool received_segfault = false;
 		stamina::core::Options::export_trans = "";
 		stamina::core::Options::rank_transitions = false;
 		stamina::core::Options::max_iterations = 10000;
+		stamina::core::Options::max_states = 0;
+		stamina::core::Options::max_transitions = 0;
+		stamina::core::Options::max_memory = 0;
 		stamina::core::Options::method = STAMINA_METHODS::ITERATIVE_METHOD;
 		stamina::core::Options::threads = 1;
 		stamina::core::Options::preterminate = false;
 		stamina::core::Options::event = EVENTS::UNDEFINED;
 		stamina::core::Options::distance_weight = 1.0;
 		stamina::core::Options::quiet = false;
+		stamina::core::Options::joint_solver = false;
+		stamina::core::Options::warm_start = false;
+		stamina::core::Options::incremental_matrix = false;
+		stamina::core::Options::compiled_generator = false;
 	}
 
 	void
@@ -31,11 +31,39 @@
 
 #include <cstring> // For memcmp
 #include <cstdint>
+#include <cmath>
+#include <thread>
+#include <atomic>
+#include <future>
+#include <algorithm>
+#include <functional>
+#include <chrono>
+#include <unordered_map>
+#include <unordered_set>
+#include <memory>
+#include <mutex>
 
 #include <stamina/util/ModelModify.h>
 #include <stamina/util/StateIndexArray.h>
 #include <stamina/util/StateMemoryPool.h>
+#include <stamina/util/IncrementalSparseMatrix.h>
+#include <stamina/util/TransitionStore.h>
+#include <stamina/util/SuccessorCache.h>
+#include <stamina/util/ConcurrentStateMap.h>
+#include <stamina/util/WorkStealingDeque.h>
+#include <stamina/util/SpscRingBuffer.h>
+#include <stamina/util/IndexedHeap.h>
+#include <stamina/util/ExplorationBudget.h>
+#include <stamina/generator/CompiledPrismNextStateGenerator.h>
+#include <stamina/generator/CompiledStateExpression.h>
+#include <stamina/threadsafe/generator/ThreadsafePrismNextStateGenerator.h>
 #include <stamina/builder/ProbabilityState.h>
+#include <stamina/builder/StaminaIterativeModelBuilder.h>
+#include <stamina/builder/StaminaThreadedIterativeModelBuilder.h>
+#include <stamina/priority/EventStatePriority.h>
+#include <stamina/core/StateSpaceInformation.h>
+#include <stamina/core/StaminaTransientSolver.h>
+#include <stamina/builder/threads/ExplorationThreadPool.h>
 #include <stamina/core/Options.h>
 #include <stamina/Stamina.h>
 
@@ -117,44 +145,105 @@ BOOST_AUTO_TEST_CASE( ModelModify_Basic ) {
 BOOST_AUTO_TEST_CASE( StateIndexArray_Basic ) {
 	StateIndexArray<uint32_t, ProbabilityState<uint32_t>> sia;
 
-	// Don't try to dereference any of these
-	ProbabilityState<uint32_t> * one = (ProbabilityState<uint32_t> *) 1;
-	ProbabilityState<uint32_t> * two = (ProbabilityState<uint32_t> *) 2;
-	ProbabilityState<uint32_t> * three = (ProbabilityState<uint32_t> *) 3;
-	ProbabilityState<uint32_t> * mrNullPointer = nullptr;
-	sia.put(1, one);
-	sia.put(2, two);
-	sia.put(3, three);
-	sia.put(0, mrNullPointer);
+	auto one = sia.put(1, ProbabilityState<uint32_t>(1, 0.1));
+	auto two = sia.put(2, ProbabilityState<uint32_t>(2, 0.2));
+	auto three = sia.put(3, ProbabilityState<uint32_t>(3, 0.3));
 
 	BOOST_TEST( sia.get(1) == one );
 	BOOST_TEST( sia.get(2) == two );
 	BOOST_TEST( sia.get(3) == three );
+	BOOST_TEST( sia.get(2)->index == 2 );
+	BOOST_TEST( sia.get(3)->getPi() == 0.3 );
+	BOOST_TEST( sia.size() == 3 );
 
+	// Nothing was put at 0
 	BOOST_TEST( sia.get(0) == nullptr );
 }
 
 // =======================================================================================
 
 BOOST_AUTO_TEST_CASE( StateIndexArray_Advanced ) {
-	StateIndexArray<uint32_t, ProbabilityState<uint32_t>> sia;
-	StateMemoryPool<ProbabilityState<uint32_t>> memPool;
+	// Blocks of 2 ^ 7 = 128 states
+	StateIndexArray<uint32_t, ProbabilityState<uint32_t>> sia(6);
 
-	// Don't try to dereference any of these
-	ProbabilityState<uint32_t> * one = memPool.allocate();
-	ProbabilityState<uint32_t> * two = memPool.allocate();
-	ProbabilityState<uint32_t> * three = memPool.allocate();
-	ProbabilityState<uint32_t> * mrNullPointer = nullptr;
-	sia.put(1, one);
-	sia.put(2, two);
-	sia.put(3, three);
-	sia.put(0, mrNullPointer);
+	for (uint32_t i = 0; i < 1000; i += 3) {
+		sia.put(i, ProbabilityState<uint32_t>(i, 0.0, i % 2 == 0));
+	}
+	// Pointers stay valid while the array grows
+	auto first = sia.get(0);
+	sia.put(5000, ProbabilityState<uint32_t>(5000, 0.0, false));
+	BOOST_TEST( sia.get(0) == first );
+	BOOST_TEST( sia.get(1) == nullptr );
+	BOOST_TEST( sia.get(4999) == nullptr );
+	BOOST_TEST( sia.get(5000)->index == 5000 );
+	BOOST_TEST( sia.get(100000) == nullptr );
+	// Putting at an index again replaces the state
+	sia.put(3, ProbabilityState<uint32_t>(3, 0.0, true));
+	BOOST_TEST( sia.size() == 335 );
 
-	BOOST_TEST( sia.get(1) == one );
-	BOOST_TEST( sia.get(2) == two );
-	BOOST_TEST( sia.get(3) == three );
+	auto perimeter = sia.getPerimeterStates();
+	BOOST_TEST( perimeter.size() == 168 );
+	for (auto index : perimeter) {
+		BOOST_TEST( (index % 6 == 0 || index == 3) );
+	}
+}
 
-	BOOST_TEST( sia.get(0) == nullptr );
+// =======================================================================================
+
+BOOST_AUTO_TEST_CASE( StateIndexArray_Perimeter ) {
+	StateIndexArray<uint32_t, ProbabilityState<uint32_t>> sia(6);
+	for (uint32_t i = 0; i < 1000; i++) {
+		sia.put(i, ProbabilityState<uint32_t>(i, 0.0, true));
+	}
+	BOOST_TEST( sia.getNumberTerminal() == 1000 );
+	for (uint32_t i = 0; i < 1000; i++) {
+		if (i % 7 != 0) {
+			sia.setTerminal(sia.get(i), false);
+		}
+	}
+	BOOST_TEST( sia.getNumberTerminal() == 143 );
+	BOOST_TEST( !sia.get(1)->isTerminal() );
+	uint32_t count = 0;
+	uint32_t expected = 0;
+	for (auto probabilityState : sia.perimeter()) {
+		BOOST_TEST( probabilityState->index == expected );
+		expected += 7;
+		count++;
+	}
+	BOOST_TEST( count == 143 );
+	// Putting a non-terminal state over a terminal one clears its bit
+	sia.put(0, ProbabilityState<uint32_t>(0, 0.0, false));
+	BOOST_TEST( sia.getNumberTerminal() == 142 );
+	BOOST_TEST( sia.getPerimeterStates().front() == 7 );
+}
+
+// =======================================================================================
+
+BOOST_AUTO_TEST_CASE( StateIndexArray_Threads ) {
+	// Small blocks, so that the array grows while other threads read from it
+	StateIndexArray<uint32_t, ProbabilityState<uint32_t>> sia(6);
+	const uint32_t numberThreads = 4;
+	const uint32_t numberStates = 100000;
+	std::atomic<uint32_t> wrongStates(0);
+	std::vector<std::thread> workers;
+	for (uint32_t thread = 0; thread < numberThreads; ++thread) {
+		workers.emplace_back([&, thread]() {
+			for (uint32_t i = thread; i < numberStates; i += numberThreads) {
+				sia.put(i, ProbabilityState<uint32_t>(i, 0.0, true));
+				// Put by another thread, so it may or may not be there yet
+				auto other = sia.get(i - 1);
+				if (i > 0 && other != nullptr && other->index != i - 1) {
+					wrongStates++;
+				}
+			}
+		});
+	}
+	for (auto & worker : workers) {
+		worker.join();
+	}
+	BOOST_TEST( wrongStates == 0 );
+	BOOST_TEST( sia.size() == numberStates );
+	BOOST_TEST( sia.getNumberTerminal() == numberStates );
 }
 
 // =======================================================================================
@@ -181,11 +270,811 @@ BOOST_AUTO_TEST_CASE( StateMemoryPool_Advanced ) {
 	}
 }
 
+// =======================================================================================
+
+BOOST_AUTO_TEST_CASE( StateMemoryPool_FreeAndDefrag ) {
+	// Blocks of 2 ^ 6 = 64 states
+	StateMemoryPool<ProbabilityState<uint32_t>> memPool(5);
+	std::vector<ProbabilityState<uint32_t> *> states;
+	for (uint32_t i = 0; i < 1000; i++) {
+		states.push_back(memPool.allocate());
+		*states.back() = ProbabilityState<uint32_t>(i);
+	}
+	BOOST_TEST( memPool.getLiveBytes() == 1000 * sizeof(ProbabilityState<uint32_t>) );
+	// Larger than the rest of the current block, and larger than a whole block
+	auto array = memPool.allocate(50);
+	auto large = memPool.allocate(100);
+	BOOST_TEST( array != nullptr );
+	BOOST_TEST( large != nullptr );
+	for (uint32_t i = 0; i < 1000; i++) {
+		memPool.free(states[i]);
+	}
+	BOOST_TEST( memPool.getFragmentation() > 0.5 );
+	auto reserved = memPool.getReservedBytes();
+	memPool.defrag();
+	BOOST_TEST( memPool.getReservedBytes() < reserved );
+	BOOST_TEST( memPool.getLiveBytes() == (64 + 128) * sizeof(ProbabilityState<uint32_t>) );
+	// Memory freed by another thread is reused
+	auto state = memPool.allocate();
+	std::thread other([&] { memPool.freeRemote(state); });
+	other.join();
+	BOOST_TEST( memPool.allocate() == state );
+}
+
+BOOST_AUTO_TEST_CASE( StateMemoryPool_FreeReleasesStates ) {
+	StateMemoryPool<ProbabilityStatePair<uint32_t>> memPool;
+	auto pair = memPool.allocate();
+	pair->second = CompressedState(4096);
+	memPool.free(pair);
+	// Recycled pairs do not keep the storage of their state, which the pool does not count
+	auto recycled = memPool.allocate();
+	BOOST_TEST( recycled == pair );
+	BOOST_TEST( recycled->second.size() == 0 );
+	BOOST_TEST( recycled->first == nullptr );
+}
+
+// =======================================================================================
+// Tests that rows cached by the IncrementalSparseMatrix are rebuilt correctly
+// =======================================================================================
+
+BOOST_AUTO_TEST_CASE( IncrementalSparseMatrix_Basic ) {
+	IncrementalSparseMatrix<double, uint32_t> matrix;
+	std::vector<StaminaTransitionInfo<uint32_t>> rowOne = {
+		StaminaTransitionInfo<uint32_t>(1, 2, 3.0)
+		, StaminaTransitionInfo<uint32_t>(1, 0, 1.0)
+	};
+	std::vector<StaminaTransitionInfo<uint32_t>> rowTwo = {
+		StaminaTransitionInfo<uint32_t>(2, 1, 2.0)
+	};
+	matrix.replaceRow(1, rowOne);
+	matrix.replaceRow(2, rowTwo);
+	auto first = matrix.build(3);
+	BOOST_TEST( first.getRowCount() == 3 );
+	BOOST_TEST( first.getEntryCount() == 3 );
+	// Columns should have been sorted
+	BOOST_TEST( first.getRow(1).begin()->getColumn() == 0 );
+	// Replace a row: the transition to the absorbing state goes away
+	rowOne.pop_back();
+	matrix.replaceRow(1, rowOne);
+	BOOST_TEST( matrix.getNumberOfRowsRewritten() == 1 );
+	auto second = matrix.build(3);
+	BOOST_TEST( second.getEntryCount() == 2 );
+	BOOST_TEST( second.getRow(1).begin()->getColumn() == 2 );
+	BOOST_TEST( second.getRow(2).begin()->getValue() == 2.0 );
+}
+
+// =======================================================================================
+// Tests that rows written in order are moved into the matrix as-is, and that rates into
+// the absorbing state (kept outside of the TransitionStore) end up in column 0
+// =======================================================================================
+
+BOOST_AUTO_TEST_CASE( IncrementalSparseMatrix_Release ) {
+	TransitionStore<double, uint32_t> store;
+	store.addRows(4);
+	store.append(1, 3, 1.0);
+	store.append(1, 2, 2.0);
+	store.append(2, 1, 1.0);
+	store.append(3, 3, 1.0);
+	// Out of order, and a duplicate column
+	store.append(1, 2, 0.5);
+	IncrementalSparseMatrix<double, uint32_t> matrix;
+	for (uint32_t row = 0; row < 4; ++row) {
+		matrix.replaceRow(row, store, row == 2 ? 4.0 : 0.0);
+	}
+	auto released = matrix.release(4);
+	BOOST_TEST( matrix.getRowCount() == 0 );
+	BOOST_TEST( released.getRowCount() == 4 );
+	BOOST_TEST( released.getEntryCount() == 5 );
+	BOOST_TEST( released.getRow(0).getNumberOfEntries() == 0 );
+	BOOST_TEST( released.getRow(1).begin()->getColumn() == 2 );
+	BOOST_TEST( released.getRow(1).begin()->getValue() == 2.5 );
+	BOOST_TEST( released.getRow(2).begin()->getColumn() == 0 );
+	BOOST_TEST( released.getRow(2).begin()->getValue() == 4.0 );
+	// Rows rewritten out of order are compacted first
+	matrix.replaceRow(2, store);
+	matrix.replaceRow(1, store);
+	matrix.replaceRow(2, store, 1.0);
+	auto compacted = matrix.release(3);
+	BOOST_TEST( compacted.getEntryCount() == 4 );
+	BOOST_TEST( compacted.getRow(2).begin()->getColumn() == 0 );
+}
+
+// =======================================================================================
+// Tests that the TransitionStore keeps rows intact when they are appended to out of order
+// =======================================================================================
+
+BOOST_AUTO_TEST_CASE( TransitionStore_Basic ) {
+	BOOST_TEST( sizeof(TransitionStore<double, uint32_t>::Entry) == 12 );
+	// Small chunks so that rows cross chunk boundaries
+	TransitionStore<double, uint32_t> store(2);
+	store.addRows(3);
+	std::vector<StaminaTransitionInfo<uint32_t>> rowOne = {
+		StaminaTransitionInfo<uint32_t>(1, 2, 3.0)
+		, StaminaTransitionInfo<uint32_t>(1, 0, 1.0)
+		, StaminaTransitionInfo<uint32_t>(1, 1, 0.5)
+	};
+	store.append(1, rowOne);
+	store.append(2, 1, 2.0);
+	// Row one again, after row two was written
+	store.append(1, 2, 4.0);
+	BOOST_TEST( store.getNumberOfOverflowSegments() == 1 );
+	BOOST_TEST( store.getRowEntryCount(1) == 4 );
+	BOOST_TEST( store.back(1)->to == 2 );
+	std::vector<uint32_t> columns;
+	store.forEachTransition(1, [&](auto const & entry) { columns.push_back(entry.to); });
+	BOOST_TEST( (columns == std::vector<uint32_t>{2, 0, 1, 2}) );
+	BOOST_TEST( store.removeTransitionsTo(1, 0) == 1 );
+	BOOST_TEST( store.getEntryCount() == 4 );
+	store.compact();
+	BOOST_TEST( store.getNumberOfOverflowSegments() == 0 );
+	columns.clear();
+	double total = 0;
+	store.forEachTransition(1, [&](auto const & entry) {
+		columns.push_back(entry.to);
+		total += entry.rate;
+	});
+	BOOST_TEST( (columns == std::vector<uint32_t>{2, 1, 2}) );
+	BOOST_TEST( total == 7.5 );
+	BOOST_TEST( store.getRowEntryCount(2) == 1 );
+	BOOST_TEST( store.getRowEntryCount(0) == 0 );
+}
+
+// =======================================================================================
+// Tests that the SuccessorCache gives back the same behavior as the generator without
+// finding any new states, and that it drops entries which are not kept
+// =======================================================================================
+
+BOOST_AUTO_TEST_CASE( SuccessorCache_Basic ) {
+	core::Options::quiet = true;
+	std::string modelFile = "../test/models/simple.prism";
+	std::string propFile = "../test/models/simple.csl";
+	ModelModify mod(modelFile, propFile);
+	auto program = mod.readModel();
+	auto generator = std::make_shared<storm::generator::PrismNextStateGenerator<double, uint32_t>>(
+		*program
+		, storm::generator::NextStateGeneratorOptions()
+	);
+	std::vector<CompressedState> seen;
+	std::function<uint32_t (CompressedState const &)> callback = [&](CompressedState const & state) {
+		auto it = std::find(seen.begin(), seen.end(), state);
+		if (it != seen.end()) {
+			return static_cast<uint32_t>(it - seen.begin());
+		}
+		seen.push_back(state);
+		return static_cast<uint32_t>(seen.size() - 1);
+	};
+	generator->getInitialStates(callback);
+	BOOST_TEST( seen.size() == 1 );
+	SuccessorCache<double, uint32_t> cache;
+	generator->load(seen[0]);
+	auto recorded = cache.record(*generator, 0, callback);
+	std::vector<std::pair<uint32_t, double>> expected;
+	for (auto const & choice : recorded) {
+		for (auto const & [successor, rate] : choice) {
+			expected.emplace_back(successor, rate);
+		}
+	}
+	BOOST_TEST( !expected.empty() );
+	std::size_t numberSeen = seen.size();
+	storm::generator::StateBehavior<double, uint32_t> replayed;
+	BOOST_TEST( !cache.replay(1, callback, replayed, true) );
+	BOOST_TEST( cache.replay(0, callback, replayed, true) );
+	std::vector<std::pair<uint32_t, double>> actual;
+	for (auto const & choice : replayed) {
+		for (auto const & [successor, rate] : choice) {
+			actual.emplace_back(successor, rate);
+		}
+	}
+	BOOST_TEST( (actual == expected) );
+	BOOST_TEST( seen.size() == numberSeen );
+	BOOST_TEST( cache.getNumberOfHits() == 1 );
+	BOOST_TEST( cache.getNumberOfMisses() == 1 );
+	// Not kept after this
+	BOOST_TEST( cache.replay(0, callback, replayed, false) );
+	BOOST_TEST( !cache.replay(0, callback, replayed, true) );
+	BOOST_TEST( cache.getSize() == 0 );
+	// Too small to hold anything
+	cache.setCapacity(1);
+	generator->load(seen[0]);
+	cache.record(*generator, 0, callback);
+	BOOST_TEST( !cache.replay(0, callback, replayed, true) );
+}
+
+// =======================================================================================
+// Tests that the compiled generator gives the same successors and rates as storm's on every
+// state of a breadth-first exploration while skipping guards which cannot have changed, and
+// reports how long each generator took
+// =======================================================================================
+
+BOOST_AUTO_TEST_CASE( CompiledPrismNextStateGenerator_MatchesStorm ) {
+	core::Options::quiet = true;
+	std::string modelFile = "../test/models/simple.prism";
+	std::string propFile = "../test/models/simple.csl";
+	ModelModify mod(modelFile, propFile);
+	auto program = mod.readModel();
+	storm::generator::NextStateGeneratorOptions options;
+	storm::generator::PrismNextStateGenerator<double, uint32_t> stormGenerator(*program, options);
+	stamina::generator::CompiledPrismNextStateGenerator<double, uint32_t> compiledGenerator(*program, options);
+	BOOST_TEST( compiledGenerator.isCompiled() );
+	std::vector<CompressedState> states;
+	std::unordered_map<CompressedState, uint32_t> indices;
+	std::function<uint32_t (CompressedState const &)> callback = [&](CompressedState const & state) {
+		auto emplaced = indices.emplace(state, static_cast<uint32_t>(states.size()));
+		if (emplaced.second) {
+			states.push_back(state);
+		}
+		return emplaced.first->second;
+	};
+	auto successorsOf = [](storm::generator::StateBehavior<double, uint32_t> const & behavior) {
+		std::vector<std::pair<uint32_t, double>> successors;
+		for (auto const & choice : behavior) {
+			for (auto const & [successor, rate] : choice) {
+				successors.emplace_back(successor, rate);
+			}
+		}
+		std::sort(successors.begin(), successors.end());
+		return successors;
+	};
+	stormGenerator.getInitialStates(callback);
+	const std::size_t numberOfStates = 5000;
+	bool allMatch = true;
+	for (std::size_t i = 0; i < states.size() && i < numberOfStates; i++) {
+		// Copied, since the callback may grow `states`
+		CompressedState state = states[i];
+		stormGenerator.load(state);
+		auto expected = successorsOf(stormGenerator.expand(callback));
+		compiledGenerator.load(state);
+		auto actual = successorsOf(compiledGenerator.expand(callback));
+		allMatch = allMatch && actual == expected;
+	}
+	BOOST_TEST( allMatch );
+	BOOST_TEST( states.size() >= numberOfStates );
+	// Successive states rarely change both variables, so some guards were not evaluated again
+	BOOST_TEST( compiledGenerator.getNumberOfGuardEvaluations() < numberOfStates * program->getNumberOfCommands() );
+	// Benchmark both on the states that were found, which all have indices now
+	auto timeExpansions = [&](storm::generator::PrismNextStateGenerator<double, uint32_t> & generator) {
+		auto start = std::chrono::high_resolution_clock::now();
+		std::size_t numberOfChoices = 0;
+		for (std::size_t i = 0; i < numberOfStates; i++) {
+			generator.load(states[i]);
+			numberOfChoices += generator.expand(callback).getNumberOfChoices();
+		}
+		auto end = std::chrono::high_resolution_clock::now();
+		BOOST_TEST( numberOfChoices > 0 );
+		return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+	};
+	auto stormTime = timeExpansions(stormGenerator);
+	auto compiledTime = timeExpansions(compiledGenerator);
+	BOOST_TEST_MESSAGE(
+		"Expanding " << numberOfStates << " states took " << stormTime << " us with storm's generator and "
+		<< compiledTime << " us with the compiled generator"
+	);
+}
+
+// =======================================================================================
+// Tests that the compiled generator skips updates with a zero rate like storm does, so it
+// neither registers their successors nor checks the bounds of their assignments
+// =======================================================================================
+
+BOOST_AUTO_TEST_CASE( CompiledPrismNextStateGenerator_ZeroRate ) {
+	core::Options::quiet = true;
+	auto program = storm::parser::PrismParser::parse("../test/models/zero_rate.prism", true);
+	storm::generator::NextStateGeneratorOptions options;
+	storm::generator::PrismNextStateGenerator<double, uint32_t> stormGenerator(program, options);
+	stamina::generator::CompiledPrismNextStateGenerator<double, uint32_t> compiledGenerator(program, options);
+	BOOST_TEST( compiledGenerator.isCompiled() );
+	// Explores the whole model, giving states indices in the order the generator finds them. Every
+	// entry is kept, so a successor which storm never reaches would show up
+	auto explore = [](storm::generator::PrismNextStateGenerator<double, uint32_t> & generator) {
+		std::vector<CompressedState> states;
+		std::unordered_map<CompressedState, uint32_t> indices;
+		std::function<uint32_t (CompressedState const &)> callback = [&](CompressedState const & state) {
+			auto emplaced = indices.emplace(state, static_cast<uint32_t>(states.size()));
+			if (emplaced.second) {
+				states.push_back(state);
+			}
+			return emplaced.first->second;
+		};
+		std::vector<std::vector<std::pair<uint32_t, double>>> rows;
+		generator.getInitialStates(callback);
+		for (std::size_t i = 0; i < states.size(); i++) {
+			// Copied, since the callback may grow `states`
+			CompressedState state = states[i];
+			generator.load(state);
+			std::vector<std::pair<uint32_t, double>> row;
+			for (auto const & choice : generator.expand(callback)) {
+				for (auto const & [successor, rate] : choice) {
+					row.emplace_back(successor, rate);
+				}
+			}
+			rows.push_back(std::move(row));
+		}
+		return std::make_pair(std::move(states), std::move(rows));
+	};
+	auto [stormStates, stormRows] = explore(stormGenerator);
+	auto [compiledStates, compiledRows] = explore(compiledGenerator);
+	// x = 10, ..., 0
+	BOOST_TEST( stormStates.size() == 11 );
+	BOOST_TEST( (compiledStates == stormStates) );
+	BOOST_TEST( (compiledRows == stormRows) );
+	// x = 0 has no successors
+	BOOST_TEST( compiledRows.back().empty() );
+}
+
+// =======================================================================================
+// Tests that a compiled state expression agrees with storm's evaluation of the same
+// expression on every state of a breadth-first exploration
+// =======================================================================================
+
+BOOST_AUTO_TEST_CASE( CompiledStateExpression_MatchesStorm ) {
+	core::Options::quiet = true;
+	std::string modelFile = "../test/models/simple.prism";
+	std::string propFile = "../test/models/simple.csl";
+	ModelModify mod(modelFile, propFile);
+	auto program = mod.readModel();
+	auto propVector = mod.createPropertiesList(program);
+	// phi2 of P=? [ true U[0,1] ((First < 20) & (Second >= 20)) ]
+	auto formula = std::static_pointer_cast<const storm::logic::ProbabilityOperatorFormula>((*propVector)[0].getRawFormula());
+	auto const & untilFormula = formula->getSubformula().asBoundedUntilFormula();
+	auto expression = untilFormula.getRightSubformula().toExpression(program->getManager());
+	storm::generator::NextStateGeneratorOptions options;
+	storm::generator::PrismNextStateGenerator<double, uint32_t> generator(*program, options);
+	stamina::generator::CompiledStateExpression<double> compiled(expression, generator.getVariableInformation());
+	BOOST_TEST( compiled.isCompiled() );
+	std::vector<CompressedState> states;
+	std::unordered_map<CompressedState, uint32_t> indices;
+	std::function<uint32_t (CompressedState const &)> callback = [&](CompressedState const & state) {
+		auto emplaced = indices.emplace(state, static_cast<uint32_t>(states.size()));
+		if (emplaced.second) {
+			states.push_back(state);
+		}
+		return emplaced.first->second;
+	};
+	generator.getInitialStates(callback);
+	const std::size_t numberOfStates = 2000;
+	bool allMatch = true;
+	std::size_t numberSatisfying = 0;
+	for (std::size_t i = 0; i < states.size() && i < numberOfStates; i++) {
+		CompressedState state = states[i];
+		generator.load(state);
+		storm::expressions::SimpleValuation valuation = generator.currentStateToSimpleValuation();
+		bool expected = expression.evaluateAsBool(&valuation);
+		allMatch = allMatch && compiled.evaluateAsBool(state) == expected;
+		numberSatisfying += expected;
+		generator.expand(callback);
+	}
+	BOOST_TEST( allMatch );
+	// Both outcomes were checked
+	BOOST_TEST( numberSatisfying > 0 );
+	BOOST_TEST( numberSatisfying < numberOfStates );
+}
+
+// =======================================================================================
+// Tests that several threads sharing one ThreadsafePrismNextStateGenerator get the same
+// successors as a compiled generator used by a single thread
+// =======================================================================================
+
+BOOST_AUTO_TEST_CASE( ThreadsafePrismNextStateGenerator_Shared ) {
+	core::Options::quiet = true;
+	std::string modelFile = "../test/models/simple.prism";
+	std::string propFile = "../test/models/simple.csl";
+	ModelModify mod(modelFile, propFile);
+	auto program = mod.readModel();
+	storm::generator::NextStateGeneratorOptions options;
+	stamina::generator::CompiledPrismNextStateGenerator<double, uint32_t> compiledGenerator(*program, options);
+	stamina::threadsafe::generator::ThreadsafePrismNextStateGenerator<double, uint32_t> sharedGenerator(*program, options);
+	BOOST_TEST( sharedGenerator.isCompiled() );
+	std::mutex statesMutex;
+	std::vector<CompressedState> states;
+	std::unordered_map<CompressedState, uint32_t> indices;
+	std::function<uint32_t (CompressedState const &)> callback = [&](CompressedState const & state) {
+		std::lock_guard<std::mutex> lock(statesMutex);
+		auto emplaced = indices.emplace(state, static_cast<uint32_t>(states.size()));
+		if (emplaced.second) {
+			states.push_back(state);
+		}
+		return emplaced.first->second;
+	};
+	auto successorsOf = [](storm::generator::StateBehavior<double, uint32_t> const & behavior) {
+		std::vector<std::pair<uint32_t, double>> successors;
+		for (auto const & choice : behavior) {
+			for (auto const & [successor, rate] : choice) {
+				successors.emplace_back(successor, rate);
+			}
+		}
+		std::sort(successors.begin(), successors.end());
+		return successors;
+	};
+	compiledGenerator.getInitialStates(callback);
+	const std::size_t numberOfStates = 2000;
+	std::vector<std::vector<std::pair<uint32_t, double>>> expected;
+	for (std::size_t i = 0; i < states.size() && i < numberOfStates; i++) {
+		CompressedState state = states[i];
+		compiledGenerator.load(state);
+		expected.push_back(successorsOf(compiledGenerator.expand(callback)));
+	}
+	BOOST_TEST( expected.size() == numberOfStates );
+	// Each thread expands every fourth state, interleaved with the others
+	const std::size_t numberOfThreads = 4;
+	std::atomic<bool> allMatch(true);
+	std::vector<std::thread> threads;
+	for (std::size_t t = 0; t < numberOfThreads; t++) {
+		threads.emplace_back([&, t]() {
+			for (std::size_t i = t; i < numberOfStates; i += numberOfThreads) {
+				CompressedState state;
+				{
+					std::lock_guard<std::mutex> lock(statesMutex);
+					state = states[i];
+				}
+				if (successorsOf(sharedGenerator.expand(state, callback)) != expected[i]) {
+					allMatch = false;
+				}
+			}
+		});
+	}
+	for (auto & thread : threads) {
+		thread.join();
+	}
+	BOOST_TEST( allMatch );
+	BOOST_TEST( sharedGenerator.getNumberOfGuardEvaluations() > 0 );
+}
+
+// =======================================================================================
+// Tests that the priority tree is lowered into a postfix program and that the program
+// gives the expected distance
+// =======================================================================================
+
+BOOST_AUTO_TEST_CASE( PriorityTree_Lowered ) {
+	core::Options::quiet = true;
+	std::string modelFile = "../test/models/simple.prism";
+	std::string propFile = "../test/models/simple.csl";
+	ModelModify mod(modelFile, propFile);
+	auto program = mod.readModel();
+	auto propVector = mod.createPropertiesList(program);
+	storm::generator::NextStateGeneratorOptions options;
+	storm::generator::PrismNextStateGenerator<double, uint32_t> generator(*program, options);
+	core::StateSpaceInformation::setVariableInformation(generator.getVariableInformation());
+	priority::PriorityTree tree(program->getManager());
+	tree.initialize(&(*propVector)[0]);
+	BOOST_TEST( tree.wasInitialized() );
+	// (First < 20) & (Second >= 20)
+	typedef priority::PriorityTree::Instruction Instruction;
+	auto const & lowered = tree.getProgram();
+	BOOST_TEST( lowered.size() == 7 );
+	BOOST_TEST( lowered[0].kind == Instruction::INTEGER_VARIABLE );
+	BOOST_TEST( lowered[1].kind == Instruction::CONSTANT );
+	BOOST_TEST( lowered[2].m_operator == priority::PriorityTree::LESS_THAN_EQ );
+	BOOST_TEST( lowered[5].m_operator == priority::PriorityTree::GREATER_THAN_EQ );
+	BOOST_TEST( lowered[6].kind == Instruction::OPERATOR );
+	BOOST_TEST( lowered[6].m_operator == priority::PriorityTree::AND );
+	BOOST_TEST( lowered[6].arity == 2 );
+	// In the initial state (First = 0, Second = 20) both comparisons have distance 0
+	std::vector<CompressedState> states;
+	generator.getInitialStates([&](CompressedState const & state) {
+		states.push_back(state);
+		return static_cast<uint32_t>(states.size() - 1);
+	});
+	BOOST_TEST( states.size() == 1 );
+	BOOST_TEST( tree.distance(states[0]) == -0.5f );
+}
+
+// =======================================================================================
+// Tests that the ConcurrentStateMap assigns owners and indices exactly once
+// =======================================================================================
+
+BOOST_AUTO_TEST_CASE( ConcurrentStateMap_Basic ) {
+	// Small first table so that the map has to chain several tables
+	ConcurrentStateMap<uint32_t> map(70, 4);
+	storm::storage::BitVector a(70);
+	a.set(3);
+	storm::storage::BitVector b(70);
+	b.set(68);
+	BOOST_TEST( !map.contains(a) );
+	auto first = map.findOrAdd(a, 1);
+	BOOST_TEST( first.first == 1 );
+	BOOST_TEST( first.second == 1 );
+	// Another thread asking for the same state gets the same owner and index
+	auto second = map.findOrAdd(a, 2);
+	BOOST_TEST( second.first == 1 );
+	BOOST_TEST( second.second == 1 );
+	// Registered without an owner, then claimed
+	map.findOrAdd(b, 0, 7);
+	BOOST_TEST( map.find(b).first == 0 );
+	BOOST_TEST( map.findOrAdd(b, 2).first == 2 );
+	BOOST_TEST( map.find(b).second == 7 );
+	BOOST_TEST( map.getNextIndex() == 8 );
+	uint32_t visited = 0;
+	map.forEachSince(2, [&](storm::storage::BitVector const & state, uint8_t owner, uint32_t index) {
+		BOOST_TEST( state == b );
+		++visited;
+	});
+	BOOST_TEST( visited == 1 );
+}
+
+BOOST_AUTO_TEST_CASE( ConcurrentStateMap_Threads ) {
+	ConcurrentStateMap<uint32_t> map(32, 4);
+	const uint8_t numberThreads = 4;
+	const uint32_t numberStates = 2000;
+	std::vector<std::thread> workers;
+	for (uint8_t thread = 1; thread <= numberThreads; ++thread) {
+		workers.emplace_back([&map, thread]() {
+			storm::storage::BitVector state(32);
+			for (uint32_t i = 0; i < numberStates; ++i) {
+				state.setFromInt(0, 32, i);
+				map.findOrAdd(state, thread);
+			}
+		});
+	}
+	for (auto & worker : workers) {
+		worker.join();
+	}
+	// Every state was inserted exactly once, so the indices are exactly 1..numberStates
+	BOOST_TEST( map.size() == numberStates );
+	BOOST_TEST( map.getNextIndex() == numberStates + 1 );
+	std::vector<bool> seen(numberStates + 1, false);
+	map.forEachSince(1, [&](storm::storage::BitVector const & state, uint8_t owner, uint32_t index) {
+		BOOST_TEST( !seen[index] );
+		seen[index] = true;
+	});
+}
+
+BOOST_AUTO_TEST_CASE( ConcurrentStateMap_Sealing ) {
+	// With 4 slots in the first table, tables are sealed constantly while other threads insert into them
+	ConcurrentStateMap<uint32_t> map(32, 2);
+	const uint8_t numberThreads = 8;
+	const uint32_t numberStates = 20000;
+	std::vector<std::vector<uint32_t>> indices(numberThreads, std::vector<uint32_t>(numberStates, 0));
+	std::vector<std::thread> workers;
+	for (uint8_t thread = 0; thread < numberThreads; ++thread) {
+		workers.emplace_back([&map, &indices, thread]() {
+			storm::storage::BitVector state(32);
+			// Every thread inserts every state, starting at a different one
+			for (uint32_t j = 0; j < numberStates; ++j) {
+				uint32_t i = (j + thread * numberStates / numberThreads) % numberStates;
+				state.setFromInt(0, 32, i);
+				indices[thread][i] = map.findOrAdd(state, thread + 1).second;
+			}
+		});
+	}
+	for (auto & worker : workers) {
+		worker.join();
+	}
+	// Every thread got the same index for each state, and no two states share an index
+	bool allAgree = true;
+	std::vector<bool> seen(numberStates + 1, false);
+	bool allDistinct = true;
+	for (uint32_t i = 0; i < numberStates; ++i) {
+		for (uint8_t thread = 1; thread < numberThreads; ++thread) {
+			allAgree &= indices[thread][i] == indices[0][i];
+		}
+		uint32_t index = indices[0][i];
+		allDistinct &= index != 0 && index <= numberStates && !seen[index];
+		seen[index] = index <= numberStates;
+	}
+	BOOST_TEST( allAgree );
+	BOOST_TEST( allDistinct );
+	BOOST_TEST( map.size() == numberStates );
+	BOOST_TEST( map.getNextIndex() == numberStates + 1 );
+	// Each state is in exactly one table
+	uint32_t visited = 0;
+	map.forEachSince(1, [&](storm::storage::BitVector const & state, uint8_t owner, uint32_t index) {
+		++visited;
+	});
+	BOOST_TEST( visited == numberStates );
+}
+
+// =======================================================================================
+// Tests that the WorkStealingDeque takes from the bottom and steals from the top
+// =======================================================================================
+
+BOOST_AUTO_TEST_CASE( WorkStealingDeque_Basic ) {
+	// Capacity of 2 so that the deque has to grow
+	WorkStealingDeque<ProbabilityStatePair<uint32_t> *> deque(1);
+	storm::storage::BitVector state(8);
+	std::vector<ProbabilityState<uint32_t>> probabilityStates;
+	for (uint32_t i = 1; i <= 5; ++i) {
+		probabilityStates.emplace_back(i);
+	}
+	std::vector<ProbabilityStatePair<uint32_t>> pairs;
+	for (auto & probabilityState : probabilityStates) {
+		pairs.emplace_back(&probabilityState, state);
+	}
+	for (auto & pair : pairs) {
+		deque.push(&pair);
+	}
+	BOOST_TEST( deque.size() == 5 );
+	ProbabilityStatePair<uint32_t> * element = nullptr;
+	// Owner takes the newest
+	BOOST_TEST( deque.take(element) );
+	BOOST_TEST( element->first->index == 5 );
+	// Thieves take the oldest
+	BOOST_TEST( deque.steal(element) );
+	BOOST_TEST( element->first->index == 1 );
+	while (deque.take(element)) { }
+	BOOST_TEST( deque.empty() );
+	BOOST_TEST( !deque.steal(element) );
+}
+
+// =======================================================================================
+// Tests that the SpscRingBuffer hands over batches in order and without copying
+// =======================================================================================
+
+BOOST_AUTO_TEST_CASE( SpscRingBuffer_Basic ) {
+	typedef std::vector<StaminaTransitionInfo<uint32_t>> Batch;
+	SpscRingBuffer<Batch> buffer(1);
+	BOOST_TEST( buffer.empty() );
+	BOOST_TEST( buffer.front() == nullptr );
+	Batch first = { StaminaTransitionInfo<uint32_t>(1, 2, 1.0), StaminaTransitionInfo<uint32_t>(1, 3, 2.0) };
+	auto data = first.data();
+	BOOST_TEST( buffer.tryPush(std::move(first)) );
+	BOOST_TEST( buffer.tryPush(Batch(1, StaminaTransitionInfo<uint32_t>(2, 1, 1.0))) );
+	// Capacity of 2
+	Batch third(1, StaminaTransitionInfo<uint32_t>(3, 1, 1.0));
+	BOOST_TEST( !buffer.tryPush(std::move(third)) );
+	BOOST_TEST( third.size() == 1 );
+	Batch * front = buffer.front();
+	BOOST_TEST( front->size() == 2 );
+	// The batch was moved, not copied
+	BOOST_TEST( front->data() == data );
+	buffer.pop();
+	BOOST_TEST( buffer.front()->front().from == 2 );
+	buffer.pop();
+	BOOST_TEST( buffer.empty() );
+}
+
+// =======================================================================================
+// Tests that the IndexedHeap pops in priority order, replaces elements pushed twice, and
+// moves an element up when its priority grows
+// =======================================================================================
+
+BOOST_AUTO_TEST_CASE( IndexedHeap_Basic ) {
+	// Order on reachability alone
+	typedef ProbabilityStatePairComparison<uint32_t, EVENTS::UNDEFINED> Comparison;
+	std::vector<ProbabilityState<uint32_t>> probabilityStates;
+	for (uint32_t i = 0; i < 20; i++) {
+		probabilityStates.emplace_back(i, (i * 7 % 20) / 20.0);
+	}
+	IndexedHeap<ProbabilityStatePair<uint32_t>, Comparison> heap;
+	auto push = [&](uint32_t index) {
+		ProbabilityStatePair<uint32_t> pair(&probabilityStates[index]);
+		pair.score = Comparison::score(pair);
+		heap.push(index, std::move(pair));
+	};
+	auto rescore = [&](uint32_t index) {
+		heap.get(index).score = Comparison::score(heap.get(index));
+		heap.update(index);
+	};
+	for (uint32_t i = 0; i < 20; i++) {
+		push(i);
+	}
+	// Pushing the same key again replaces rather than duplicates
+	push(3);
+	BOOST_TEST( heap.size() == 20 );
+	// Visiting the elements does not remove them
+	std::size_t visited = 0;
+	heap.forEach([&](ProbabilityStatePair<uint32_t> const & pair) { visited++; });
+	BOOST_TEST( visited == 20 );
+	BOOST_TEST( heap.size() == 20 );
+	BOOST_TEST( heap.contains(19) );
+	BOOST_TEST( !heap.contains(20) );
+	// Increase-key
+	probabilityStates[5].addToPi(2.0);
+	rescore(5);
+	BOOST_TEST( heap.top().first->index == 5 );
+	auto popped = heap.pop();
+	BOOST_TEST( popped.first->index == 5 );
+	BOOST_TEST( !heap.contains(5) );
+	// Decrease-key
+	probabilityStates[4].setPi(-1.0);
+	rescore(4);
+	double previous = 3.0;
+	bool ordered = true;
+	uint32_t last = 0;
+	while (!heap.empty()) {
+		auto pair = heap.pop();
+		ordered = ordered && pair.first->getPi() <= previous;
+		previous = pair.first->getPi();
+		last = pair.first->index;
+	}
+	BOOST_TEST( ordered );
+	BOOST_TEST( last == 4 );
+}
+
+// =======================================================================================
+// Tests that the scores of the priority comparators weigh the distance by event mode
+// =======================================================================================
+
+BOOST_AUTO_TEST_CASE( ProbabilityStatePairComparison_Score ) {
+	auto distanceWeight = core::Options::distance_weight;
+	core::Options::distance_weight = 1.0;
+	ProbabilityState<uint32_t> near(1, 0.5);
+	ProbabilityState<uint32_t> far(2, 0.5);
+	ProbabilityStatePair<uint32_t> nearPair(&near);
+	nearPair.distance = 0.0;
+	ProbabilityStatePair<uint32_t> farPair(&far);
+	farPair.distance = 1.0;
+	typedef ProbabilityStatePairComparison<uint32_t, EVENTS::UNDEFINED> Undefined;
+	typedef ProbabilityStatePairComparison<uint32_t, EVENTS::RARE> Rare;
+	typedef ProbabilityStatePairComparison<uint32_t, EVENTS::COMMON> Common;
+	BOOST_TEST( Undefined::score(nearPair) == Undefined::score(farPair) );
+	// Rare events favor states far from the threshold, common events states near it
+	BOOST_TEST( Rare::score(farPair) == 1.0 );
+	BOOST_TEST( Rare::score(nearPair) == 0.5 );
+	BOOST_TEST( Common::score(nearPair) == 1.0 );
+	BOOST_TEST( Common::score(farPair) == 0.5 );
+	// Comparisons only look at the stored score
+	nearPair.score = Rare::score(nearPair);
+	farPair.score = Rare::score(farPair);
+	BOOST_TEST( Rare()(nearPair, farPair) );
+	BOOST_TEST( Common()(nearPair, farPair) );
+	core::Options::distance_weight = distanceWeight;
+}
+
+// =======================================================================================
+// Tests that the ExplorationBudget runs out at each of its limits and then stays exhausted
+// =======================================================================================
+
+BOOST_AUTO_TEST_CASE( ExplorationBudget_Basic ) {
+	ExplorationBudget unlimited;
+	BOOST_TEST( !unlimited.isLimited() );
+	BOOST_TEST( !unlimited.check(UINT32_MAX, UINT32_MAX) );
+	ExplorationBudget states(100, 0, 0);
+	BOOST_TEST( states.isLimited() );
+	BOOST_TEST( !states.check(99, 1000000) );
+	BOOST_TEST( !states.isExhausted() );
+	BOOST_TEST( states.check(100, 0) );
+	BOOST_TEST( states.isExhausted() );
+	BOOST_TEST( !states.getReason().empty() );
+	// Does not recover when the counts drop
+	BOOST_TEST( states.check(0, 0) );
+	ExplorationBudget transitions(0, 10, 0);
+	BOOST_TEST( !transitions.check(1000000, 9) );
+	BOOST_TEST( transitions.check(0, 10) );
+	// Memory is only sampled every few checks
+	ExplorationBudget memory(0, 0, 1, 4);
+	if (ExplorationBudget::getResidentBytes() > 0) {
+		BOOST_TEST( !memory.check(0, 0) );
+		BOOST_TEST( !memory.check(0, 0) );
+		BOOST_TEST( !memory.check(0, 0) );
+		BOOST_TEST( memory.check(0, 0) );
+	}
+}
+
+// =======================================================================================
+// Tests that check the ExplorationThreadPool class
+// =======================================================================================
+
+BOOST_AUTO_TEST_CASE( ExplorationThreadPool_Jobs ) {
+	threads::ExplorationThreadPool<double, uint32_t> pool(2);
+	BOOST_TEST( pool.getNumberOfExplorationThreads() == 2 );
+	// All three workers must be able to block at once (one control and two exploration threads)
+	std::atomic<int> running(0);
+	std::vector<std::future<void>> jobs;
+	for (int i = 0; i < 3; i++) {
+		jobs.push_back(pool.submit([&running] {
+			running++;
+			while (running < 3) {
+				std::this_thread::yield();
+			}
+		}));
+	}
+	for (auto & job : jobs) {
+		job.get();
+	}
+	BOOST_TEST( running == 3 );
+	// Workers are reused for later jobs
+	int value = 0;
+	pool.submit([&value] { value = 42; }).get();
+	BOOST_TEST( value == 42 );
+}
+
 // =======================================================================================
 // Tests that check the ProbabilityState class
 // =======================================================================================
 
 BOOST_AUTO_TEST_CASE( ProbabilityState_Basic ) {
+	// One of these is kept for every explored state
+	BOOST_TEST( sizeof(ProbabilityState<uint32_t>) == 16 );
 	ProbabilityStateComparison<uint16_t> cmp;
 	ProbabilityState<uint16_t> p1(1, 0.5, false, 2);
 	ProbabilityState<uint16_t> p2(2, 0.2, false, 3);
@@ -199,6 +1088,267 @@ BOOST_AUTO_TEST_CASE( ProbabilityState_Basic ) {
 
 }
 
+// =======================================================================================
+// Tests that the STAMINA transient solver agrees with STORM on a truncated model
+// =======================================================================================
+
+BOOST_AUTO_TEST_CASE( StaminaTransientSolver_MatchesStorm ) {
+	set_default_values();
+	core::Options::quiet = true;
+	core::Options::model_file = "../test/models/simple.prism";
+	core::Options::properties_file = "../test/models/simple.csl";
+	// Builds the truncated model (with its absorbing state) and checks it with STORM
+	Stamina s;
+	s.run();
+	auto model = s.modelChecker->getModel();
+	auto propOriginal = (*s.propertiesVector)[0];
+	auto propMin = s.modelModify->modifyProperty(propOriginal, true);
+	auto propMax = s.modelModify->modifyProperty(propOriginal, false);
+	auto const & formulaMin = *(propMin.getRawFormula());
+	auto const & formulaMax = *(propMax.getRawFormula());
+	BOOST_TEST( core::StaminaTransientSolver::supportsFormula(formulaMin) );
+	BOOST_TEST( core::StaminaTransientSolver::supportsFormula(formulaMax) );
+	core::StaminaTransientSolver::CtmcModelChecker checker(*model);
+	auto stormProbabilities = [&](storm::logic::Formula const & formula) {
+		auto result = checker.check(storm::modelchecker::CheckTask<>(formula, false));
+		return result->asExplicitQuantitativeCheckResult<double>().getValueVector();
+	};
+	auto stormMin = stormProbabilities(formulaMin);
+	auto stormMax = stormProbabilities(formulaMax);
+	// Both solvers cut off the Fox-Glynn series within the precision, so together they may differ by twice it
+	const double tolerance = 2 * core::StaminaTransientSolver::precision;
+	auto maxDifference = [](std::vector<double> const & first, std::vector<double> const & second) {
+		double difference = 0;
+		for (std::size_t state = 0; state < first.size(); ++state) {
+			difference = std::max(difference, std::abs(first[state] - second[state]));
+		}
+		return difference;
+	};
+	core::StaminaTransientSolver solver(*model, checker);
+	std::vector<double> upperBounds;
+	auto max = solver.computeBoundedUntil(formulaMax, upperBounds);
+	BOOST_TEST( max.size() == model->getNumberOfStates() );
+	BOOST_TEST( maxDifference(max, stormMax) <= tolerance );
+	upperBounds.clear();
+	auto min = solver.computeBoundedUntil(formulaMin, upperBounds);
+	BOOST_TEST( maxDifference(min, stormMin) <= tolerance );
+	// Pmin and Pmax in one sweep are the same as two separate checks
+	upperBounds.clear();
+	auto [jointMin, jointMax] = solver.computeBoundedUntilMinMax(formulaMin, formulaMax, upperBounds);
+	BOOST_TEST( maxDifference(jointMin, stormMin) <= tolerance );
+	BOOST_TEST( maxDifference(jointMax, stormMax) <= tolerance );
+	// The tightened upper bounds are still upper bounds
+	bool boundsHold = true;
+	for (std::size_t state = 0; state < upperBounds.size() && state < jointMax.size(); ++state) {
+		boundsHold &= upperBounds[state] + tolerance >= jointMax[state];
+	}
+	BOOST_TEST( boundsHold );
+}
+
+BOOST_AUTO_TEST_CASE( StaminaTransientSolver_WarmStart ) {
+	set_default_values();
+	core::Options::quiet = true;
+	core::Options::model_file = "../test/models/simple.prism";
+	core::Options::properties_file = "../test/models/simple.csl";
+	// Small enough to need several refine iterations, so later ones start from earlier upper bounds
+	core::Options::prob_win = 1.0e-6;
+	core::Options::joint_solver = true;
+	Stamina cold;
+	cold.run();
+	core::Options::warm_start = true;
+	Stamina warm;
+	warm.run();
+	core::Options::joint_solver = false;
+	core::Options::warm_start = false;
+	const double tolerance = 2 * core::StaminaTransientSolver::precision;
+	BOOST_TEST( warm.getStateCount() == cold.getStateCount() );
+	auto & coldResult = cold.getResultTable().back();
+	auto & warmResult = warm.getResultTable().back();
+	BOOST_TEST( std::abs(warmResult.pMin - coldResult.pMin) <= tolerance );
+	BOOST_TEST( std::abs(warmResult.pMax - coldResult.pMax) <= tolerance );
+}
+
+// =======================================================================================
+// Tests that the threaded builder builds the same model as the single-threaded builder
+// =======================================================================================
+
+BOOST_AUTO_TEST_CASE( ThreadedBuilder_MatchesIterative ) {
+	set_default_values();
+	core::Options::quiet = true;
+	core::Options::model_file = "../test/models/simple.prism";
+	core::Options::properties_file = "../test/models/simple.csl";
+	Stamina iterative;
+	iterative.run();
+	core::Options::threads = 4;
+	Stamina threaded;
+	threaded.run();
+	core::Options::threads = 1;
+	BOOST_TEST( threaded.getStateCount() > 0 );
+	// Threads explore in a different order, so kappa may cut the perimeter off at slightly
+	// different states. Transitions into states owned by other threads must not be dropped,
+	// so the number of transitions per state stays the same
+	double iterativeStates = iterative.getStateCount();
+	double threadedStates = threaded.getStateCount();
+	BOOST_TEST( threadedStates == iterativeStates, boost::test_tools::tolerance(0.1) );
+	BOOST_TEST(
+		threaded.getTransitionCount() / threadedStates == iterative.getTransitionCount() / iterativeStates
+		, boost::test_tools::tolerance(0.05)
+	);
+	auto & iterativeResult = iterative.getResultTable().back();
+	auto & threadedResult = threaded.getResultTable().back();
+	BOOST_TEST( std::abs(threadedResult.pMin - iterativeResult.pMin) <= core::Options::prob_win );
+	BOOST_TEST( std::abs(threadedResult.pMax - iterativeResult.pMax) <= core::Options::prob_win );
+}
+
+// States are stolen while their old owner may still add to pi, so every update of pi has to be
+// atomic. Without self-loops or deadlocks, exploration only moves reachability mass between
+// states, so it must still add up to 1
+BOOST_AUTO_TEST_CASE( ThreadedBuilder_ConservesReachability, * bt::timeout(300) ) {
+	set_default_values();
+	core::Options::quiet = true;
+	// Small enough that the perimeter is wide and threads steal from each other
+	core::Options::kappa = 1.0e-6;
+	core::Options::threads = 4;
+	ModelModify mod("../test/models/simple.prism", "../test/models/simple.csl");
+	auto program = mod.readModel();
+	storm::builder::BuilderOptions options;
+	auto pool = std::make_shared<threads::ExplorationThreadPool<double, uint32_t>>(core::Options::threads);
+	const int numberOfBuilds = 5;
+	for (int build = 0; build < numberOfBuilds; build++) {
+		StaminaThreadedIterativeModelBuilder<double> builder(*program, options);
+		builder.setExplorationPool(pool);
+		builder.setGeneratorsVector(pool->getGenerators(*program, {}));
+		builder.build();
+		double totalPi = 0;
+		auto & stateMap = builder.getStateMap();
+		for (uint32_t index = 0; index < builder.getStateCount(); index++) {
+			if (auto probabilityState = stateMap.get(index)) {
+				totalPi += probabilityState->getPi();
+			}
+		}
+		BOOST_TEST( builder.getStateCount() > 100 );
+		BOOST_TEST( totalPi == 1.0, boost::test_tools::tolerance(1.0e-9) );
+	}
+	core::Options::threads = 1;
+}
+
+// The control thread sleeps without a timeout, so a missed wake-up would hang here rather than
+// only slow down. Every refine iteration parks all exploration threads and then terminates them
+BOOST_AUTO_TEST_CASE( ThreadedBuilder_Terminates, * bt::timeout(300) ) {
+	set_default_values();
+	core::Options::quiet = true;
+	core::Options::model_file = "../test/models/simple.prism";
+	core::Options::properties_file = "../test/models/simple.csl";
+	core::Options::threads = 4;
+	// Small enough to need several refine iterations
+	core::Options::prob_win = 1.0e-6;
+	Stamina threaded;
+	threaded.run();
+	core::Options::threads = 1;
+	BOOST_TEST( threaded.getStateCount() > 0 );
+}
+
+// =======================================================================================
+// Tests that later refine iterations of the priority builder continue exploring from the
+// perimeter of the previous one
+// =======================================================================================
+
+BOOST_AUTO_TEST_CASE( PriorityBuilder_RefineIterations ) {
+	// Runs the priority method for at most `iterations` refine iterations. Options::approx_factor
+	// changes between iterations, so every run starts from the defaults
+	auto runPriority = [](int iterations) {
+		set_default_values();
+		core::Options::quiet = true;
+		core::Options::model_file = "../test/models/simple.prism";
+		core::Options::properties_file = "../test/models/simple.csl";
+		core::Options::method = STAMINA_METHODS::PRIORITY_METHOD;
+		// Small enough that one iteration does not close the window
+		core::Options::prob_win = 1.0e-6;
+		core::Options::max_approx_count = iterations;
+		auto s = std::make_unique<Stamina>();
+		s->run();
+		return s;
+	};
+	auto once = runPriority(1);
+	auto twice = runPriority(2);
+	set_default_values();
+	auto & onceResult = once->getResultTable().back();
+	auto & twiceResult = twice->getResultTable().back();
+	double onceWindow = onceResult.pMax - onceResult.pMin;
+	double twiceWindow = twiceResult.pMax - twiceResult.pMin;
+	// Otherwise the second run stops after one iteration as well
+	BOOST_TEST_REQUIRE( onceWindow > 1.0e-6 );
+	BOOST_TEST( twice->getStateCount() > once->getStateCount() );
+	BOOST_TEST( twiceWindow < onceWindow );
+	BOOST_TEST( twiceResult.pMin >= onceResult.pMin - core::StaminaTransientSolver::precision );
+	BOOST_TEST( twiceResult.pMax <= onceResult.pMax + core::StaminaTransientSolver::precision );
+	// Only states which are still on the perimeter may have transitions to the absorbing state.
+	// A state explored in the second iteration must not keep its transition from the first
+	std::unordered_set<uint32_t> perimeter;
+	for (auto probabilityState : twice->modelChecker->getPerimeterStates()) {
+		perimeter.insert(probabilityState->index);
+	}
+	auto const & matrix = twice->modelChecker->getModel()->getTransitionMatrix();
+	uint64_t connectedToAbsorbing = 0;
+	bool onlyPerimeterConnected = true;
+	// Row 0 is the absorbing state itself
+	for (uint64_t row = 1; row < matrix.getRowCount(); ++row) {
+		for (auto const & entry : matrix.getRow(row)) {
+			if (entry.getColumn() == 0 && entry.getValue() > 0) {
+				++connectedToAbsorbing;
+				onlyPerimeterConnected &= perimeter.count(row) == 1;
+			}
+		}
+	}
+	BOOST_TEST( connectedToAbsorbing > 0 );
+	BOOST_TEST( onlyPerimeterConnected );
+}
+
+// =======================================================================================
+// Tests that connecting the perimeter to the absorbing state in parallel gives the same
+// model as connecting it on one thread
+// =======================================================================================
+
+BOOST_AUTO_TEST_CASE( ConnectPerimeter_ParallelMatchesSerial ) {
+	set_default_values();
+	core::Options::quiet = true;
+	ModelModify mod("../test/models/simple.prism", "../test/models/simple.csl");
+	auto program = mod.readModel();
+	storm::builder::BuilderOptions options;
+	StaminaIterativeModelBuilder<double> serialBuilder(*program, options);
+	auto serial = serialBuilder.build();
+	core::Options::threads = 2;
+	auto pool = std::make_shared<threads::ExplorationThreadPool<double, uint32_t>>(2);
+	StaminaIterativeModelBuilder<double> parallelBuilder(*program, options);
+	parallelBuilder.setExplorationPool(pool);
+	parallelBuilder.setGeneratorsVector(pool->getGenerators(*program, {}));
+	// So that even a small perimeter is split across both generators
+	parallelBuilder.setMinimumPerimeterStatesPerGenerator(1);
+	auto parallel = parallelBuilder.build();
+	core::Options::threads = 1;
+	BOOST_TEST( parallel->getNumberOfStates() == serial->getNumberOfStates() );
+	BOOST_TEST( parallel->getNumberOfTransitions() == serial->getNumberOfTransitions() );
+	auto const & serialMatrix = serial->getTransitionMatrix();
+	auto const & parallelMatrix = parallel->getTransitionMatrix();
+	// Parts are merged in perimeter order, so rows have the same entries in the same order
+	bool allMatch = serialMatrix.getRowCount() == parallelMatrix.getRowCount();
+	for (uint64_t row = 0; allMatch && row < serialMatrix.getRowCount(); ++row) {
+		auto serialRow = serialMatrix.getRow(row);
+		auto parallelRow = parallelMatrix.getRow(row);
+		allMatch &= serialRow.getNumberOfEntries() == parallelRow.getNumberOfEntries();
+		for (auto serialEntry = serialRow.begin(), parallelEntry = parallelRow.begin()
+			; allMatch && serialEntry != serialRow.end()
+			; ++serialEntry, ++parallelEntry
+		) {
+			allMatch &= serialEntry->getColumn() == parallelEntry->getColumn()
+				&& std::abs(serialEntry->getValue() - parallelEntry->getValue()) <= 1e-12;
+		}
+	}
+	BOOST_TEST( allMatch );
+	// There was a perimeter to connect
+	BOOST_TEST( !parallelBuilder.getPerimeterStates().empty() );
+}
+
 // =======================================================================================
 
 BOOST_AUTO_TEST_CASE( Results_Basic ) {